@@ -0,0 +1,212 @@
+#include "FileLayout.hpp"
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <numeric>
+
+#if defined _WIN32 || defined _WIN64
+#include <sys/stat.h>
+#else
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef __linux__
+#include <cerrno>
+#include <linux/fiemap.h>
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#include <sys/resource.h>
+
+//Descriptors left open by locate_file and not released yet.
+static std::atomic<std::size_t> _kept_descriptors{0};
+
+//Keep one more descriptor open if the process stays under half of its limit.
+static bool keep_descriptor()
+{
+    static const std::size_t limit = []
+    {
+        struct rlimit descriptor_limit;
+
+        if(getrlimit(RLIMIT_NOFILE, &descriptor_limit) != 0 || descriptor_limit.rlim_cur == RLIM_INFINITY)
+            return std::size_t(512);
+
+        return static_cast<std::size_t>(descriptor_limit.rlim_cur / 2);
+    }();
+
+    if(_kept_descriptors.fetch_add(1) < limit)
+        return true;
+
+    _kept_descriptors.fetch_sub(1);
+
+    return false;
+}
+
+//Devices FIEMAP failed on as unsupported, their files are not opened to be located.
+static std::mutex _no_fiemap_mutex;
+static std::vector<uint64_t> _no_fiemap_devices;
+
+static bool has_fiemap(uint64_t device)
+{
+    std::lock_guard<std::mutex> lock(_no_fiemap_mutex);
+
+    return std::find(_no_fiemap_devices.begin(), _no_fiemap_devices.end(), device) == _no_fiemap_devices.end();
+}
+
+static void set_no_fiemap(uint64_t device)
+{
+    std::lock_guard<std::mutex> lock(_no_fiemap_mutex);
+
+    if(std::find(_no_fiemap_devices.begin(), _no_fiemap_devices.end(), device) == _no_fiemap_devices.end())
+        _no_fiemap_devices.push_back(device);
+}
+#endif
+
+bool locate_file(int dir_fd, const char *name, File_Location &location, bool keep_open)
+{
+    location = File_Location();
+
+#if defined _WIN32 || defined _WIN64
+    (void)dir_fd;
+    (void)keep_open;
+
+    struct _stati64 file_stat;
+
+    if(_stati64(name, &file_stat) != 0)
+        return false;
+
+    location._device = static_cast<uint64_t>(file_stat.st_dev);
+    location._inode = static_cast<uint64_t>(file_stat.st_ino);
+    location._located = true;
+
+    return true;
+#else
+    struct stat file_stat;
+
+    if(fstatat(dir_fd, name, &file_stat, 0) != 0)
+        return false;
+
+    location._device = static_cast<uint64_t>(file_stat.st_dev);
+    location._inode = static_cast<uint64_t>(file_stat.st_ino);
+    location._located = true;
+
+#ifdef __linux__
+    if(S_ISREG(file_stat.st_mode) == false || has_fiemap(location._device) == false)
+        return true;
+
+    int fd = openat(dir_fd, name, O_RDONLY | O_CLOEXEC);
+
+    if(fd < 0)
+        return true;
+
+    //The header of a file is in its first extent, room for the map and a single extent.
+    alignas(struct fiemap) unsigned char request[sizeof(struct fiemap) + sizeof(struct fiemap_extent)] = {};
+
+    struct fiemap *map = reinterpret_cast<struct fiemap *>(request);
+    map->fm_start = 0;
+    map->fm_length = FIEMAP_MAX_OFFSET;
+    map->fm_extent_count = 1;
+
+    if(ioctl(fd, FS_IOC_FIEMAP, map) == 0)
+    {
+        if(map->fm_mapped_extents != 0 && (map->fm_extents[0].fe_flags & FIEMAP_EXTENT_UNKNOWN) == 0)
+        {
+            location._physical = map->fm_extents[0].fe_physical;
+            location._has_extent = true;
+        }
+    }
+    else if(errno == EOPNOTSUPP || errno == ENOTTY)
+        set_no_fiemap(location._device);
+
+    if(keep_open && keep_descriptor())
+        location._fd = fd;
+    else
+        close(fd);
+#else
+    (void)keep_open;
+#endif
+
+    return true;
+#endif
+}
+
+bool locate_file(const char *path, File_Location &location, bool keep_open)
+{
+#if defined _WIN32 || defined _WIN64
+    return locate_file(-1, path, location, keep_open);
+#else
+    return locate_file(AT_FDCWD, path, location, keep_open);
+#endif
+}
+
+void release_location(File_Location &location)
+{
+#ifdef __linux__
+    if(location._fd >= 0)
+    {
+        close(location._fd);
+
+        _kept_descriptors.fetch_sub(1);
+
+        location._fd = -1;
+    }
+#else
+    (void)location;
+#endif
+}
+
+std::vector<std::size_t> physical_order(const std::vector<File_Location> &locations)
+{
+    std::vector<std::size_t> order(locations.size());
+
+    std::iota(order.begin(), order.end(), std::size_t(0));
+
+    std::stable_sort(order.begin(), order.end(), [&](std::size_t a, std::size_t b)
+    {
+        const File_Location &left = locations[a];
+        const File_Location &right = locations[b];
+
+        if(left._located != right._located)
+            return left._located;
+
+        if(left._located == false)
+            return false;
+
+        if(left._device != right._device)
+            return left._device < right._device;
+
+        if(left._has_extent != right._has_extent)
+            return left._has_extent;
+
+        if(left._has_extent && left._physical != right._physical)
+            return left._physical < right._physical;
+
+        return left._inode < right._inode;
+    });
+
+    return order;
+}
+
+uint64_t seek_distance(const std::vector<File_Location> &locations, const std::vector<std::size_t> &order)
+{
+    uint64_t distance = 0;
+
+    const File_Location *previous = nullptr;
+
+    for(std::size_t index : order)
+    {
+        const File_Location &current = locations[index];
+
+        if(current._has_extent == false)
+            continue;
+
+        if(previous != nullptr && previous->_device == current._device)
+            distance += current._physical > previous->_physical ? current._physical - previous->_physical :
+                previous->_physical - current._physical;
+
+        previous = &current;
+    }
+
+    return distance;
+}
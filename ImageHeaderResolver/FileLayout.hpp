@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+//Where a file lives on its device, as far as the system tells.
+struct File_Location
+{
+	uint64_t _device = 0;
+	uint64_t _inode = 0;
+	uint64_t _physical = 0;                     //byte offset of the first extent on the device
+	bool _located = false;                      //whether the file could be stat'ed
+	bool _has_extent = false;                   //whether _physical is known(FIEMAP)
+	int _fd = -1;                               //descriptor left open to read the file through, -1 if none
+};
+
+/**
+* Find the device, inode and first physical extent of the file name relative to dir_fd(AT_FDCWD for
+* plain paths). The extent is asked for through FIEMAP on Linux without syncing the file, so only
+* metadata is read. Elsewhere, and on the devices FIEMAP turned out not to be supported on, only what
+* stat tells is filled in and the file is not opened.
+* With keep_open, the descriptor the extent was asked through is left in location._fd for the file
+* to be read through rather than opened again, while the descriptors kept so stay under half of the
+* limit of the process. It is closed by release_location.
+*/
+bool locate_file(int dir_fd, const char *name, File_Location &location, bool keep_open = false);
+
+bool locate_file(const char *path, File_Location &location, bool keep_open = false);
+
+//Close the descriptor locate_file left open, if any.
+void release_location(File_Location &location);
+
+/**
+* The order to read the files in: by device, then by first physical extent for the files that have
+* one, then by inode, which most file systems allocate close to where the data goes. Files not
+* located keep their place at the end.
+*/
+std::vector<std::size_t> physical_order(const std::vector<File_Location> &locations);
+
+/**
+* Sum of the distances(in byte) between the first extents of consecutive files on the same
+* device when read in the given order, an estimate of how far the disk heads travel.
+*/
+uint64_t seek_distance(const std::vector<File_Location> &locations, const std::vector<std::size_t> &order);
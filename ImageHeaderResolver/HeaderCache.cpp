@@ -0,0 +1,172 @@
+#include "HeaderCache.hpp"
+#include <functional>
+#include <mutex>
+
+//What an entry takes besides its pages, its slot of the map and of the clock included.
+static const std::size_t entry_overhead = 96;
+
+//What an entry of the path and pages takes.
+static std::size_t entry_charge(std::string_view path, const Image_Pages &pages)
+{
+    std::size_t charge = entry_overhead + path.size() + sizeof(Image_Pages);
+
+    for(const Image_Info *page = pages.first_page()._next; page != nullptr; page = page->_next)
+        charge += sizeof(Image_Info);
+
+    return charge;
+}
+
+static inline bool same_key(const Ihr_File_Key &left, const Ihr_File_Key &right)
+{
+    return left._device == right._device && left._inode == right._inode &&
+        left._size == right._size && left._mtime_ns == right._mtime_ns;
+}
+
+Header_Cache::Header_Cache(std::size_t memory_budget) : _memory_budget(memory_budget) {}
+
+Header_Cache::Shard &Header_Cache::shard_of(std::string_view path)
+{
+    return _shards[std::hash<std::string_view>()(path) % shard_count];
+}
+
+std::shared_ptr<const Image_Pages> Header_Cache::find(std::string_view path, const Ihr_File_Key &key)
+{
+    Shard &shard = shard_of(path);
+
+    std::shared_lock<std::shared_mutex> lock(shard._mutex);
+
+    auto slot = shard._slots.find(path);
+
+    if(slot == shard._slots.end())
+    {
+        shard._misses.fetch_add(1, std::memory_order_relaxed);
+
+        return nullptr;
+    }
+
+    Entry &entry = *shard._clock[slot->second];
+
+    //A changed file misses, its entry is replaced once it is resolved again.
+    if(same_key(entry._key, key) == false)
+    {
+        shard._misses.fetch_add(1, std::memory_order_relaxed);
+
+        return nullptr;
+    }
+
+    if(entry._referenced.load(std::memory_order_relaxed) == false)
+        entry._referenced.store(true, std::memory_order_relaxed);
+
+    shard._hits.fetch_add(1, std::memory_order_relaxed);
+
+    return entry._pages;
+}
+
+void Header_Cache::insert(std::string_view path, const Ihr_File_Key &key, std::shared_ptr<const Image_Pages> pages)
+{
+    if(pages == nullptr)
+        return;
+
+    std::size_t budget = memory_budget() / shard_count;
+
+    std::size_t charge = entry_charge(path, *pages);
+
+    Shard &shard = shard_of(path);
+
+    std::unique_lock<std::shared_mutex> lock(shard._mutex);
+
+    auto slot = shard._slots.find(path);
+
+    if(slot != shard._slots.end())
+        remove_slot(shard, slot->second);
+
+    if(charge > budget)
+        return;
+
+    evict(shard, budget - charge);
+
+    std::unique_ptr<Entry> entry(new Entry);
+    entry->_path = path;
+    entry->_key = key;
+    entry->_pages = std::move(pages);
+    entry->_charge = charge;
+
+    std::size_t index;
+
+    if(shard._free_slots.empty() == false)
+    {
+        index = shard._free_slots.back();
+
+        shard._free_slots.pop_back();
+    }
+    else
+    {
+        index = shard._clock.size();
+
+        shard._clock.emplace_back();
+    }
+
+    shard._slots.emplace(entry->_path, index);
+    shard._clock[index] = std::move(entry);
+    shard._bytes += charge;
+}
+
+void Header_Cache::set_memory_budget(std::size_t memory_budget)
+{
+    _memory_budget.store(memory_budget, std::memory_order_relaxed);
+
+    for(Shard &shard : _shards)
+    {
+        std::unique_lock<std::shared_mutex> lock(shard._mutex);
+
+        evict(shard, memory_budget / shard_count);
+    }
+}
+
+void Header_Cache::evict(Shard &shard, std::size_t budget)
+{
+    //Every entry is passed at most twice, once to clear its reference bit and once to evict it.
+    while(shard._bytes > budget && shard._slots.empty() == false)
+    {
+        std::size_t slot = shard._hand;
+
+        shard._hand = (shard._hand + 1) % shard._clock.size();
+
+        Entry *entry = shard._clock[slot].get();
+
+        if(entry == nullptr || entry->_referenced.exchange(false, std::memory_order_relaxed))
+            continue;
+
+        remove_slot(shard, slot);
+
+        shard._evictions.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void Header_Cache::remove_slot(Shard &shard, std::size_t slot)
+{
+    std::unique_ptr<Entry> entry = std::move(shard._clock[slot]);
+
+    shard._slots.erase(entry->_path);
+    shard._free_slots.push_back(slot);
+    shard._bytes -= entry->_charge;
+}
+
+Header_Cache_Stats Header_Cache::stats() const
+{
+    Header_Cache_Stats stats = {};
+
+    for(const Shard &shard : _shards)
+    {
+        stats._hits += shard._hits.load(std::memory_order_relaxed);
+        stats._misses += shard._misses.load(std::memory_order_relaxed);
+        stats._evictions += shard._evictions.load(std::memory_order_relaxed);
+
+        std::shared_lock<std::shared_mutex> lock(shard._mutex);
+
+        stats._entries += shard._slots.size();
+        stats._bytes += shard._bytes;
+    }
+
+    return stats;
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+#include "ImageHeaderResolver.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+//The pages of a resolved image, shared by every header of the file and never changed.
+class Image_Pages
+{
+public:
+	explicit Image_Pages(const Image_Info &info) : _info(info) {}
+
+	~Image_Pages() { release_image_info(&_info); }
+
+	Image_Pages(const Image_Pages &) = delete;
+	Image_Pages &operator=(const Image_Pages &) = delete;
+
+	const Image_Info &first_page() const { return _info; }
+
+private:
+	Image_Info _info;
+};
+
+struct Header_Cache_Stats
+{
+	std::uint64_t _hits;
+	std::uint64_t _misses;
+	std::uint64_t _evictions;
+	std::uint64_t _entries;
+	std::uint64_t _bytes;
+};
+
+/**
+* Cache of resolved headers, keyed by path and checked against the file key(device, inode, size and
+* modification time) on every lookup.
+* Paths are spread over shards, each with its own lock. Lookups take the lock of their shard shared,
+* a hit only sets the reference bit of the entry(an atomic), so readers never wait on each other.
+* Entries are evicted with the CLOCK policy once a shard is over its part of the memory budget.
+*/
+class Header_Cache
+{
+public:
+	/**@param[in] memory_budget bytes the entries may take, 0 to keep none*/
+	explicit Header_Cache(std::size_t memory_budget);
+
+	Header_Cache(const Header_Cache &) = delete;
+	Header_Cache &operator=(const Header_Cache &) = delete;
+
+	/**@brief the pages of the file if they are cached and the file is unchanged, nullptr otherwise*/
+	std::shared_ptr<const Image_Pages> find(std::string_view path, const Ihr_File_Key &key);
+
+	void insert(std::string_view path, const Ihr_File_Key &key, std::shared_ptr<const Image_Pages> pages);
+
+	/**@brief change the memory budget, entries over it are evicted at once*/
+	void set_memory_budget(std::size_t memory_budget);
+
+	std::size_t memory_budget() const { return _memory_budget.load(std::memory_order_relaxed); }
+
+	Header_Cache_Stats stats() const;
+
+private:
+	struct Entry
+	{
+		std::string _path;
+		Ihr_File_Key _key;
+		std::shared_ptr<const Image_Pages> _pages;
+		std::size_t _charge;
+		std::atomic<bool> _referenced{false};
+	};
+
+	struct alignas(64) Shard
+	{
+		mutable std::shared_mutex _mutex;
+
+		//Keys point into the paths of the entries.
+		std::unordered_map<std::string_view, std::size_t> _slots;
+
+		//The clock, slots of evicted entries are empty and reused.
+		std::vector<std::unique_ptr<Entry>> _clock;
+		std::vector<std::size_t> _free_slots;
+		std::size_t _hand = 0;
+		std::size_t _bytes = 0;
+
+		std::atomic<std::uint64_t> _hits{0};
+		std::atomic<std::uint64_t> _misses{0};
+		std::atomic<std::uint64_t> _evictions{0};
+	};
+
+	static const std::size_t shard_count = 16;
+
+	Shard &shard_of(std::string_view path);
+
+	//Evict entries of the shard until it takes no more than budget bytes, the caller holds the lock.
+	void evict(Shard &shard, std::size_t budget);
+
+	void remove_slot(Shard &shard, std::size_t slot);
+
+private:
+	std::atomic<std::size_t> _memory_budget;
+	Shard _shards[shard_count];
+};
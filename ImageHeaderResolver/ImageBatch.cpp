@@ -0,0 +1,211 @@
+#include "ImageHeaderResolver.h"
+#include "ImageSource.h"
+#include "FileLayout.hpp"
+#include "ThreadPool.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <latch>
+#include <numeric>
+#include <thread>
+#include <vector>
+
+//Statistics written by a single thread, aligned so neighbours do not share a cache line.
+struct alignas(64) Padded_Thread_Stats
+{
+    Ihr_Thread_Stats _stats;
+};
+
+//Chunks per thread, enough for stealing to even out slow files without many tiny tasks.
+static const std::size_t chunks_per_thread = 16;
+
+static const std::size_t max_chunk_size = 1024;
+
+//The descriptor locating the file left open, if any, is read through rather than opening the file again.
+static bool resolve_path(const char *path, const File_Location *location, Image_Info *info, bool report_errors, Ihr_Thread_Stats &stats)
+{
+    std::memset(info, 0, sizeof(Image_Info));
+
+    if(path == nullptr)
+        return false;
+
+    Ihr_Source source;
+
+    if(location != nullptr && location->_fd >= 0)
+    {
+        if(ihr_source_from_fd(&source, location->_fd) == false)
+        {
+            if(report_errors)
+                std::perror(path);
+
+            return false;
+        }
+    }
+    else if(ihr_source_open_file(&source, path, report_errors) == false)
+        return false;
+
+    bool success = ihr_resolve_source(&source, info);
+
+    stats._bytes_read += source._bytes_read;
+
+    ihr_source_close(&source);
+
+    return success;
+}
+
+/**
+* The pool every batch of the process runs on, made on the first batch with a worker per hardware
+* thread. The batches share its workers rather than each calling thread keeping idle ones of its own.
+*/
+static Thread_Pool &batch_pool()
+{
+    static Thread_Pool pool(std::max(1u, std::thread::hardware_concurrency()));
+
+    return pool;
+}
+
+/**
+* Run fn(begin, end, worker) over the chunks of [0, n) and wait for them, the other batches on the
+* pool are not waited for. Chunks are dealt to the first worker_count workers in turn, so each starts
+* with a contiguous share of its own, idle workers can still steal them.
+*/
+template<typename Function>
+static void run_chunks(Thread_Pool &pool, unsigned int worker_count, std::size_t n, std::size_t chunk_size, Function fn)
+{
+    std::size_t chunk_count = (n + chunk_size - 1) / chunk_size;
+
+    std::latch done(static_cast<std::ptrdiff_t>(chunk_count));
+
+    for(std::size_t chunk_index = 0; chunk_index < chunk_count; ++chunk_index)
+    {
+        std::size_t begin = chunk_index * chunk_size;
+        std::size_t end = std::min(n, begin + chunk_size);
+        unsigned int worker = static_cast<unsigned int>(chunk_index % worker_count);
+
+        pool.submit_to(worker, [&, begin, end, worker]
+        {
+            fn(begin, end, worker);
+
+            done.count_down();
+        });
+    }
+
+    done.wait();
+}
+
+size_t get_image_info_batch(
+    const char *const *paths,
+    size_t n,
+    Image_Info *out,
+    bool *ok,
+    const Ihr_Batch_Options *opts)
+{
+    Ihr_Batch_Options options = {};
+
+    if(opts != nullptr)
+        options = *opts;
+
+    if(options._thread_stats != nullptr)
+        std::fill(options._thread_stats, options._thread_stats + options._thread_stats_capacity, Ihr_Thread_Stats{});
+
+    if(paths == nullptr || out == nullptr || n == 0)
+        return 0;
+
+    Thread_Pool &pool = batch_pool();
+
+    //The workers the chunks of this batch are dealt to.
+    unsigned int worker_count = options._thread_count == 0 ? pool.thread_count() : std::min(options._thread_count, pool.thread_count());
+
+    std::vector<Padded_Thread_Stats> thread_stats(pool.thread_count(), Padded_Thread_Stats{});
+
+    std::size_t chunk_size = std::clamp<std::size_t>(n / (worker_count * chunks_per_thread), 1, max_chunk_size);
+
+    //The files in the order they are read, empty for the order given.
+    std::vector<std::size_t> order;
+
+    //Where the files lie, empty for the order given, with the descriptors they are read through.
+    std::vector<File_Location> locations;
+
+    if(options._physical_order)
+    {
+        locations.resize(n);
+
+        run_chunks(pool, worker_count, n, chunk_size, [&](std::size_t begin, std::size_t end, unsigned int)
+        {
+            for(std::size_t i = begin; i < end; ++i)
+            {
+                if(paths[i] != nullptr)
+                    locate_file(paths[i], locations[i], true);
+            }
+        });
+
+        order = physical_order(locations);
+
+        if(options._layout_stats != nullptr)
+        {
+            std::vector<std::size_t> given(n);
+
+            std::iota(given.begin(), given.end(), std::size_t(0));
+
+            options._layout_stats->_files_located = static_cast<uint64_t>(std::count_if(locations.begin(), locations.end(),
+                [](const File_Location &location) { return location._has_extent; }));
+            options._layout_stats->_seek_bytes_given = seek_distance(locations, given);
+            options._layout_stats->_seek_bytes_ordered = seek_distance(locations, order);
+        }
+
+        //Contiguous runs of the ordered files go to the threads, rather than runs scattered by stealing.
+        chunk_size = (n + worker_count - 1) / worker_count;
+    }
+    else if(options._layout_stats != nullptr)
+        *options._layout_stats = Ihr_Layout_Stats{};
+
+    run_chunks(pool, worker_count, n, chunk_size, [&](std::size_t begin, std::size_t end, unsigned int dealt_to)
+    {
+        unsigned int worker = static_cast<unsigned int>(pool.current_worker());
+
+        Ihr_Thread_Stats &stats = thread_stats[worker]._stats;
+
+        //A chunk run by another worker than the one it was dealt to was stolen.
+        if(worker != dealt_to)
+            ++stats._steals;
+
+        auto start = std::chrono::steady_clock::now();
+
+        for(std::size_t position = begin; position < end; ++position)
+        {
+            std::size_t i = order.empty() ? position : order[position];
+
+            File_Location *location = locations.empty() ? nullptr : &locations[i];
+
+            bool success = resolve_path(paths[i], location, out + i, options._report_errors, stats);
+
+            if(location != nullptr)
+                release_location(*location);
+
+            if(ok != nullptr)
+                ok[i] = success;
+
+            ++stats._files;
+
+            if(success)
+                ++stats._succeeded;
+        }
+
+        auto span = std::chrono::steady_clock::now() - start;
+
+        stats._busy_ns += static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(span).count());
+    });
+
+    std::size_t succeeded = 0;
+
+    for(unsigned int i = 0; i < pool.thread_count(); ++i)
+    {
+        succeeded += thread_stats[i]._stats._succeeded;
+
+        if(options._thread_stats != nullptr && i < options._thread_stats_capacity)
+            options._thread_stats[i] = thread_stats[i]._stats;
+    }
+
+    return succeeded;
+}
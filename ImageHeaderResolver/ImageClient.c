@@ -0,0 +1,375 @@
+#if !(defined _WIN32 || defined _WIN64)
+#include <errno.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+//Where these are missing(macOS), SO_NOSIGPIPE is set on the socket instead.
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+#ifndef SOCK_CLOEXEC
+#define SOCK_CLOEXEC 0
+#endif
+#endif
+
+#include "ImageClient.h"
+#include "ImageProtocol.h"
+#include <stdlib.h>
+#include <string.h>
+
+struct Ihr_Client
+{
+	int         _fd;
+	uint32_t    _next_request_id;
+	uint8_t     *_buffer;                       //frames are built and taken apart here
+	size_t      _buffer_capacity;
+};
+
+#if defined _WIN32 || defined _WIN64
+Ihr_Client *ihr_client_connect(const char *socket_path)
+{
+	(void)socket_path;
+
+	return NULL;
+}
+
+void ihr_client_close(Ihr_Client *client)
+{
+	(void)client;
+}
+
+bool ihr_client_send(Ihr_Client *client, const char *const *paths, size_t n, uint32_t *request_id)
+{
+	(void)client; (void)paths; (void)n; (void)request_id;
+
+	return false;
+}
+
+bool ihr_client_receive(
+	Ihr_Client *client,
+	uint32_t *request_id,
+	Image_Info *out,
+	bool *ok,
+	size_t capacity,
+	size_t *n)
+{
+	(void)client; (void)request_id; (void)out; (void)ok; (void)capacity; (void)n;
+
+	return false;
+}
+#else
+static bool reserve_buffer(Ihr_Client *client, size_t capacity)
+{
+	if (capacity <= client->_buffer_capacity)
+		return true;
+
+	size_t new_capacity = client->_buffer_capacity * 2 > capacity ? client->_buffer_capacity * 2 : capacity;
+
+	uint8_t *buffer = (uint8_t *)realloc(client->_buffer, new_capacity);
+
+	if (buffer == NULL)
+		return false;
+
+	client->_buffer = buffer;
+	client->_buffer_capacity = new_capacity;
+
+	return true;
+}
+
+static bool write_all(int fd, const uint8_t *data, size_t length)
+{
+	while (length > 0)
+	{
+		ssize_t written = send(fd, data, length, MSG_NOSIGNAL);
+
+		if (written < 0 && errno == EINTR)
+			continue;
+
+		if (written <= 0)
+			return false;
+
+		data += written;
+		length -= (size_t)written;
+	}
+
+	return true;
+}
+
+static bool read_all(int fd, uint8_t *data, size_t length)
+{
+	while (length > 0)
+	{
+		ssize_t read_size = recv(fd, data, length, 0);
+
+		if (read_size < 0 && errno == EINTR)
+			continue;
+
+		if (read_size <= 0)
+			return false;
+
+		data += read_size;
+		length -= (size_t)read_size;
+	}
+
+	return true;
+}
+
+//Read and drop the payload of a frame not taken, so the next frame is read from its header.
+static bool skip_all(int fd, size_t length)
+{
+	uint8_t scratch[4096];
+
+	while (length > 0)
+	{
+		size_t chunk = length < sizeof(scratch) ? length : sizeof(scratch);
+
+		if (read_all(fd, scratch, chunk) == false)
+			return false;
+
+		length -= chunk;
+	}
+
+	return true;
+}
+
+Ihr_Client *ihr_client_connect(const char *socket_path)
+{
+	if (socket_path == NULL)
+		socket_path = IHR_DEFAULT_SOCKET;
+
+	struct sockaddr_un address;
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+
+	if (strlen(socket_path) >= sizeof(address.sun_path))
+		return NULL;
+
+	strcpy(address.sun_path, socket_path);
+
+	int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+
+	if (fd < 0)
+		return NULL;
+
+#ifdef SO_NOSIGPIPE
+	int enabled = 1;
+	setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &enabled, sizeof(enabled));
+#endif
+
+	if (connect(fd, (const struct sockaddr *)&address, sizeof(address)) != 0)
+	{
+		close(fd);
+
+		return NULL;
+	}
+
+	Ihr_Client *client = (Ihr_Client *)calloc(1, sizeof(Ihr_Client));
+
+	if (client == NULL)
+	{
+		close(fd);
+
+		return NULL;
+	}
+
+	client->_fd = fd;
+
+	return client;
+}
+
+void ihr_client_close(Ihr_Client *client)
+{
+	if (client == NULL)
+		return;
+
+	close(client->_fd);
+
+	free(client->_buffer);
+	free(client);
+}
+
+bool ihr_client_send(Ihr_Client *client, const char *const *paths, size_t n, uint32_t *request_id)
+{
+	if (client == NULL || (paths == NULL && n != 0) || n > IHR_MAX_BATCH)
+		return false;
+
+	size_t length = sizeof(Ihr_Frame_Header);
+
+	for (size_t i = 0; i < n; ++i)
+		length += sizeof(uint32_t) + (paths[i] != NULL ? strlen(paths[i]) : 0);
+
+	if (length - sizeof(Ihr_Frame_Header) > IHR_MAX_PAYLOAD || reserve_buffer(client, length) == false)
+		return false;
+
+	Ihr_Frame_Header header;
+	header._magic = IHR_FRAME_REQUEST;
+	header._request_id = client->_next_request_id++;
+	header._count = (uint32_t)n;
+	header._payload_length = (uint32_t)(length - sizeof(Ihr_Frame_Header));
+
+	memcpy(client->_buffer, &header, sizeof(Ihr_Frame_Header));
+
+	uint8_t *position = client->_buffer + sizeof(Ihr_Frame_Header);
+
+	for (size_t i = 0; i < n; ++i)
+	{
+		uint32_t path_length = paths[i] != NULL ? (uint32_t)strlen(paths[i]) : 0;
+
+		memcpy(position, &path_length, sizeof(uint32_t));
+		position += sizeof(uint32_t);
+
+		if (path_length > 0)
+			memcpy(position, paths[i], path_length);
+
+		position += path_length;
+	}
+
+	if (write_all(client->_fd, client->_buffer, length) == false)
+		return false;
+
+	if (request_id != NULL)
+		*request_id = header._request_id;
+
+	return true;
+}
+
+//Check that the records of a response payload and their pages are all within it.
+static bool are_records_complete(const uint8_t *payload, size_t length, uint32_t count)
+{
+	const uint8_t *position = payload;
+	const uint8_t *end = payload + length;
+
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		Ihr_Wire_Record record;
+
+		if ((size_t)(end - position) < sizeof(Ihr_Wire_Record))
+			return false;
+
+		memcpy(&record, position, sizeof(Ihr_Wire_Record));
+		position += sizeof(Ihr_Wire_Record);
+
+		if ((size_t)(end - position) / sizeof(Ihr_Wire_Page) < record._page_count)
+			return false;
+
+		position += (size_t)record._page_count * sizeof(Ihr_Wire_Page);
+	}
+
+	return true;
+}
+
+bool ihr_client_receive(
+	Ihr_Client *client,
+	uint32_t *request_id,
+	Image_Info *out,
+	bool *ok,
+	size_t capacity,
+	size_t *n)
+{
+	if (client == NULL || ((out == NULL || ok == NULL) && capacity != 0))
+		return false;
+
+	Ihr_Frame_Header header;
+
+	if (read_all(client->_fd, (uint8_t *)&header, sizeof(Ihr_Frame_Header)) == false ||
+		header._magic != IHR_FRAME_RESPONSE)
+		return false;
+
+	//A response not taken is dropped as a whole, the connection stays in step for the next ones.
+	if (header._payload_length > IHR_MAX_PAYLOAD || header._count > IHR_MAX_BATCH ||
+		reserve_buffer(client, header._payload_length) == false)
+	{
+		skip_all(client->_fd, header._payload_length);
+
+		return false;
+	}
+
+	if (read_all(client->_fd, client->_buffer, header._payload_length) == false)
+		return false;
+
+	//Checked as a whole first, so no page list is built for a response found malformed halfway.
+	if (are_records_complete(client->_buffer, header._payload_length, header._count) == false)
+		return false;
+
+	const uint8_t *position = client->_buffer;
+
+	for (uint32_t i = 0; i < header._count; ++i)
+	{
+		Ihr_Wire_Record record;
+
+		memcpy(&record, position, sizeof(Ihr_Wire_Record));
+		position += sizeof(Ihr_Wire_Record);
+
+		const uint8_t *pages = position;
+		position += (size_t)record._page_count * sizeof(Ihr_Wire_Page);
+
+		if (i >= capacity)
+			continue;
+
+		memset(&out[i], 0, sizeof(Image_Info));
+
+		ok[i] = record._success != 0 && record._page_count > 0;
+
+		if (ok[i] == false)
+			continue;
+
+		Image_Info *last = NULL;
+
+		for (uint32_t page_index = 0; page_index < record._page_count; ++page_index)
+		{
+			Ihr_Wire_Page page;
+			memcpy(&page, pages + (size_t)page_index * sizeof(Ihr_Wire_Page), sizeof(Ihr_Wire_Page));
+
+			Image_Info *current = &out[i];
+
+			if (last != NULL)
+			{
+				current = (Image_Info *)calloc(1, sizeof(Image_Info));
+
+				if (current == NULL)
+				{
+					release_image_info(&out[i]);
+					memset(&out[i], 0, sizeof(Image_Info));
+
+					ok[i] = false;
+
+					break;
+				}
+
+				last->_next = current;
+			}
+
+			current->_file_size = record._file_size;
+			memcpy(current->_format, record._format, sizeof(current->_format));
+			current->_format[sizeof(current->_format) - 1] = '\0';
+			current->_width = page._width;
+			current->_height = page._height;
+			current->_color_depth = page._color_depth;
+			current->_channels = page._channels;
+			current->_page_number = record._page_count;
+
+			last = current;
+		}
+	}
+
+	if (request_id != NULL)
+		*request_id = header._request_id;
+
+	if (n != NULL)
+		*n = header._count;
+
+	return true;
+}
+#endif
+
+bool ihr_client_resolve(Ihr_Client *client, const char *const *paths, size_t n, Image_Info *out, bool *ok)
+{
+	uint32_t sent_id, received_id;
+	size_t received;
+
+	if (ihr_client_send(client, paths, n, &sent_id) == false ||
+		ihr_client_receive(client, &received_id, out, ok, n, &received) == false)
+		return false;
+
+	return sent_id == received_id && received == n;
+}
@@ -0,0 +1,67 @@
+#ifndef IMAGECLIENT_H
+#define IMAGECLIENT_H
+
+#include "ImageHeaderResolver.h"
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//Socket ihr-daemon listens on unless told otherwise.
+#define IHR_DEFAULT_SOCKET "/tmp/ihr-daemon.sock"
+
+/**
+* A connection to ihr-daemon, which keeps the resolver(and its cache) resident so a script does
+* not pay for starting a process per image.
+* A client is used by one thread at a time. Requests can be pipelined: send several with
+* ihr_client_send, then take the responses with ihr_client_receive as they come.
+* Not available on Windows, where connecting always fails.
+*/
+typedef struct Ihr_Client Ihr_Client;
+
+/**
+* @brief Connect to the daemon listening on socket_path(IHR_DEFAULT_SOCKET if NULL).
+* @return the client, or NULL if it can not connect
+*/
+Ihr_Client *ihr_client_connect(const char *socket_path);
+
+void ihr_client_close(Ihr_Client *client);
+
+/**
+* @brief Send a batch of paths without waiting for the response.
+* @param[out] request_id id the response will carry, can be NULL
+* @return true for success, false if the connection failed
+*/
+bool ihr_client_send(Ihr_Client *client, const char *const *paths, size_t n, uint32_t *request_id);
+
+/**
+* @brief Wait for the next response.
+* @param[out] request_id id of the request answered, can be NULL
+* @param[out] out image information of the files, release every one resolved with release_image_info
+* @param[out] ok whether each file was resolved
+* @param[in] capacity number of elements of out and ok, records beyond it are dropped
+* @param[out] n number of files of the request
+* @return true for success, false if the connection failed
+*/
+bool ihr_client_receive(
+    Ihr_Client *client,
+    uint32_t *request_id,
+    Image_Info *out,
+    bool *ok,
+    size_t capacity,
+    size_t *n);
+
+/**
+* @brief Resolve a batch of paths and wait for the result, no other request may be pending.
+* @return true for success, false if the connection failed
+*/
+bool ihr_client_resolve(Ihr_Client *client, const char *const *paths, size_t n, Image_Info *out, bool *ok);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
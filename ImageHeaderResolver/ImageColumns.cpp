@@ -0,0 +1,655 @@
+#if defined _WIN32 || defined _WIN64
+#define _CRT_SECURE_NO_WARNINGS
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "ImageHeaderResolver.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+/**
+* Layout of a columnar file, in the byte order of the machine writing it:
+*   Columns_Header
+*   Column_Descriptor[_column_count]
+*   the columns, each padded to start on a multiple of column_alignment
+* Readers find the columns by name, so columns can be added without breaking them.
+*/
+
+static const char columns_magic[8] = { 'I', 'H', 'R', 'C', 'O', 'L', 'S', '1' };
+
+static const uint32_t columns_version = 1;
+
+//Tells a file written on a machine of the other byte order.
+static const uint32_t byte_order_mark = 0x01020304;
+
+//Cache line, and the widest vector register, so any column can be loaded aligned.
+static const uint64_t column_alignment = 64;
+
+struct Columns_Header
+{
+    char _magic[8];
+    uint32_t _version;
+    uint32_t _byte_order;
+    uint64_t _file_count;
+    uint64_t _page_count;
+    uint64_t _directory_count;
+    uint32_t _column_count;
+    uint32_t _reserved32;
+    uint64_t _reserved[2];
+};
+
+struct Column_Descriptor
+{
+    char _name[24];
+    uint32_t _element_size;                     //in byte
+    uint32_t _reserved;
+    uint64_t _count;                            //number of elements
+    uint64_t _offset;                           //from the beginning of the file
+};
+
+static_assert(sizeof(Columns_Header) == 64, "the columns header is 64 bytes");
+static_assert(sizeof(Column_Descriptor) == 48, "a column descriptor is 48 bytes");
+
+enum Column_Id
+{
+    file_size_column,
+    format_column,
+    page_counts_column,
+    page_offset_column,
+    directory_column,
+    name_offset_column,
+    names_column,
+    width_column,
+    height_column,
+    color_depth_column,
+    channels_column,
+    //The dictionary of directories is kept in memory until the file is finished.
+    directory_offset_column,
+    directories_column,
+    column_count
+};
+
+//Columns streamed to temporary files as files are appended.
+static const std::size_t streamed_column_count = directory_offset_column;
+
+struct Column_Spec
+{
+    const char *_name;
+    uint32_t _element_size;
+};
+
+static const Column_Spec column_specs[column_count] =
+{
+    { "file_size", 8 },
+    { "format", 1 },
+    { "page_counts", 4 },
+    { "page_offset", 8 },
+    { "directory", 4 },
+    { "name_offset", 8 },
+    { "names", 1 },
+    { "width", 4 },
+    { "height", 4 },
+    { "color_depth", 2 },
+    { "channels", 2 },
+    { "directory_offset", 8 },
+    { "directories", 1 }
+};
+
+//The formats, the position in the table is the value.
+static const char *const format_names[] = { "", "jpeg", "bmp", "tiff", "png", "tga" };
+
+Ihr_Format ihr_format_of(const char *name)
+{
+    if(name == nullptr)
+        return IHR_FORMAT_UNKNOWN;
+
+    for(int format = IHR_FORMAT_JPEG; format <= IHR_FORMAT_TGA; ++format)
+    {
+        if(std::strcmp(name, format_names[format]) == 0)
+            return static_cast<Ihr_Format>(format);
+    }
+
+    return IHR_FORMAT_UNKNOWN;
+}
+
+const char *ihr_format_name(Ihr_Format format)
+{
+    return format >= IHR_FORMAT_JPEG && format <= IHR_FORMAT_TGA ? format_names[format] : "";
+}
+
+static inline std::size_t directory_length(std::string_view path)
+{
+#if defined _WIN32 || defined _WIN64
+    std::size_t separator = path.find_last_of("/\\");
+#else
+    std::size_t separator = path.find_last_of('/');
+#endif
+
+    return separator == std::string_view::npos ? 0 : separator + 1;
+}
+
+//Lets the dictionary of directories be searched with a string_view.
+struct Directory_Hash
+{
+    using is_transparent = void;
+
+    std::size_t operator()(std::string_view directory) const { return std::hash<std::string_view>()(directory); }
+};
+
+struct Ihr_Columns_Writer
+{
+    ~Ihr_Columns_Writer()
+    {
+        for(std::size_t i = 0; i < streamed_column_count; ++i)
+        {
+            if(_columns[i] != nullptr)
+            {
+                std::fclose(_columns[i]);
+
+                std::remove(temporary_path(i).c_str());
+            }
+        }
+    }
+
+    std::string temporary_path(std::size_t column) const { return _path + ".tmp." + column_specs[column]._name; }
+
+    template<typename T>
+    void write(std::size_t column, T value) { std::fwrite(&value, sizeof(T), 1, _columns[column]); }
+
+    std::string _path;
+    std::mutex _mutex;
+    std::FILE *_columns[streamed_column_count] = {};
+    std::vector<char> _buffers[streamed_column_count];
+
+    uint64_t _file_count = 0;
+    uint64_t _page_count = 0;
+    uint64_t _names_length = 0;
+
+    std::unordered_map<std::string, uint32_t, Directory_Hash, std::equal_to<>> _directory_ids;
+    std::vector<uint64_t> _directory_offset{0};
+    std::string _directories;
+};
+
+Ihr_Columns_Writer *ihr_columns_create(const char *columns_path)
+{
+    if(columns_path == nullptr)
+        return nullptr;
+
+    std::unique_ptr<Ihr_Columns_Writer> writer(new Ihr_Columns_Writer);
+    writer->_path = columns_path;
+
+    for(std::size_t i = 0; i < streamed_column_count; ++i)
+    {
+        writer->_columns[i] = std::fopen(writer->temporary_path(i).c_str(), "w+b");
+
+        if(writer->_columns[i] == nullptr)
+            return nullptr;
+
+        writer->_buffers[i].resize(256 * 1024);
+        std::setvbuf(writer->_columns[i], writer->_buffers[i].data(), _IOFBF, writer->_buffers[i].size());
+    }
+
+    //The offset columns start with the offset of the first file.
+    writer->write<uint64_t>(page_offset_column, 0);
+    writer->write<uint64_t>(name_offset_column, 0);
+
+    return writer.release();
+}
+
+bool ihr_columns_append(Ihr_Columns_Writer *writer, const char *path, const Image_Info *info)
+{
+    if(writer == nullptr || path == nullptr)
+        return false;
+
+    std::string_view directory(path), name;
+
+    std::size_t split = directory_length(directory);
+
+    name = directory.substr(split);
+    directory = directory.substr(0, split);
+
+    uint32_t page_count = 0;
+
+    if(info != nullptr)
+    {
+        for(const Image_Info *page = info; page != nullptr; page = page->_next)
+            ++page_count;
+    }
+
+    std::lock_guard<std::mutex> lock(writer->_mutex);
+
+    auto found = writer->_directory_ids.find(directory);
+
+    if(found == writer->_directory_ids.end())
+    {
+        if(writer->_directory_ids.size() == UINT32_MAX)
+            return false;
+
+        found = writer->_directory_ids.emplace(directory, static_cast<uint32_t>(writer->_directory_ids.size())).first;
+
+        writer->_directories.append(directory);
+        writer->_directory_offset.push_back(writer->_directories.size());
+    }
+
+    writer->_page_count += page_count;
+    writer->_names_length += name.size();
+
+    writer->write<uint64_t>(file_size_column, info != nullptr ? info->_file_size : 0);
+    writer->write<uint8_t>(format_column, static_cast<uint8_t>(info != nullptr ? ihr_format_of(info->_format) : IHR_FORMAT_UNKNOWN));
+    writer->write<uint32_t>(page_counts_column, page_count);
+    writer->write<uint64_t>(page_offset_column, writer->_page_count);
+    writer->write<uint32_t>(directory_column, found->second);
+    writer->write<uint64_t>(name_offset_column, writer->_names_length);
+
+    if(name.empty() == false)
+        std::fwrite(name.data(), 1, name.size(), writer->_columns[names_column]);
+
+    for(const Image_Info *page = page_count > 0 ? info : nullptr; page != nullptr; page = page->_next)
+    {
+        writer->write<uint32_t>(width_column, page->_width);
+        writer->write<uint32_t>(height_column, page->_height);
+        writer->write<uint16_t>(color_depth_column, page->_color_depth);
+        writer->write<uint16_t>(channels_column, page->_channels);
+    }
+
+    ++writer->_file_count;
+
+    return true;
+}
+
+static inline uint64_t align_column(uint64_t offset)
+{
+    return (offset + column_alignment - 1) / column_alignment * column_alignment;
+}
+
+/**
+* Copy a temporary column at the end of file, it must be as long as what was appended, a column
+* cut short(a full disk) would leave the file out of line with its descriptors.
+*/
+static bool copy_column(std::FILE *column, uint64_t column_length, std::FILE *file, std::vector<char> &buffer)
+{
+    if(std::ferror(column) != 0 || std::fflush(column) != 0 || std::fseek(column, 0, SEEK_SET) != 0)
+        return false;
+
+    std::size_t length;
+
+    while((length = std::fread(buffer.data(), 1, buffer.size(), column)) > 0)
+    {
+        if(length > column_length || std::fwrite(buffer.data(), 1, length, file) != length)
+            return false;
+
+        column_length -= length;
+    }
+
+    return std::ferror(column) == 0 && column_length == 0;
+}
+
+//Make a file written to temporary_path durable and rename it over path.
+static bool commit_file(std::FILE *file, const std::string &temporary_path, const std::string &path)
+{
+    bool success = std::fflush(file) == 0 && std::ferror(file) == 0;
+
+#if defined _WIN32 || defined _WIN64
+    success = success && _commit(_fileno(file)) == 0;
+#else
+    success = success && fsync(fileno(file)) == 0;
+#endif
+
+    success = std::fclose(file) == 0 && success;
+
+#if defined _WIN32 || defined _WIN64
+    //Windows does not rename over an existing file.
+    if(success)
+        std::remove(path.c_str());
+#endif
+
+    if(success == false || std::rename(temporary_path.c_str(), path.c_str()) != 0)
+    {
+        std::remove(temporary_path.c_str());
+
+        return false;
+    }
+
+#if !(defined _WIN32 || defined _WIN64)
+    //Make the rename itself durable.
+    std::size_t slash = path.find_last_of('/');
+    std::string directory = slash == std::string::npos ? "." : slash == 0 ? "/" : path.substr(0, slash);
+
+    int directory_fd = open(directory.c_str(), O_RDONLY | O_CLOEXEC);
+
+    if(directory_fd >= 0)
+    {
+        fsync(directory_fd);
+
+        close(directory_fd);
+    }
+#endif
+
+    return true;
+}
+
+bool ihr_columns_finish(Ihr_Columns_Writer *writer)
+{
+    if(writer == nullptr)
+        return false;
+
+    //The temporary columns go with the writer, whatever happens.
+    std::unique_ptr<Ihr_Columns_Writer> owner(writer);
+
+    uint64_t file_count = writer->_file_count, page_count = writer->_page_count;
+
+    uint64_t counts[column_count] =
+    {
+        file_count, file_count, file_count, file_count + 1, file_count, file_count + 1, writer->_names_length,
+        page_count, page_count, page_count, page_count,
+        writer->_directory_offset.size(), writer->_directories.size()
+    };
+
+    Columns_Header header;
+    std::memset(&header, 0, sizeof(Columns_Header));
+    std::memcpy(header._magic, columns_magic, sizeof(columns_magic));
+
+    header._version = columns_version;
+    header._byte_order = byte_order_mark;
+    header._file_count = file_count;
+    header._page_count = page_count;
+    header._directory_count = writer->_directory_ids.size();
+    header._column_count = column_count;
+
+    Column_Descriptor descriptors[column_count];
+    std::memset(descriptors, 0, sizeof(descriptors));
+
+    uint64_t offset = sizeof(Columns_Header) + sizeof(descriptors);
+
+    for(std::size_t i = 0; i < column_count; ++i)
+    {
+        std::strncpy(descriptors[i]._name, column_specs[i]._name, sizeof(descriptors[i]._name) - 1);
+
+        descriptors[i]._element_size = column_specs[i]._element_size;
+        descriptors[i]._count = counts[i];
+        descriptors[i]._offset = align_column(offset);
+
+        offset = descriptors[i]._offset + counts[i] * column_specs[i]._element_size;
+    }
+
+    std::string temporary_path = writer->_path + ".tmp";
+
+    std::FILE *file = std::fopen(temporary_path.c_str(), "wb");
+
+    if(file == nullptr)
+        return false;
+
+    std::vector<char> buffer(1 << 20);
+    std::setvbuf(file, buffer.data(), _IOFBF, buffer.size());
+
+    std::vector<char> copy_buffer(1 << 20);
+
+    static const char padding[column_alignment] = {};
+
+    bool success = std::fwrite(&header, sizeof(Columns_Header), 1, file) == 1 &&
+        std::fwrite(descriptors, sizeof(descriptors), 1, file) == 1;
+
+    offset = sizeof(Columns_Header) + sizeof(descriptors);
+
+    for(std::size_t i = 0; i < column_count && success; ++i)
+    {
+        std::size_t padding_length = static_cast<std::size_t>(descriptors[i]._offset - offset);
+
+        success = padding_length == 0 || std::fwrite(padding, 1, padding_length, file) == padding_length;
+
+        if(i < streamed_column_count)
+            success = success && copy_column(writer->_columns[i], counts[i] * column_specs[i]._element_size, file, copy_buffer);
+        else if(i == directory_offset_column)
+            success = success && std::fwrite(writer->_directory_offset.data(), sizeof(uint64_t), writer->_directory_offset.size(), file) ==
+                writer->_directory_offset.size();
+        else if(writer->_directories.empty() == false)
+            success = success && std::fwrite(writer->_directories.data(), 1, writer->_directories.size(), file) == writer->_directories.size();
+
+        offset = descriptors[i]._offset + counts[i] * column_specs[i]._element_size;
+    }
+
+    if(success == false)
+    {
+        std::fclose(file);
+
+        std::remove(temporary_path.c_str());
+
+        return false;
+    }
+
+    return commit_file(file, temporary_path, writer->_path);
+}
+
+//The mapping of an open columnar file.
+struct Columns_Storage
+{
+    const uint8_t *_data = nullptr;
+    std::size_t _length = 0;
+    void *_map = nullptr;
+    std::vector<uint8_t> _content;
+};
+
+static void release_storage(Columns_Storage *storage)
+{
+#if !(defined _WIN32 || defined _WIN64)
+    if(storage->_map != nullptr)
+        munmap(storage->_map, storage->_length);
+#endif
+
+    delete storage;
+}
+
+static bool load_storage(const char *columns_path, Columns_Storage &storage)
+{
+#if defined _WIN32 || defined _WIN64
+    std::FILE *file = std::fopen(columns_path, "rb");
+
+    if(file == nullptr)
+        return false;
+
+    bool success = _fseeki64(file, 0, SEEK_END) == 0;
+
+    int64_t length = success ? _ftelli64(file) : -1;
+
+    success = length > 0 && _fseeki64(file, 0, SEEK_SET) == 0;
+
+    if(success)
+    {
+        storage._content.resize(static_cast<std::size_t>(length));
+
+        success = std::fread(storage._content.data(), 1, storage._content.size(), file) == storage._content.size();
+    }
+
+    std::fclose(file);
+
+    storage._data = storage._content.data();
+    storage._length = storage._content.size();
+
+    return success;
+#else
+    int fd = open(columns_path, O_RDONLY | O_CLOEXEC);
+
+    if(fd < 0)
+        return false;
+
+    struct stat file_stat;
+
+    if(fstat(fd, &file_stat) != 0 || file_stat.st_size <= 0)
+    {
+        close(fd);
+
+        return false;
+    }
+
+    storage._length = static_cast<std::size_t>(file_stat.st_size);
+
+    void *map = mmap(nullptr, storage._length, PROT_READ, MAP_SHARED, fd, 0);
+
+    //The mapping stays valid once the descriptor is closed.
+    close(fd);
+
+    if(map == MAP_FAILED)
+        return false;
+
+    storage._map = map;
+    storage._data = static_cast<const uint8_t *>(map);
+
+    return true;
+#endif
+}
+
+//Find a column by name and check it lies within the file with the expected number of elements.
+static const void *find_column(const Columns_Storage &storage, const Columns_Header &header, Column_Id id, uint64_t count)
+{
+    const Column_Descriptor *descriptors = reinterpret_cast<const Column_Descriptor *>(storage._data + sizeof(Columns_Header));
+
+    const Column_Spec &spec = column_specs[id];
+
+    for(uint32_t i = 0; i < header._column_count; ++i)
+    {
+        Column_Descriptor descriptor;
+        std::memcpy(&descriptor, descriptors + i, sizeof(Column_Descriptor));
+
+        if(strnlen(descriptor._name, sizeof(descriptor._name)) == sizeof(descriptor._name) ||
+           std::strcmp(descriptor._name, spec._name) != 0)
+            continue;
+
+        if(descriptor._element_size != spec._element_size || descriptor._count != count ||
+           descriptor._offset % spec._element_size != 0 || descriptor._offset > storage._length ||
+           count > (storage._length - descriptor._offset) / spec._element_size)
+            return nullptr;
+
+        return storage._data + descriptor._offset;
+    }
+
+    return nullptr;
+}
+
+bool ihr_columns_open(const char *columns_path, Ihr_Columns *columns)
+{
+    if(columns == nullptr)
+        return false;
+
+    std::memset(columns, 0, sizeof(Ihr_Columns));
+
+    if(columns_path == nullptr)
+        return false;
+
+    std::unique_ptr<Columns_Storage, void (*)(Columns_Storage *)> storage(new Columns_Storage, release_storage);
+
+    if(load_storage(columns_path, *storage) == false || storage->_length < sizeof(Columns_Header))
+        return false;
+
+    Columns_Header header;
+    std::memcpy(&header, storage->_data, sizeof(Columns_Header));
+
+    if(std::memcmp(header._magic, columns_magic, sizeof(columns_magic)) != 0 ||
+       header._version != columns_version || header._byte_order != byte_order_mark ||
+       header._column_count > (storage->_length - sizeof(Columns_Header)) / sizeof(Column_Descriptor))
+        return false;
+
+    uint64_t file_count = header._file_count, page_count = header._page_count, directory_count = header._directory_count;
+
+    //Offset columns have one entry more, guard that against a damaged count.
+    if(file_count == UINT64_MAX || directory_count == UINT64_MAX)
+        return false;
+
+    columns->_file_size = static_cast<const uint64_t *>(find_column(*storage, header, file_size_column, file_count));
+    columns->_format = static_cast<const uint8_t *>(find_column(*storage, header, format_column, file_count));
+    columns->_page_counts = static_cast<const uint32_t *>(find_column(*storage, header, page_counts_column, file_count));
+    columns->_page_offset = static_cast<const uint64_t *>(find_column(*storage, header, page_offset_column, file_count + 1));
+    columns->_directory = static_cast<const uint32_t *>(find_column(*storage, header, directory_column, file_count));
+    columns->_name_offset = static_cast<const uint64_t *>(find_column(*storage, header, name_offset_column, file_count + 1));
+    columns->_width = static_cast<const uint32_t *>(find_column(*storage, header, width_column, page_count));
+    columns->_height = static_cast<const uint32_t *>(find_column(*storage, header, height_column, page_count));
+    columns->_color_depth = static_cast<const uint16_t *>(find_column(*storage, header, color_depth_column, page_count));
+    columns->_channels = static_cast<const uint16_t *>(find_column(*storage, header, channels_column, page_count));
+    columns->_directory_offset = static_cast<const uint64_t *>(find_column(*storage, header, directory_offset_column, directory_count + 1));
+
+    bool valid = columns->_file_size != nullptr && columns->_format != nullptr && columns->_page_counts != nullptr &&
+        columns->_page_offset != nullptr && columns->_directory != nullptr && columns->_name_offset != nullptr &&
+        columns->_width != nullptr && columns->_height != nullptr && columns->_color_depth != nullptr &&
+        columns->_channels != nullptr && columns->_directory_offset != nullptr &&
+        columns->_page_offset[file_count] == page_count;
+
+    //The string columns are as long as their last offsets tell.
+    if(valid)
+    {
+        columns->_names = static_cast<const char *>(find_column(*storage, header, names_column, columns->_name_offset[file_count]));
+        columns->_directories = static_cast<const char *>(find_column(*storage, header, directories_column,
+            columns->_directory_offset[directory_count]));
+
+        valid = columns->_names != nullptr && columns->_directories != nullptr;
+    }
+
+    if(valid == false)
+    {
+        std::memset(columns, 0, sizeof(Ihr_Columns));
+
+        return false;
+    }
+
+    columns->_file_count = file_count;
+    columns->_page_count = page_count;
+    columns->_directory_count = directory_count;
+    columns->_storage = storage.release();
+
+    return true;
+}
+
+void ihr_columns_close(Ihr_Columns *columns)
+{
+    if(columns == nullptr)
+        return;
+
+    if(columns->_storage != nullptr)
+        release_storage(static_cast<Columns_Storage *>(columns->_storage));
+
+    std::memset(columns, 0, sizeof(Ihr_Columns));
+}
+
+size_t ihr_columns_path(const Ihr_Columns *columns, uint64_t file, char *buffer, size_t capacity)
+{
+    if(buffer != nullptr && capacity > 0)
+        buffer[0] = '\0';
+
+    if(columns == nullptr || file >= columns->_file_count || columns->_directory[file] >= columns->_directory_count)
+        return 0;
+
+    //Offsets are checked, a damaged file gives no path instead of reading out of the mapping.
+    uint64_t directory_begin = columns->_directory_offset[columns->_directory[file]];
+    uint64_t directory_end = columns->_directory_offset[columns->_directory[file] + 1];
+    uint64_t name_begin = columns->_name_offset[file], name_end = columns->_name_offset[file + 1];
+
+    if(directory_begin > directory_end || directory_end > columns->_directory_offset[columns->_directory_count] ||
+       name_begin > name_end || name_end > columns->_name_offset[columns->_file_count])
+        return 0;
+
+    std::string_view directory(columns->_directories + directory_begin, static_cast<std::size_t>(directory_end - directory_begin));
+    std::string_view name(columns->_names + name_begin, static_cast<std::size_t>(name_end - name_begin));
+
+    if(buffer != nullptr && capacity > 0)
+    {
+        std::size_t directory_copied = std::min(directory.size(), capacity - 1);
+        std::size_t name_copied = std::min(name.size(), capacity - 1 - directory_copied);
+
+        std::memcpy(buffer, directory.data(), directory_copied);
+        std::memcpy(buffer + directory_copied, name.data(), name_copied);
+
+        buffer[directory_copied + name_copied] = '\0';
+    }
+
+    return directory.size() + name.size();
+}
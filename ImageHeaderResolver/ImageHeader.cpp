@@ -1,44 +1,81 @@
 #include "ImageHeader.hpp"
 #include "ImageHeaderResolver.h"
+#include "HeaderCache.hpp"
+#include "ThreadPool.hpp"
+#include <algorithm>
+#include <memory>
+#include <new>
+#ifdef IHR_HAS_CXX20
+#include <atomic>
+#include <optional>
+#endif
 
 class Image_Header::Image_Header_Impl
 {
 public:
-    Image_Header_Impl(Image_Info info) : _start_page(info), _current_page(info) {}
-    
-    ~Image_Header_Impl() { release_image_info(&_start_page); }
+    Image_Header_Impl(std::shared_ptr<const Image_Pages> pages) : _pages(std::move(pages)), _current_page(&_pages->first_page()) {}
 
-    std::size_t file_size() const { return _start_page._file_size; }
+    std::size_t file_size() const { return _pages->first_page()._file_size; }
 
-    std::string format() const { return _start_page._format; }
+    std::string format() const { return _pages->first_page()._format; }
 
-    unsigned int width() const { return _current_page._width; }
+    unsigned int width() const { return _current_page->_width; }
 
-    unsigned int height() const { return _current_page._height; }
+    unsigned int height() const { return _current_page->_height; }
 
-    unsigned int color_depth() const { return _current_page._color_depth; }
+    unsigned int color_depth() const { return _current_page->_color_depth; }
 
-    unsigned int channels() const { return _current_page._channels; }
+    unsigned int channels() const { return _current_page->_channels; }
 
-    unsigned int page_number() const { return _start_page._page_number; }
+    unsigned int page_number() const { return _pages->first_page()._page_number; }
 
     bool next_page() 
     {
-        if(_current_page._next == nullptr)
+        if(_current_page->_next == nullptr)
             return false;
 
-        _current_page = *_current_page._next;
+        _current_page = _current_page->_next;
 
         return true;
     }
 
-    void reset_page() { _current_page = _start_page;}
+    void reset_page() { _current_page = &_pages->first_page(); }
+
+    static std::shared_ptr<Image_Header> make_header(std::shared_ptr<const Image_Pages> pages)
+    {
+        std::shared_ptr<Image_Header> ret(new Image_Header);
+
+        ret->_pimpl.reset(new Image_Header_Impl(std::move(pages)));
+
+        return ret;
+    }
 
 private:
-    Image_Info _start_page;
-    Image_Info _current_page;
+    //Shared with the cache and the other headers of the file, only the current page is per header.
+    std::shared_ptr<const Image_Pages> _pages;
+    const Image_Info *_current_page;
 };
 
+//The cache of headers read by path, disabled until it is given a budget.
+static Header_Cache &header_cache()
+{
+    static Header_Cache cache(0);
+
+    return cache;
+}
+
+void Image_Header::set_cache_budget(std::size_t memory_budget)
+{
+    header_cache().set_memory_budget(memory_budget);
+}
+
+Image_Header::Cache_Stats Image_Header::cache_stats()
+{
+    Header_Cache_Stats stats = header_cache().stats();
+
+    return Cache_Stats{ stats._hits, stats._misses, stats._evictions, stats._entries, stats._bytes };
+}
+
 std::size_t Image_Header::file_size() const
 {
     return _pimpl->file_size();
@@ -84,16 +121,382 @@ void Image_Header::reset_page()
     _pimpl->reset_page();
 }
 
+static_assert(static_cast<int>(Image_Format::tga) == IHR_FORMAT_TGA, "Image_Format follows Ihr_Format");
+
+Flat_Image_Header::Flat_Image_Header(const Flat_Image_Header &other)
+{
+    *this = other;
+}
+
+Flat_Image_Header::Flat_Image_Header(Flat_Image_Header &&other) noexcept
+{
+    *this = std::move(other);
+}
+
+Flat_Image_Header &Flat_Image_Header::operator=(const Flat_Image_Header &other)
+{
+    if(this == &other)
+        return *this;
+
+    if(other._page_count > 1 && other._page_count > _page_capacity)
+    {
+        _pages.reset(new Image_Page[other._page_count]);
+        _page_capacity = other._page_count;
+    }
+
+    if(other._page_count > 1)
+        std::copy(other._pages.get(), other._pages.get() + other._page_count, _pages.get());
+
+    _file_size = other._file_size;
+    _page_count = other._page_count;
+    _format = other._format;
+    _first_page = other._first_page;
+
+    return *this;
+}
+
+Flat_Image_Header &Flat_Image_Header::operator=(Flat_Image_Header &&other) noexcept
+{
+    if(this == &other)
+        return *this;
+
+    _file_size = other._file_size;
+    _page_count = other._page_count;
+    _page_capacity = other._page_capacity;
+    _format = other._format;
+    _first_page = other._first_page;
+    _pages = std::move(other._pages);
+
+    other._page_count = 0;
+    other._page_capacity = 0;
+
+    return *this;
+}
+
+std::string_view Flat_Image_Header::format_name() const
+{
+    return empty() ? std::string_view() : ihr_format_name(static_cast<Ihr_Format>(_format));
+}
+
+void Flat_Image_Header::clear()
+{
+    _file_size = 0;
+    _page_count = 0;
+    _format = Image_Format::unknown;
+    _first_page = {};
+}
+
+bool Flat_Image_Header::assign(const Image_Info &info) noexcept
+{
+    std::size_t count = 0;
+
+    for(const Image_Info *page = &info; page != nullptr; page = page->_next)
+        ++count;
+
+    if(count > 1 && count > _page_capacity)
+    {
+        //Grown to the largest file read, like the buffers of a context.
+        _pages.reset(new(std::nothrow) Image_Page[count]);
+        _page_capacity = _pages != nullptr ? static_cast<std::uint32_t>(count) : 0;
+
+        if(_pages == nullptr)
+        {
+            clear();
+
+            return false;
+        }
+    }
+
+    Image_Page *pages = count > 1 ? _pages.get() : &_first_page;
+
+    for(const Image_Info *page = &info; page != nullptr; page = page->_next)
+        *pages++ = Image_Page{ page->_width, page->_height, page->_color_depth, page->_channels };
+
+    if(count > 1)
+        _first_page = _pages[0];
+
+    _file_size = info._file_size;
+    _page_count = static_cast<std::uint32_t>(count);
+    _format = static_cast<Image_Format>(ihr_format_of(info._format));
+
+    return true;
+}
+
+/**
+* The context of the thread reading into flat headers, the pages of a file only live in its arena
+* until they are copied, so reads make no allocation once the context is warm.
+*/
+static Ihr_Context *thread_context()
+{
+    thread_local std::unique_ptr<Ihr_Context, void (*)(Ihr_Context *)> context(ihr_context_create(nullptr), ihr_context_destroy);
+
+    return context.get();
+}
+
+bool Flat_Image_Header::try_read(const std::string &img_path, Flat_Image_Header &header) noexcept
+{
+    Header_Cache &cache = header_cache();
+
+    Ihr_File_Key key;
+
+    bool cached = cache.memory_budget() > 0 && ihr_file_key(img_path.c_str(), &key);
+
+    header.clear();
+
+    //The cache allocates its entries, running out of memory there fails the read.
+    try
+    {
+        if(cached)
+        {
+            if(std::shared_ptr<const Image_Pages> pages = cache.find(img_path, key))
+                return header.assign(pages->first_page());
+
+            Image_Info info;
+
+            if(get_image_info(img_path.c_str(), &info) == false)
+                return false;
+
+            auto pages = std::make_shared<const Image_Pages>(info);
+
+            cache.insert(img_path, key, pages);
+
+            return header.assign(pages->first_page());
+        }
+    }
+    catch(const std::bad_alloc &)
+    {
+        return false;
+    }
+
+    Ihr_Context *context = thread_context();
+
+    if(context == nullptr)
+        return false;
+
+    Image_Info info;
+
+    bool success = get_image_info_ctx(context, img_path.c_str(), &info) && header.assign(info);
+
+    ihr_context_reset(context);
+
+    return success;
+}
+
+/**
+* The executor asynchronous reads run on. Resolving mostly waits for the disk, so it has more threads
+* than processors, but a fixed number of them however many reads are in flight.
+*/
+static Thread_Pool &io_executor()
+{
+    static Thread_Pool pool(std::max(4u, 2 * std::thread::hardware_concurrency()));
+
+    return pool;
+}
+
+std::future<std::shared_ptr<Image_Header>> Image_Header::read_image_async(const std::string &img_path)
+{
+    auto promise = std::make_shared<std::promise<std::shared_ptr<Image_Header>>>();
+
+    std::future<std::shared_ptr<Image_Header>> ret = promise->get_future();
+
+    io_executor().submit([promise, img_path]
+    {
+        promise->set_value(read_image(img_path));
+    });
+
+    return ret;
+}
+
 std::shared_ptr<Image_Header> Image_Header::read_image(const std::string &img_path)
 {
+    Header_Cache &cache = header_cache();
+
+    Ihr_File_Key key;
+
+    bool cached = cache.memory_budget() > 0 && ihr_file_key(img_path.c_str(), &key);
+
+    if(cached)
+    {
+        if(std::shared_ptr<const Image_Pages> pages = cache.find(img_path, key))
+            return Image_Header_Impl::make_header(std::move(pages));
+    }
+
     Image_Info info;
     
     if(get_image_info(img_path.c_str(), &info) == false)
         return nullptr;
 
-    std::shared_ptr<Image_Header> ret(new Image_Header);
+    auto pages = std::make_shared<const Image_Pages>(info);
+
+    if(cached)
+        cache.insert(img_path, key, pages);
+
+    return Image_Header_Impl::make_header(std::move(pages));
+}
+
+#ifdef IHR_HAS_CXX20
+std::shared_ptr<Image_Header> Image_Header::read_image(std::span<const std::byte> image_data)
+{
+    Image_Info info;
+
+    if(get_image_info_from_memory(reinterpret_cast<const uint8_t *>(image_data.data()), image_data.size(), &info) == false)
+        return nullptr;
+
+    return Image_Header_Impl::make_header(std::make_shared<const Image_Pages>(info));
+}
+
+std::vector<std::shared_ptr<Image_Header>> Image_Header::read_images(std::span<const std::string> file_paths, unsigned int thread_count)
+{
+    Header_Cache &cache = header_cache();
+
+    bool cached = cache.memory_budget() > 0;
+
+    std::vector<std::shared_ptr<Image_Header>> ret(file_paths.size());
+
+    //Only the files missing from the cache go to the batch, positions maps them back.
+    std::vector<const char *> paths;
+    std::vector<std::size_t> positions;
+    std::vector<Ihr_File_Key> keys(cached ? file_paths.size() : 0);
+    std::vector<bool> keyed(keys.size());
+
+    for(std::size_t i = 0; i < file_paths.size(); ++i)
+    {
+        if(cached && ihr_file_key(file_paths[i].c_str(), &keys[i]))
+        {
+            keyed[i] = true;
+
+            if(std::shared_ptr<const Image_Pages> pages = cache.find(file_paths[i], keys[i]))
+            {
+                ret[i] = Image_Header_Impl::make_header(std::move(pages));
+
+                continue;
+            }
+        }
+
+        paths.push_back(file_paths[i].c_str());
+        positions.push_back(i);
+    }
+
+    std::vector<Image_Info> infos(paths.size());
+
+    //std::vector<bool> is not contiguous.
+    std::unique_ptr<bool[]> ok(new bool[paths.size() + 1]);
+
+    Ihr_Batch_Options options = {};
+    options._thread_count = thread_count;
+
+    get_image_info_batch(paths.data(), paths.size(), infos.data(), ok.get(), &options);
+
+    for(std::size_t i = 0; i < infos.size(); ++i)
+    {
+        if(ok[i] == false)
+            continue;
 
-    ret->_pimpl.reset(new Image_Header_Impl(info));
+        std::size_t position = positions[i];
+
+        auto pages = std::make_shared<const Image_Pages>(infos[i]);
+
+        if(cached && keyed[position])
+            cache.insert(file_paths[position], keys[position], pages);
+
+        ret[position] = Image_Header_Impl::make_header(std::move(pages));
+    }
 
     return ret;
 }
+
+bool Flat_Image_Header::try_read(std::span<const std::byte> image_data, Flat_Image_Header &header) noexcept
+{
+    header.clear();
+
+    Ihr_Context *context = thread_context();
+
+    if(context == nullptr)
+        return false;
+
+    Image_Info info;
+
+    bool success = get_image_info_from_memory_ctx(context, reinterpret_cast<const uint8_t *>(image_data.data()), image_data.size(), &info) &&
+        header.assign(info);
+
+    ihr_context_reset(context);
+
+    return success;
+}
+
+struct Image_Header::Read_Awaitable::State
+{
+    std::string _file_path;
+    Executor _executor;
+    std::stop_token _stop;
+    std::shared_ptr<Image_Header> _result;
+    std::coroutine_handle<> _handle;
+
+    //Set by whichever of the read and the stop request comes first, only that one resumes.
+    std::atomic<bool> _completed{false};
+
+    std::optional<std::stop_callback<std::function<void()>>> _on_stop;
+};
+
+//Resume the awaiting coroutine once, through its executor if it has one.
+void Image_Header::Read_Awaitable::complete(const std::shared_ptr<State> &state, std::shared_ptr<Image_Header> result)
+{
+    if(state->_completed.exchange(true))
+        return;
+
+    state->_result = std::move(result);
+
+    if(state->_executor)
+        state->_executor([state] { state->_handle.resume(); });
+    else
+        state->_handle.resume();
+}
+
+Image_Header::Read_Awaitable Image_Header::read_image_async(const std::string &img_path, Executor executor, std::stop_token stop)
+{
+    auto state = std::make_shared<Read_Awaitable::State>();
+    state->_file_path = img_path;
+    state->_executor = std::move(executor);
+    state->_stop = std::move(stop);
+
+    return Read_Awaitable(std::move(state));
+}
+
+void Image_Header::Read_Awaitable::await_suspend(std::coroutine_handle<> handle)
+{
+    _state->_handle = handle;
+
+    std::shared_ptr<State> state = _state;
+
+    //The read is submitted before the stop callback is set, a stop already requested completes at once.
+    io_executor().submit([state]
+    {
+        if(state->_completed.load() || state->_stop.stop_requested())
+        {
+            complete(state, nullptr);
+
+            return;
+        }
+
+        complete(state, read_image(state->_file_path));
+    });
+
+    //The coroutine may already be resumed and this awaitable gone, only the local state is used from here.
+    if(state->_stop.stop_possible())
+    {
+        //A weak pointer, the callback belongs to the state and must not keep it alive.
+        std::weak_ptr<State> weak_state = state;
+
+        state->_on_stop.emplace(state->_stop, [weak_state]
+        {
+            if(std::shared_ptr<State> state = weak_state.lock())
+                complete(state, nullptr);
+        });
+    }
+}
+
+std::shared_ptr<Image_Header> Image_Header::Read_Awaitable::await_resume()
+{
+    return std::move(_state->_result);
+}
+#endif
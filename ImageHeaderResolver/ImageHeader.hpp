@@ -1,13 +1,84 @@
 #pragma once
 
+#include <cstdint>
 #include <string>
+#include <string_view>
 #include <memory>
+#include <vector>
+#include <functional>
+#include <future>
+
+#if __cplusplus >= 202002L || (defined _MSVC_LANG && _MSVC_LANG >= 202002L)
+#define IHR_HAS_CXX20 1
+#include <cstddef>
+#include <span>
+#include <coroutine>
+#include <stop_token>
+#endif
 
 class Image_Header
 {
 public:
+	/**
+	* @brief posts a function to run on the caller's event loop 将函数投递至调用方的事件循环中执行
+	*/
+	using Executor = std::function<void(std::function<void()>)>;
+
+	/**@brief counters of the header cache 头信息缓存的统计数据*/
+	struct Cache_Stats
+	{
+		std::uint64_t _hits;        //lookups answered by the cache 命中次数
+		std::uint64_t _misses;      //lookups of files not cached or changed 未命中次数
+		std::uint64_t _evictions;   //entries evicted to stay within the budget 为满足内存预算而淘汰的条目数
+		std::uint64_t _entries;     //entries cached 当前缓存的条目数
+		std::uint64_t _bytes;       //bytes the entries take 当前条目占用的字节数
+	};
+
+	/**
+	* @brief cache the headers read by path, a file unchanged(same inode, size and modification time) is not resolved
+	* again and its headers share the pages cached 缓存按路径读取的头信息，未改动的文件（inode、大小与修改时间均相同）
+	* 不再重复解析，其头信息共享缓存中的分页数据
+	* @param[in] memory_budget bytes the cache may take, 0 to disable it(the default) 缓存可占用的字节数，为0时关闭缓存（默认）
+	*/
+	static void set_cache_budget(std::size_t memory_budget);
+
+	static Cache_Stats cache_stats();
+
 	static std::shared_ptr<Image_Header> read_image(const std::string &file_path);
 
+	/**
+	* @brief resolve an image file on the internal I/O executor, the result is nullptr if it fails
+	* 在内部I/O线程池中解析图片文件，解析失败时结果为nullptr
+	*/
+	static std::future<std::shared_ptr<Image_Header>> read_image_async(const std::string &file_path);
+
+#ifdef IHR_HAS_CXX20
+	/**
+	* @brief resolve an image file already loaded in memory, the bytes are read in place
+	* 解析已载入内存的图片文件，直接读取原数据而不拷贝
+	*/
+	static std::shared_ptr<Image_Header> read_image(std::span<const std::byte> image_data);
+
+	/**
+	* @brief resolve many image files on a pool of threads, the result of a file failed to resolve is nullptr
+	* 使用线程池批量解析图片文件，解析失败的文件对应的结果为nullptr
+	* @param[in] thread_count number of threads, 0 for one per hardware thread 线程数量，为0时与硬件线程数一致
+	*/
+	static std::vector<std::shared_ptr<Image_Header>> read_images(std::span<const std::string> file_paths, unsigned int thread_count = 0);
+
+	class Read_Awaitable;
+
+	/**
+	* @brief resolve an image file on the internal I/O executor, co_await the result
+	* 在内部I/O线程池中解析图片文件，使用co_await获取结果
+	* @details the awaiting coroutine is resumed through executor, or on the I/O thread if it is empty;
+	* the result is nullptr if the file fails to resolve or stop is requested before it is resolved
+	* 等待的协程通过executor恢复执行（executor为空时在I/O线程中恢复）；
+	* 解析失败，或在解析完成前请求了取消时，结果为nullptr
+	*/
+	static Read_Awaitable read_image_async(const std::string &file_path, Executor executor, std::stop_token stop = {});
+#endif
+
 	/**@brief file size(in byte) 图片文件大小（以字节计）*/
 	std::size_t file_size() const;
 
@@ -49,4 +120,128 @@ private:
 	class Image_Header_Impl;
 
 	std::unique_ptr<Image_Header_Impl> _pimpl;
-};
\ No newline at end of file
+};
+
+#ifdef IHR_HAS_CXX20
+class Image_Header::Read_Awaitable
+{
+public:
+	bool await_ready() const noexcept { return false; }
+
+	void await_suspend(std::coroutine_handle<> handle);
+
+	std::shared_ptr<Image_Header> await_resume();
+
+private:
+	friend class Image_Header;
+
+	struct State;
+
+	static void complete(const std::shared_ptr<State> &state, std::shared_ptr<Image_Header> result);
+
+	explicit Read_Awaitable(std::shared_ptr<State> state) : _state(std::move(state)) {}
+
+	std::shared_ptr<State> _state;
+};
+#endif
+
+//Image_Info of the C interface.
+struct Image_Header_Info;
+
+/**@brief image formats, same values as Ihr_Format 图片格式，取值与Ihr_Format一致*/
+enum class Image_Format : std::uint8_t
+{
+	unknown,
+	jpeg,
+	bmp,
+	tiff,
+	png,
+	tga
+};
+
+/**@brief a page of an image 图片的一页*/
+struct Image_Page
+{
+	std::uint32_t _width;           //image width(in pixel) 图片宽度（以像素计）
+	std::uint32_t _height;          //image height(in pixel) 图片高度（以像素计）
+	std::uint16_t _color_depth;     //number of bits each pixel takes 单个像素占用的位数
+	std::uint16_t _channels;        //number of channels 通道数
+};
+
+/**
+* @brief the header of an image held by value, its pages stored contiguously, the first one inside
+* the object, so single page images take no memory beyond it 以值形式持有的图片头信息，各页连续存放，
+* 首页位于对象内部，单页图片不占用对象之外的内存
+* @details reading into a header already used reuses its storage, a thread reading file after file
+* into the same header stops allocating once warm 读取至已使用过的对象时复用其存储，
+* 同一线程持续读取至同一对象时，预热后不再分配内存
+*/
+class Flat_Image_Header
+{
+public:
+	Flat_Image_Header() = default;
+
+	Flat_Image_Header(const Flat_Image_Header &other);
+	Flat_Image_Header(Flat_Image_Header &&other) noexcept;
+
+	Flat_Image_Header &operator=(const Flat_Image_Header &other);
+	Flat_Image_Header &operator=(Flat_Image_Header &&other) noexcept;
+
+	/**
+	* @brief resolve an image file into header, the header cache is used as read_image does
+	* 解析图片文件至header，与read_image一样使用头信息缓存
+	* @return false if the file fails to resolve, header is left empty 解析失败时返回false，header被置空
+	*/
+	static bool try_read(const std::string &file_path, Flat_Image_Header &header) noexcept;
+
+#ifdef IHR_HAS_CXX20
+	/**@brief resolve an image file already loaded in memory into header 解析已载入内存的图片文件至header*/
+	static bool try_read(std::span<const std::byte> image_data, Flat_Image_Header &header) noexcept;
+
+	std::span<const Image_Page> pages() const { return { page_data(), _page_count }; }
+#endif
+
+	/**@brief whether no image is held(never read, or the last read failed) 是否未持有图片（从未读取或上次读取失败）*/
+	bool empty() const { return _page_count == 0; }
+
+	/**@brief file size(in byte) 图片文件大小（以字节计）*/
+	std::uint64_t file_size() const { return _file_size; }
+
+	/**@brief image format(the format resolved) 图片格式（以实际解析的格式为准）*/
+	Image_Format format() const { return _format; }
+
+	/**@brief name of the image format, "" when empty 图片格式名称，为空时返回""*/
+	std::string_view format_name() const;
+
+	/**@brief number of pages 分页数量*/
+	unsigned int page_count() const { return _page_count; }
+
+	/**@brief page i, i below page_count() 第i页，i须小于page_count()*/
+	const Image_Page &page(std::size_t i) const { return page_data()[i]; }
+
+	//Of the first page. 首页的属性
+	unsigned int width() const { return _first_page._width; }
+	unsigned int height() const { return _first_page._height; }
+	unsigned int color_depth() const { return _first_page._color_depth; }
+	unsigned int channels() const { return _first_page._channels; }
+
+	/**@brief make the header empty, its storage is kept 置空，保留存储*/
+	void clear();
+
+private:
+	const Image_Page *page_data() const { return _page_count > 1 ? _pages.get() : &_first_page; }
+
+	//Take the pages of info, false if they fail to be allocated.
+	bool assign(const Image_Header_Info &info) noexcept;
+
+private:
+	std::uint64_t _file_size = 0;
+	std::uint32_t _page_count = 0;
+
+	//Pages _pages holds, the first page is copied there too when there are several.
+	std::uint32_t _page_capacity = 0;
+
+	Image_Format _format = Image_Format::unknown;
+	Image_Page _first_page = {};
+	std::unique_ptr<Image_Page[]> _pages;
+};
@@ -1,15 +1,11 @@
 #if defined _WIN32 || defined _WIN64
-#define seek_file(file, offset, pos) _fseeki64(file, offset, pos)
-#define tell_file(file) _ftelli64(file)
 #define _CRT_SECURE_NO_WARNINGS
-#else
-#define seek_file(file, offset, pos) fseeko(file, offset, pos)
-#define tell_file(file) ftello(file)
-#define _FILE_OFFSET_BITS 64
 #endif
 
 #include "ImageHeaderResolver.h"
-#include "TiffFunctionTemplate.h"
+#include "ImageSource.h"
+#include "MarkerScanner.h"
+#include "TiffParser.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -58,70 +54,57 @@ static inline void change_endian_32_bit(void *addr)
 		(u32 >> 24 & 0xff);
 }
 
-static inline void change_endian_64_bit(void *addr)
+static inline uint16_t load_16_bit(const uint8_t *addr, bool is_same_endian)
 {
-	uint64_t u64 = *(uint64_t *)addr;
-	*(uint64_t *)addr = 
-		(u64 << 56 & 0xff00000000000000) |
-	 	(u64 << 48 & 0xff000000000000) |
-		(u64 << 40 & 0xff0000000000) |
-		(u64 << 32 & 0xff00000000) |
-		(u64 >> 32 & 0xff000000) |
-		(u64 >> 40 & 0xff0000) |
-		(u64 >> 48 & 0xff00) |
-		(u64 >> 56 & 0xff);
-}
+	uint16_t u16;
+	memcpy(&u16, addr, sizeof(uint16_t));
 
-static inline void initialize_image_info(Image_Info *info)
-{
-	memset(info, 0, sizeof(Image_Info));
+	if(is_same_endian == false)
+		change_endian_16_bit(&u16);
+
+	return u16;
 }
 
-static inline FILE *load_image_file(
-	size_t *file_size_ptr,
-	const char *image_path)
+static inline uint32_t load_32_bit(const uint8_t *addr, bool is_same_endian)
 {
-	FILE *file = fopen(image_path, "rb");
-
-	if (file == NULL)
-		perror(image_path);
-	else
-	{
-		seek_file(file, 0, SEEK_END);
-
-		*file_size_ptr = (size_t)tell_file(file);
+	uint32_t u32;
+	memcpy(&u32, addr, sizeof(uint32_t));
 
-		seek_file(file, 0, SEEK_SET);
-	}
+	if(is_same_endian == false)
+		change_endian_32_bit(&u32);
 
-	return file;
+	return u32;
 }
 
-static inline void terminate(FILE *file)
+static inline void initialize_image_info(Image_Info *info)
 {
-	if (fclose(file) != 0)
-		perror("problem occurs when closing image file");
+	memset(info, 0, sizeof(Image_Info));
 }
 
-static Format resolve_image_format(FILE *file)
+static Format resolve_image_format(Ihr_Source *source)
 {
-	seek_file(file, 0, SEEK_SET);
+	uint8_t scratch[20];
+	const uint8_t *buffer = ihr_source_view(source, 0, 20, scratch);
 
-	uint8_t buffer[20];
-	if(fread(buffer, 1, 20, file) != 20)
+	if(buffer == NULL)
 		return IHR_FMT_UNDEF;
 
-	seek_file(file, 0, SEEK_SET);
+	uint16_t byte_order_mark = 0, tif_version = 0;
+	memcpy(&byte_order_mark, buffer, sizeof(uint16_t));
+	memcpy(&tif_version, buffer + 2, sizeof(uint16_t));
+
+	uint64_t png_signature = 0;
+	memcpy(&png_signature, buffer, sizeof(uint64_t));
 
 	if (buffer[0] == 0xff && buffer[1] == 0xd8)
 		return IHR_FMT_JPEG;
 	else if (buffer[0] == 0x42 && buffer[1] == 0x4d)
 		return IHR_FMT_BMP;
-	else if ((*((uint16_t*)buffer) == 18761/*II little endian*/ || *((uint16_t*)buffer) == 19789)/*MM big endian*/ &&
-	(*((uint16_t*)(buffer + 2)) == 42 || *((uint16_t*)(buffer + 2)) == 10752/*42 normal tif*/ ||
-	 *((uint16_t*)(buffer + 2)) == 43 || *((uint16_t*)(buffer + 2)) == 11008)/*43 big tif*/)
+	else if ((byte_order_mark == 18761/*II little endian*/ || byte_order_mark == 19789)/*MM big endian*/ &&
+	(tif_version == 42 || tif_version == 10752/*42 normal tif*/ ||
+	 tif_version == 43 || tif_version == 11008)/*43 big tif*/)
 		return IHR_FMT_TIFF;
-	else if (*((uint64_t *)buffer) == 0x89504e470d0a1a0a || *((uint64_t *)buffer) == 0x0a1a0a0d474e5089)
+	else if (png_signature == 0x89504e470d0a1a0a || png_signature == 0x0a1a0a0d474e5089)
 		return IHR_FMT_PNG;
 	else if ((buffer[1] == 0 || buffer[1] == 1) /*color map type*/&& 
 	(buffer[2] == 1 || buffer[2] == 2 || buffer[2] == 3 ||
@@ -133,35 +116,260 @@ static Format resolve_image_format(FILE *file)
 		return IHR_FMT_UNDEF;
 }
 
-static bool resolve_jpeg(
+//Size of the first block read after the jpeg walk jumps over a segment.
+#define IHR_JPEG_BLOCK_SIZE 512
+
+//Blocks grow up to this size while the walk keeps scanning forward(padding, garbage).
+#define IHR_JPEG_MAX_BLOCK_SIZE 65536
+
+//Pages of the arena of a context, chunks stay linked in the order they are used.
+typedef struct Page_Chunk
+{
+	struct Page_Chunk   *_next;
+	Image_Info          *_pages;
+	size_t              _capacity;
+} Page_Chunk;
+
+//Number of pages of the first chunk the arena allocates, every next chunk is twice as large, up to the max.
+#define IHR_MIN_PAGE_CHUNK 64
+
+#define IHR_MAX_PAGE_CHUNK 4096
+
+struct Ihr_Context
+{
+	Page_Chunk      _first;                     //over the pages given by the caller, empty if none
+	Page_Chunk      *_current;                  //the chunk pages are taken from
+	size_t          _used;                      //number of pages taken from _current
+	Tiff_Buffers    _tiff_buffers;              //kept from one resolve to the next
+	uint8_t         *_jpeg_scratch;             //IHR_JPEG_MAX_BLOCK_SIZE bytes, allocated once a walk needs it
+};
+
+//Take a page from the arena, the next chunk is allocated only when every chunk so far is used up.
+static Image_Info *allocate_context_page(Ihr_Context *context)
+{
+	while (context->_used == context->_current->_capacity)
+	{
+		if (context->_current->_next == NULL)
+		{
+			size_t capacity = context->_current->_capacity * 2;
+
+			if (capacity < IHR_MIN_PAGE_CHUNK)
+				capacity = IHR_MIN_PAGE_CHUNK;
+			else if (capacity > IHR_MAX_PAGE_CHUNK)
+				capacity = IHR_MAX_PAGE_CHUNK;
+
+			Page_Chunk *chunk = (Page_Chunk *)malloc(sizeof(Page_Chunk) + capacity * sizeof(Image_Info));
+
+			if (chunk == NULL)
+				return NULL;
+
+			chunk->_next = NULL;
+			chunk->_pages = (Image_Info *)(chunk + 1);
+			chunk->_capacity = capacity;
+
+			context->_current->_next = chunk;
+		}
+
+		context->_current = context->_current->_next;
+		context->_used = 0;
+	}
+
+	return context->_current->_pages + context->_used++;
+}
+
+static inline uint8_t *acquire_jpeg_scratch(Ihr_Source *source)
+{
+	Ihr_Context *context = source->_context;
+
+	if (context == NULL)
+		return (uint8_t *)malloc(IHR_JPEG_MAX_BLOCK_SIZE);
+
+	if (context->_jpeg_scratch == NULL)
+		context->_jpeg_scratch = (uint8_t *)malloc(IHR_JPEG_MAX_BLOCK_SIZE);
+
+	return context->_jpeg_scratch;
+}
+
+static inline void release_jpeg_scratch(Ihr_Source *source, uint8_t *scratch)
+{
+	//The scratch of a context stays with it.
+	if (source->_context == NULL)
+		free(scratch);
+}
+
+/**
+* Bytes of the jpeg stream are handed out from a block, so scanning for symbol marks costs
+* one read per block instead of one per byte. The block points into the source directly when
+* the bytes are already in memory(an addressable source, or the probe).
+* Segment lengths move the position without reading anything, the block grows only while
+* the walk scans forward through the stream.
+*/
+typedef struct Jpeg_Cursor
+{
+	Ihr_Source      *_source;
+	const uint8_t   *_block;
+	uint64_t        _block_pos;
+	size_t          _block_length;
+	size_t          _next_block_size;                   //size of the next block read from the file
+	uint8_t         *_large_scratch;                    //allocated once the blocks outgrow _scratch
+	uint8_t         _scratch[IHR_JPEG_BLOCK_SIZE];
+} Jpeg_Cursor;
+
+static inline void initialize_jpeg_cursor(
+	Jpeg_Cursor *cursor,
+	Ihr_Source *source)
+{
+	cursor->_source = source;
+	cursor->_block = NULL;
+	cursor->_block_pos = 0;
+	cursor->_block_length = 0;
+	cursor->_next_block_size = IHR_JPEG_BLOCK_SIZE;
+	cursor->_large_scratch = NULL;
+}
+
+static bool load_jpeg_block(
+	Jpeg_Cursor *cursor,
+	uint64_t position)
+{
+	if(position >= cursor->_block_pos && position - cursor->_block_pos < cursor->_block_length)
+		return true;
+
+	Ihr_Source *source = cursor->_source;
+
+	if(position >= source->_size)
+		return false;
+
+	//Going on right after the previous block means the walk is scanning, read bigger blocks.
+	if(cursor->_block_length != 0 && position == cursor->_block_pos + cursor->_block_length)
+	{
+		cursor->_next_block_size <<= 3;
+
+		if(cursor->_next_block_size > IHR_JPEG_MAX_BLOCK_SIZE)
+			cursor->_next_block_size = IHR_JPEG_MAX_BLOCK_SIZE;
+	}
+	else
+		cursor->_next_block_size = IHR_JPEG_BLOCK_SIZE;
+
+	uint64_t rest = source->_size - position;
+	size_t length = rest < cursor->_next_block_size ? (size_t)rest : cursor->_next_block_size;
+
+	uint8_t *scratch = cursor->_scratch;
+
+	//Bytes already in memory are walked through at once.
+	size_t buffered_length = ihr_source_buffered_length(source, position);
+
+	if(buffered_length != 0)
+		length = buffered_length;
+	else if(ihr_source_is_addressable(source) == true)
+		length = 1;/*Beyond what a window source holds, the view only marks it as starved.*/
+	else if(length > IHR_JPEG_BLOCK_SIZE)
+	{
+		if(cursor->_large_scratch == NULL)
+			cursor->_large_scratch = acquire_jpeg_scratch(source);
+
+		if(cursor->_large_scratch != NULL)
+			scratch = cursor->_large_scratch;
+		else
+			length = IHR_JPEG_BLOCK_SIZE;
+	}
+
+	cursor->_block = ihr_source_view(source, position, length, scratch);
+	cursor->_block_pos = position;
+	cursor->_block_length = cursor->_block == NULL ? 0 : length;
+
+	return cursor->_block != NULL;
+}
+
+static inline int read_source_byte(
+	Jpeg_Cursor *cursor,
+	uint64_t *position)
+{
+	if(load_jpeg_block(cursor, *position) == false)
+		return EOF;
+
+	return cursor->_block[(*position)++ - cursor->_block_pos];
+}
+
+static inline bool read_source_bytes(
+	Jpeg_Cursor *cursor,
+	uint64_t position,
+	size_t length,
+	uint8_t *buffer)
+{
+	for(size_t i = 0; i != length; ++i)
+	{
+		int byte = read_source_byte(cursor, &position);
+
+		if(byte == EOF)
+			return false;
+
+		buffer[i] = (uint8_t)byte;
+	}
+
+	return true;
+}
+
+/**
+* Move position to the next 0xff byte, whole blocks are scanned at once.
+* Return false when the end of the stream is reached without finding one.
+*/
+static bool scan_jpeg_marker(
+	Jpeg_Cursor *cursor,
+	uint64_t *position)
+{
+	while(load_jpeg_block(cursor, *position) == true)
+	{
+		const uint8_t *block_end = cursor->_block + cursor->_block_length;
+
+		const uint8_t *found = ihr_scan_marker(cursor->_block + (*position - cursor->_block_pos), block_end);
+
+		*position = cursor->_block_pos + (uint64_t)(found - cursor->_block);
+
+		if(found != block_end)
+			return true;
+	}
+
+	return false;
+}
+
+/**
+* Walk the jpeg segments from *position until the first top-level SOF segment is resolved.
+* When the walk stops because a window source has no more bytes yet, *position is left where
+* the walk can go on from once more bytes arrive, the bytes before it are never needed again.
+*/
+static void walk_jpeg_segments(
 	Image_Info *info,
-	FILE *file,
-	const Endian sys_endian)
+	Ihr_Source *source,
+	uint64_t *position,
+	bool is_same_endian)
 {
-	//jpeg file header is always stored as big endian.
-	bool is_same_endian = sys_endian == IHR_ENDIAN_BIG;
+	Jpeg_Cursor cursor;
+	initialize_jpeg_cursor(&cursor, source);
 
-	//Jump the leading SOI(aka Start Of Image) symbol.
-	seek_file(file, 2, SEEK_SET);
+	uint64_t walker = *position;
 
 	int byte = 0;
 
-	while (feof(file) == false)
+	while (true)
 	{
-		byte = fgetc(file);
+		//Go to the next jpeg symbol mark indicator.
+		bool found = scan_jpeg_marker(&cursor, &walker);
 
-		if(byte == EOF)
+		*position = walker;
+
+		if(found == false)
 			break;
 
-		//jpeg symbol mark indicator.
-		if(byte != 0xff)
-			continue;
+		++walker;
 
 		//Skip the possible padding bytes.
 		do
 		{
-			byte = fgetc(file);
+			byte = read_source_byte(&cursor, &walker);
 		}while(byte == 0xff);
+
+		if(byte == EOF)
+			break;
 		
 		//Jump invalid symbol marks.
 		if(byte == 0x00)
@@ -201,40 +409,52 @@ static bool resolve_jpeg(
 		*/
 		if((byte & 0xf0) != 0xc0 || byte == 0xc4)
 		{
-			uint16_t length = 0;
+			uint8_t length_bytes[2];
 
-			if(fread(&length, sizeof(uint16_t), 1, file) != 1)
+			if(read_source_bytes(&cursor, walker, 2, length_bytes) == false)
 				break;
 
-			if(is_same_endian == false)
-				change_endian_16_bit(&length);
+			uint16_t length = load_16_bit(length_bytes, is_same_endian);
 
-			if(seek_file(file, length - 2, SEEK_CUR) != 0)
+			//The segment length counts the length bytes themselves.
+			if(length < 2)
 				break;
 
+			walker += length;
+
 			continue;
 		}
 
 		uint8_t sof[8];
 
-		if(fread(sof, 1, 8, file) != 8)
+		if(read_source_bytes(&cursor, walker, 8, sof) == false)
 			break;
 
-		info->_color_depth = *(uint8_t *)(sof + 2);
-		info->_height = *(uint16_t *)(sof + 3);
-		info->_width = *(uint16_t *)(sof + 5);
-		info->_channels=*(uint8_t *)(sof + 7);
-
-		if(is_same_endian == false)
-		{
-			change_endian_16_bit(&info->_width);
-			change_endian_16_bit(&info->_height);
-		}
+		info->_color_depth = sof[2];
+		info->_height = load_16_bit(sof + 3, is_same_endian);
+		info->_width = load_16_bit(sof + 5, is_same_endian);
+		info->_channels = sof[7];
 
 		//Stop resolving when the first top-level SOF segment is read.
 		break;
 	}
 
+	release_jpeg_scratch(source, cursor._large_scratch);
+}
+
+static bool resolve_jpeg(
+	Image_Info *info,
+	Ihr_Source *source,
+	const Endian sys_endian)
+{
+	//jpeg file header is always stored as big endian.
+	bool is_same_endian = sys_endian == IHR_ENDIAN_BIG;
+
+	//Jump the leading SOI(aka Start Of Image) symbol.
+	uint64_t position = 2;
+
+	walk_jpeg_segments(info, source, &position, is_same_endian);
+
 	info->_color_depth = info->_color_depth * info->_channels;
 
 	return true;
@@ -242,42 +462,32 @@ static bool resolve_jpeg(
 
 static bool resolve_bmp(
 	Image_Info *info,
-	FILE *file,
+	Ihr_Source *source,
 	const Endian sys_endian)
 {
 	//bmp file header is always stored as little endian.
 	bool is_same_endian = sys_endian == IHR_ENDIAN_LITTLE;
 
 	//The bmp file header is organized as fixed data and offset.
-	seek_file(file, 2, SEEK_SET);
-
-	uint32_t file_size;
-	if (fread(&file_size, sizeof(uint32_t), 1, file) != 1)
+	uint8_t file_size_scratch[4];
+	const uint8_t *file_size_data = ihr_source_view(source, 2, 4, file_size_scratch);
+	if (file_size_data == NULL)
 		return false;
 
-	if(is_same_endian == false)
-		change_endian_32_bit(&file_size);
+	uint32_t file_size = load_32_bit(file_size_data, is_same_endian);
 
 	//If the real file size is smaller the resolved file size, abort resolving.
 	if (info->_file_size < file_size)
 		return false;
 
-	seek_file(file, 18, SEEK_SET);
-
-	uint8_t header_data[12];
-	if (fread(header_data, 1, 12, file) != 12)
+	uint8_t header_scratch[12];
+	const uint8_t *header_data = ihr_source_view(source, 18, 12, header_scratch);
+	if (header_data == NULL)
 		return false;
 
-	info->_width = *(uint32_t *)(header_data);
-	info->_height = *(uint32_t *)(header_data + 4);
-	info->_color_depth = *(uint16_t *)(header_data + 10);
-
-	if (is_same_endian == false)
-	{
-		change_endian_32_bit(&info->_width);
-		change_endian_32_bit(&info->_height);
-		change_endian_16_bit(&info->_color_depth);
-	}
+	info->_width = load_32_bit(header_data, is_same_endian);
+	info->_height = load_32_bit(header_data + 4, is_same_endian);
+	info->_color_depth = load_16_bit(header_data + 10, is_same_endian);
 
 	if (info->_color_depth <= 8)
 		info->_channels = 1;
@@ -289,87 +499,106 @@ static bool resolve_bmp(
 	return true;
 }
 
-//Use macro to create tif resolving functions.
-create_tiff_function_instance(normal_tif, 32, 16, 12)
-
-create_tiff_function_instance(big_tif, 64, 64, 20)
-
-static bool resolve_tif(
+bool ihr_append_tif_page(
 	Image_Info *info,
-	FILE *file, 
-	const Endian sys_endian)
+	Image_Info **current_page_ptr,
+	const Image_Info *page,
+	Ihr_Context *context)
 {
-	seek_file(file, 0, SEEK_SET);
-
-	uint8_t file_header[4];
-	if(fread(file_header, 1, 4, file)!=4)
-		return false;
-
-	//The resolved order of tif file.
-	Endian file_endian = file_header[0] == 0x49 && file_header[1] == 0x49 ? IHR_ENDIAN_LITTLE : IHR_ENDIAN_BIG;
-	bool is_same_endian = sys_endian == file_endian;
-
-    bool is_big_tif = file_header[2] == 0x2b || file_header[3] == 0x2b;
+	if(*current_page_ptr == NULL)
+	{
+		/*The first page.*/
+		info->_width = page->_width;
+		info->_height = page->_height;
+		info->_color_depth = page->_color_depth;
+		info->_channels = page->_channels;
 
-	if(is_big_tif == true)
+		*current_page_ptr = info;
+	}
+	else
 	{
-		//Skip the 0x00000008
-		if(seek_file(file, 4, SEEK_CUR) != 0)
-			return false;
+		/*The following pages.*/
+		Image_Info *image_free_memory_ptr = context != NULL ? allocate_context_page(context) :
+			(Image_Info *)malloc(sizeof(Image_Info));
 
-		uint64_t first_ifd_pos = 0;
+		if(image_free_memory_ptr == NULL)
+		{
+			perror("can not allocate memory for image page.");
 
-		if(fread(&first_ifd_pos, sizeof(uint64_t), 1, file) != 1)
 			return false;
+		}
 
-		if(is_same_endian == false)
-			change_endian_64_bit(&first_ifd_pos);
+		*image_free_memory_ptr = *page;
 
-		//Locate to first image directory.
-		if(seek_file(file, (int64_t)first_ifd_pos, SEEK_SET) != 0)
-			return false;
+		(*current_page_ptr)->_next = image_free_memory_ptr;
 
-		return resolve_big_tif(info, file, is_same_endian);
+		*current_page_ptr = image_free_memory_ptr;
 	}
+
+	return true;
+}
+
+void ihr_acquire_tiff_buffers(
+	Ihr_Source *source,
+	Tiff_Buffers *buffers)
+{
+	if (source->_context != NULL)
+		*buffers = source->_context->_tiff_buffers;
+	else
+		memset(buffers, 0, sizeof(Tiff_Buffers));
+}
+
+void ihr_release_tiff_buffers(
+	Ihr_Source *source,
+	Tiff_Buffers *buffers)
+{
+	//A context keeps them, grown as they may be, for the next resolve.
+	if (source->_context != NULL)
+		source->_context->_tiff_buffers = *buffers;
 	else
 	{
-		uint32_t first_ifd_pos = 0;
+		free(buffers->_entry_list);
+		free(buffers->_content);
+	}
 
-		if(fread(&first_ifd_pos, sizeof(uint32_t), 1, file) != 1)
-			return false;
+	memset(buffers, 0, sizeof(Tiff_Buffers));
+}
+
+//The byte order of a tif is told by its header, the parser of the file is picked from it.
+static bool resolve_tif(
+	Image_Info *info,
+	Ihr_Source *source, 
+	const Endian sys_endian)
+{
+	(void)sys_endian;
 
-		if(is_same_endian == false)
-			change_endian_32_bit(&first_ifd_pos);
+	const Tiff_Parser *parser = NULL;
 
-		//Locate to first image directory.
-		if(seek_file(file, (int64_t)first_ifd_pos, SEEK_SET) != 0)
-            return false;
+	uint64_t first_ifd_pos = 0;
+
+	if(ihr_tiff_resolve_header(source, &parser, &first_ifd_pos) == false)
+		return false;
 
-        return resolve_normal_tif(info, file, is_same_endian);
-    }
+	return parser->_resolve_pages(info, source, first_ifd_pos);
 }
 
 static bool resolve_png(
 	Image_Info *info,
-	FILE *file,
+	Ihr_Source *source,
 	const Endian sys_endian)
 {
 	//png file header is always stored as big endian.
 	bool is_same_endian = sys_endian == IHR_ENDIAN_BIG;
 
-	//Skip the fixed leading bytes.
-	seek_file(file, 8, SEEK_SET);
+	//The IHDR(aka Image Header) section data, after the fixed leading bytes.
+	uint8_t scratch[25];
+	const uint8_t *IHDR = ihr_source_view(source, 8, 25, scratch);
 
-	//The IHDR(aka Image Header) section data buffer.
-	uint8_t IHDR[25];
-
-	if(fread(IHDR, 1, 25, file) != 25)
+	if(IHDR == NULL)
 		return false;
 
 	//The first 4 byte of IHDR must be number 13.
-	uint32_t data_number = *(uint32_t *)IHDR;
-	if(is_same_endian == false)
-		change_endian_32_bit(&data_number);
+	uint32_t data_number = load_32_bit(IHDR, is_same_endian);
 	if(data_number != 13)
 		return false;
 
@@ -379,10 +608,10 @@ static bool resolve_png(
 		return false;
 
 	//Image width is stored in the next 4 byte.
-	info->_width = *(uint32_t *)(IHDR + 8);
+	info->_width = load_32_bit(IHDR + 8, is_same_endian);
 
 	//Image height is stored after image width another 4 bytes.
-	info->_height = *(uint32_t *)(IHDR + 12);
+	info->_height = load_32_bit(IHDR + 12, is_same_endian);
 
 	//Color bit depth takes 1 byte after image height.
 	info->_color_depth = *(IHDR + 16);
@@ -407,12 +636,6 @@ static bool resolve_png(
 			break;
 	}
 
-	if(is_same_endian == false)
-	{
-		change_endian_32_bit(&info->_width);
-		change_endian_32_bit(&info->_height);
-	}
-
 	info->_color_depth = info->_color_depth * info->_channels;
 
 	return true;
@@ -420,14 +643,15 @@ static bool resolve_png(
 
 static bool resolve_tga(
 	Image_Info *info,
-	FILE *file,
+	Ihr_Source *source,
 	const Endian sys_endian)
 {
 	bool is_same_endian = sys_endian == IHR_ENDIAN_LITTLE;
 
-	uint8_t header[20];
+	uint8_t scratch[20];
+	const uint8_t *header = ihr_source_view(source, 0, 20, scratch);
 
-	if(fread(header, 1, 20, file) != 20)
+	if(header == NULL)
 		return false;
 
 	uint8_t color_depth = header[16];
@@ -478,17 +702,9 @@ static bool resolve_tga(
 
 	info->_color_depth = color_depth;
 
-	uint16_t width = *(uint16_t *)(header + 12);
-	if(is_same_endian == false)
-		change_endian_16_bit(&width);
-
-	info->_width = width;
+	info->_width = load_16_bit(header + 12, is_same_endian);
 
-	uint16_t height = *(uint16_t *)(header + 14);
-	if(is_same_endian == false)
-		change_endian_16_bit(&height);
-
-	info->_height = height;
+	info->_height = load_16_bit(header + 14, is_same_endian);
 
 	return true;
 }
@@ -498,7 +714,7 @@ static bool resolve_tga(
 * represents the number of defined formats, and the value of each format label is just the
 * corresponding index in the _resolve_func_array.
 */
-static bool(*_resolve_func_array[NUM_OF_SUPPORTED_FORMATS])(Image_Info *, FILE *, const Endian) =
+static bool(*_resolve_func_array[NUM_OF_SUPPORTED_FORMATS])(Image_Info *, Ihr_Source *, const Endian) =
 {
 	&resolve_jpeg,
 	&resolve_bmp,
@@ -531,21 +747,28 @@ static inline void convert_format_string(const Format format, char *string)
 	}
 }
 
-static inline bool resolve_image_file(
-	FILE *file,
-	Image_Info *image_info)
+//Drop the pages following the first one, those taken from a context go back with the context.
+static inline void drop_following_pages(
+	Image_Info *image_info,
+	const Ihr_Context *context)
 {
-	Format image_format = IHR_FMT_UNDEF;
-	if ((image_format = resolve_image_format(file)) == IHR_FMT_UNDEF)
-		return false;
-
-	Endian sys_endian = check_endian();
-
-	bool success = _resolve_func_array[image_format](image_info, file, sys_endian);
+	if (context == NULL)
+		release_image_info(image_info);
+}
 
+/**
+* Set up the data shared by all pages once the resolver of image_format is done, and check the
+* result. The page list is released when anything is wrong.
+*/
+static bool finish_image_info(
+	const Format image_format,
+	Image_Info *image_info,
+	bool success,
+	const Ihr_Context *context)
+{
 	if(success == false)
 	{
-		release_image_info(image_info);
+		drop_following_pages(image_info, context);
 
 		initialize_image_info(image_info);
 
@@ -585,7 +808,7 @@ static inline bool resolve_image_file(
 
 	if(is_image_info_valid(image_info) == false)
 	{
-		release_image_info(image_info);
+		drop_following_pages(image_info, context);
 
 		initialize_image_info(image_info);
 
@@ -595,36 +818,1009 @@ static inline bool resolve_image_file(
 	return true;
 }
 
+bool ihr_finish_tif_pages(
+	Image_Info *info,
+	uint64_t file_size)
+{
+	info->_file_size = file_size;
+
+	return finish_image_info(IHR_FMT_TIFF, info, true, NULL);
+}
+
+bool ihr_resolve_source(
+	Ihr_Source *source,
+	Image_Info *image_info)
+{
+	image_info->_file_size = source->_size;
+
+	if (source->_size == 0ULL)
+		return false;
+
+	//The probe is shared by the format detection and the resolvers.
+	if (ihr_source_probe(source) == false)
+		return false;
+
+	Format image_format = IHR_FMT_UNDEF;
+	if ((image_format = resolve_image_format(source)) == IHR_FMT_UNDEF)
+		return false;
+
+	//Walking the directories of a large tif touches many small places all over the file, which is
+	//cheaper through a mapping than through a read for each of them.
+	if (image_format == IHR_FMT_TIFF && source->_size >= IHR_MAP_THRESHOLD)
+		ihr_source_map(source);
+
+	Endian sys_endian = check_endian();
+
+	bool success = _resolve_func_array[image_format](image_info, source, sys_endian);
+
+	return finish_image_info(image_format, image_info, success, source->_context);
+}
+
 bool get_image_info(
 	const char *img_path,
 	Image_Info *image_info)
 {
+	return get_image_info_stats(img_path, image_info, NULL);
+}
+
+bool get_image_info_stats(
+	const char *img_path,
+	Image_Info *image_info,
+	Ihr_Io_Stats *stats)
+{
+	if(stats != NULL)
+		memset(stats, 0, sizeof(Ihr_Io_Stats));
+
 	if(image_info == NULL)
 		return false;
 
 	initialize_image_info(image_info);
 
-	FILE *file = load_image_file(&image_info->_file_size, img_path);
+	Ihr_Source source;
 
-	if (file == NULL)
+	if (ihr_source_open_file(&source, img_path, true) == false)
 		return false;
 
-	if(image_info->_file_size == 0ULL)
-	{
-		terminate(file);
-		
-		return false;
-	}
-	
 	//We do not want to close the file in every return point of the entry
 	//function, so we put the resolving operations into another function.
-	bool success = resolve_image_file(file, image_info);
+	bool success = ihr_resolve_source(&source, image_info);
+
+	if(stats != NULL)
+	{
+		stats->_read_calls = source._read_calls;
+		stats->_bytes_read = source._bytes_read;
+	}
 
-	terminate(file);
+	ihr_source_close(&source);
 
 	return success;
 }
 
+bool get_image_info_fd(
+	int fd,
+	Image_Info *image_info)
+{
+	if(image_info == NULL)
+		return false;
+
+	initialize_image_info(image_info);
+
+	Ihr_Source source;
+
+	if (ihr_source_from_fd(&source, fd) == false)
+		return false;
+
+	bool success = ihr_resolve_source(&source, image_info);
+
+	ihr_source_close(&source);
+
+	return success;
+}
+
+bool get_image_info_from_memory(
+	const uint8_t *data,
+	size_t len,
+	Image_Info *out)
+{
+	if(out == NULL)
+		return false;
+
+	initialize_image_info(out);
+
+	if(data == NULL || len == 0)
+		return false;
+
+	Ihr_Source source;
+
+	ihr_source_from_memory(&source, data, len);
+
+	return ihr_resolve_source(&source, out);
+}
+
+bool get_image_info_reader(
+	const Ihr_Reader *reader,
+	void *ctx,
+	Image_Info *image_info)
+{
+	return get_image_info_plan(reader, ctx, image_info, NULL);
+}
+
+bool get_image_info_plan(
+	const Ihr_Reader *reader,
+	void *ctx,
+	Image_Info *image_info,
+	Ihr_Read_Plan *plan)
+{
+	if(plan != NULL)
+		plan->_count = 0;
+
+	if(image_info == NULL)
+		return false;
+
+	initialize_image_info(image_info);
+
+	Ihr_Source source;
+
+	if (ihr_source_from_reader(&source, reader, ctx) == false)
+		return false;
+
+	source._plan = plan;
+
+	bool success = ihr_resolve_source(&source, image_info);
+
+	ihr_source_close(&source);
+
+	return success;
+}
+
+Ihr_Context *ihr_context_create(const Ihr_Context_Options *opts)
+{
+	Ihr_Context *context = (Ihr_Context *)calloc(1, sizeof(Ihr_Context));
+
+	if(context == NULL)
+		return NULL;
+
+	if(opts != NULL && opts->_pages != NULL)
+	{
+		context->_first._pages = opts->_pages;
+		context->_first._capacity = opts->_page_capacity;
+	}
+
+	context->_current = &context->_first;
+
+	return context;
+}
+
+void ihr_context_destroy(Ihr_Context *ctx)
+{
+	if(ctx == NULL)
+		return;
+
+	Page_Chunk *chunk = ctx->_first._next;
+
+	while(chunk != NULL)
+	{
+		Page_Chunk *next = chunk->_next;
+
+		free(chunk);
+
+		chunk = next;
+	}
+
+	free(ctx->_tiff_buffers._entry_list);
+	free(ctx->_tiff_buffers._content);
+	free(ctx->_jpeg_scratch);
+	free(ctx);
+}
+
+void ihr_context_reset(Ihr_Context *ctx)
+{
+	if(ctx == NULL)
+		return;
+
+	ctx->_current = &ctx->_first;
+	ctx->_used = 0;
+}
+
+/**
+* Resolve a source set up by the caller through a context, the pages a failing resolve took are
+* given back to the arena at once.
+*/
+static bool resolve_source_in_context(
+	Ihr_Context *ctx,
+	Ihr_Source *source,
+	Image_Info *image_info)
+{
+	Page_Chunk *chunk = ctx->_current;
+	size_t used = ctx->_used;
+
+	source->_context = ctx;
+
+	bool success = ihr_resolve_source(source, image_info);
+
+	if(success == false)
+	{
+		ctx->_current = chunk;
+		ctx->_used = used;
+	}
+
+	return success;
+}
+
+bool get_image_info_ctx(
+	Ihr_Context *ctx,
+	const char *img_path,
+	Image_Info *image_info)
+{
+	if(image_info == NULL)
+		return false;
+
+	initialize_image_info(image_info);
+
+	Ihr_Source source;
+
+	if(ctx == NULL || ihr_source_open_file(&source, img_path, false) == false)
+		return false;
+
+	bool success = resolve_source_in_context(ctx, &source, image_info);
+
+	ihr_source_close(&source);
+
+	return success;
+}
+
+bool get_image_info_fd_ctx(
+	Ihr_Context *ctx,
+	int fd,
+	Image_Info *image_info)
+{
+	if(image_info == NULL)
+		return false;
+
+	initialize_image_info(image_info);
+
+	Ihr_Source source;
+
+	if(ctx == NULL || ihr_source_from_fd(&source, fd) == false)
+		return false;
+
+	bool success = resolve_source_in_context(ctx, &source, image_info);
+
+	ihr_source_close(&source);
+
+	return success;
+}
+
+bool get_image_info_from_memory_ctx(
+	Ihr_Context *ctx,
+	const uint8_t *data,
+	size_t len,
+	Image_Info *out)
+{
+	if(out == NULL)
+		return false;
+
+	initialize_image_info(out);
+
+	if(ctx == NULL || data == NULL || len == 0)
+		return false;
+
+	Ihr_Source source;
+
+	ihr_source_from_memory(&source, data, len);
+
+	return resolve_source_in_context(ctx, &source, out);
+}
+
+bool get_image_info_reader_ctx(
+	Ihr_Context *ctx,
+	const Ihr_Reader *reader,
+	void *reader_ctx,
+	Image_Info *image_info)
+{
+	if(image_info == NULL)
+		return false;
+
+	initialize_image_info(image_info);
+
+	Ihr_Source source;
+
+	if(ctx == NULL || ihr_source_from_reader(&source, reader, reader_ctx) == false)
+		return false;
+
+	bool success = resolve_source_in_context(ctx, &source, image_info);
+
+	ihr_source_close(&source);
+
+	return success;
+}
+
+//Directories the offset index of a tif page list holds before it first grows.
+#define IHR_MIN_PAGE_INDEX 16
+
+struct Ihr_Tiff_Pages
+{
+	Ihr_Source          _source;
+	bool                _is_tif;                //false for the single page of the other formats
+	const Tiff_Parser   *_parser;
+	Tiff_Buffers        _buffers;               //owned, kept from one page to the next
+	uint64_t            *_offsets;              //offsets of the directories found, in list order
+	size_t              _found;                 //number of directories found
+	size_t              _capacity;              //capacity of _offsets
+	uint64_t            _next_pos;              //where the directory after the last found is, if _next_known
+	bool                _next_known;
+	bool                _complete;              //whether the end of the list is reached
+	bool                _broken;                //whether a directory failed to be read or the list loops
+	Ifd_Cycle_Check     _cycle_check;
+	Image_Info          _first;
+};
+
+//Set up what a page shares with the others, the page count is known once the end of the list is.
+static void finish_tiff_page(
+	const Ihr_Tiff_Pages *pages,
+	Image_Info *page)
+{
+	page->_file_size = pages->_source._size;
+	convert_format_string(IHR_FMT_TIFF, page->_format);
+	page->_page_number = pages->_complete == true ? (uint32_t)pages->_found : 0;
+	page->_next = NULL;
+}
+
+/**
+* Find the directory after the last one found, reading only its entry count and next offset(at
+* most two reads), and add it to the index.
+* @return true if one is found, false at the end of the list or when it is broken
+*/
+static bool find_next_tiff_page(Ihr_Tiff_Pages *pages)
+{
+	if(pages->_complete == true || pages->_broken == true)
+		return false;
+
+	Ihr_Source *source = &pages->_source;
+
+	uint64_t last_pos = pages->_offsets[pages->_found - 1];
+
+	if(pages->_next_known == false)
+	{
+		if(pages->_parser->_read_next_ifd_pos(source, last_pos, &pages->_next_pos) == false)
+		{
+			pages->_broken = true;
+
+			return false;
+		}
+	}
+
+	uint64_t next_pos = pages->_next_pos;
+
+	//The same end as the one of a full resolve.
+	if(next_pos == 0 || next_pos >= source->_size)
+	{
+		pages->_complete = true;
+		pages->_first._page_number = (uint32_t)pages->_found;
+
+		return false;
+	}
+
+	if(ifd_list_loops(&pages->_cycle_check, next_pos))
+	{
+		pages->_broken = true;
+
+		return false;
+	}
+
+	if(pages->_found == pages->_capacity)
+	{
+		size_t capacity = pages->_capacity * 2;
+
+		uint64_t *offsets = (uint64_t *)realloc(pages->_offsets, capacity * sizeof(uint64_t));
+
+		if(offsets == NULL)
+		{
+			pages->_broken = true;
+
+			return false;
+		}
+
+		pages->_offsets = offsets;
+		pages->_capacity = capacity;
+	}
+
+	pages->_offsets[pages->_found++] = next_pos;
+	pages->_next_known = false;
+
+	return true;
+}
+
+//Resolve the first page of the source of pages, which is set up.
+static bool open_tiff_pages(Ihr_Tiff_Pages *pages)
+{
+	Ihr_Source *source = &pages->_source;
+
+	initialize_image_info(&pages->_first);
+
+	pages->_first._file_size = source->_size;
+
+	if(source->_size == 0ULL || ihr_source_probe(source) == false)
+		return false;
+
+	Format image_format = resolve_image_format(source);
+
+	if(image_format == IHR_FMT_UNDEF)
+		return false;
+
+	if(image_format != IHR_FMT_TIFF)
+	{
+		pages->_found = 1;
+		pages->_complete = true;
+
+		return ihr_resolve_source(source, &pages->_first);
+	}
+
+	if(source->_size >= IHR_MAP_THRESHOLD)
+		ihr_source_map(source);
+
+	uint64_t first_ifd_pos = 0;
+
+	if(ihr_tiff_resolve_header(source, &pages->_parser, &first_ifd_pos) == false)
+		return false;
+
+	pages->_offsets = (uint64_t *)malloc(IHR_MIN_PAGE_INDEX * sizeof(uint64_t));
+
+	if(pages->_offsets == NULL)
+		return false;
+
+	pages->_is_tif = true;
+	pages->_capacity = IHR_MIN_PAGE_INDEX;
+	pages->_offsets[0] = first_ifd_pos;
+	pages->_found = 1;
+
+	start_ifd_cycle_check(&pages->_cycle_check, first_ifd_pos);
+
+	if(pages->_parser->_resolve_ifd(source, first_ifd_pos, &pages->_first, &pages->_next_pos, &pages->_buffers) == false)
+		return false;
+
+	pages->_next_known = true;
+
+	finish_tiff_page(pages, &pages->_first);
+
+	return is_image_info_valid(&pages->_first);
+}
+
+Ihr_Tiff_Pages *ihr_tiff_pages_open(const char *img_path)
+{
+	Ihr_Tiff_Pages *pages = (Ihr_Tiff_Pages *)calloc(1, sizeof(Ihr_Tiff_Pages));
+
+	if(pages == NULL)
+		return NULL;
+
+	if(ihr_source_open_file(&pages->_source, img_path, true) == false)
+	{
+		free(pages);
+
+		return NULL;
+	}
+
+	if(open_tiff_pages(pages) == false)
+	{
+		ihr_tiff_pages_close(pages);
+
+		return NULL;
+	}
+
+	return pages;
+}
+
+Ihr_Tiff_Pages *ihr_tiff_pages_open_reader(
+	const Ihr_Reader *reader,
+	void *ctx)
+{
+	Ihr_Tiff_Pages *pages = (Ihr_Tiff_Pages *)calloc(1, sizeof(Ihr_Tiff_Pages));
+
+	if(pages == NULL)
+		return NULL;
+
+	if(ihr_source_from_reader(&pages->_source, reader, ctx) == false)
+	{
+		free(pages);
+
+		return NULL;
+	}
+
+	if(open_tiff_pages(pages) == false)
+	{
+		ihr_tiff_pages_close(pages);
+
+		return NULL;
+	}
+
+	return pages;
+}
+
+void ihr_tiff_pages_close(Ihr_Tiff_Pages *pages)
+{
+	if(pages == NULL)
+		return;
+
+	ihr_source_close(&pages->_source);
+
+	free(pages->_buffers._entry_list);
+	free(pages->_buffers._content);
+	free(pages->_offsets);
+	free(pages);
+}
+
+const Image_Info *ihr_tiff_pages_first(const Ihr_Tiff_Pages *pages)
+{
+	return &pages->_first;
+}
+
+size_t ihr_tiff_pages_found(const Ihr_Tiff_Pages *pages)
+{
+	return pages->_found;
+}
+
+bool ihr_tiff_pages_get(
+	Ihr_Tiff_Pages *pages,
+	size_t index,
+	Image_Info *page)
+{
+	if(page == NULL)
+		return false;
+
+	initialize_image_info(page);
+
+	if(index == 0)
+	{
+		*page = pages->_first;
+		page->_next = NULL;
+
+		return true;
+	}
+
+	if(pages->_is_tif == false)
+		return false;
+
+	while(index >= pages->_found && find_next_tiff_page(pages) == true)
+		continue;
+
+	if(index >= pages->_found)
+		return false;
+
+	uint64_t next_pos = 0;
+
+	if(pages->_parser->_resolve_ifd(&pages->_source, pages->_offsets[index], page, &next_pos, &pages->_buffers) == false)
+	{
+		initialize_image_info(page);
+
+		return false;
+	}
+
+	//Saves the first read of finding the next directory.
+	if(index == pages->_found - 1 && pages->_complete == false)
+	{
+		pages->_next_pos = next_pos;
+		pages->_next_known = true;
+	}
+
+	finish_tiff_page(pages, page);
+
+	return true;
+}
+
+bool ihr_tiff_pages_count(
+	Ihr_Tiff_Pages *pages,
+	size_t *count)
+{
+	while(find_next_tiff_page(pages) == true)
+		continue;
+
+	if(pages->_broken == true)
+		return false;
+
+	*count = pages->_found;
+
+	return true;
+}
+
+//The largest number of bytes a stream keeps buffered while waiting for what it needs.
+#define IHR_STREAM_MAX_BUFFER (16u << 20)
+
+//Bytes kept before what a tif directory reads, for the values some writers put right before their directory.
+#define IHR_STREAM_TIFF_LOOK_BEHIND (64u << 10)
+
+//Stages of resolving a stream.
+typedef enum Stream_Stage
+{
+	IHR_STAGE_FORMAT,                           //waiting for the bytes telling the format
+	IHR_STAGE_HEADER,                           //waiting for the fixed header of png, bmp, tga
+	IHR_STAGE_JPEG,                             //walking the jpeg segments
+	IHR_STAGE_TIFF_HEADER,                      //waiting for the tif file header
+	IHR_STAGE_TIFF,                             //walking the tif image file directories
+	IHR_STAGE_FINISHED
+} Stream_Stage;
+
+struct Ihr_Stream
+{
+	uint64_t            _size;                  //size of the whole stream, UINT64_MAX if unknown
+	uint64_t            _offset;                //stream offset of the first buffered byte
+	uint8_t             *_buffer;               //bytes kept from the stream
+	size_t              _length;                //number of bytes kept
+	size_t              _capacity;              //capacity of _buffer
+	uint64_t            _skip;                  //number of upcoming bytes not needed
+	bool                _ended;                 //whether the end of the stream is fed
+	Ihr_Stream_Status   _status;
+	Stream_Stage        _stage;
+	Format              _format;
+	uint64_t            _resume;                //where the jpeg walk or the next tif directory is
+	uint64_t            _tiff_keep_from;        //lowest offset the tif directory being resolved reads
+	bool                _taken;                 //whether the result was handed over
+	const Tiff_Parser   *_tiff_parser;          //picked from the tif header
+	Ifd_Cycle_Check     _cycle_check;           //of the tif directory list
+	Image_Info          *_current_page_ptr;     //last page of the tif page list
+	Image_Info          _info;
+};
+
+Ihr_Stream *ihr_stream_create(uint64_t expected_size)
+{
+	Ihr_Stream *stream = (Ihr_Stream *)malloc(sizeof(Ihr_Stream));
+
+	if(stream == NULL)
+	{
+		perror("can not allocate memory for image stream.");
+
+		return NULL;
+	}
+
+	stream->_buffer = NULL;
+	stream->_capacity = 0;
+
+	initialize_image_info(&stream->_info);
+
+	ihr_stream_reset(stream, expected_size);
+
+	return stream;
+}
+
+void ihr_stream_reset(
+	Ihr_Stream *stream,
+	uint64_t expected_size)
+{
+	release_image_info(&stream->_info);
+	initialize_image_info(&stream->_info);
+
+	stream->_size = expected_size == 0 ? UINT64_MAX : expected_size;
+	stream->_offset = 0;
+	stream->_length = 0;
+	stream->_skip = 0;
+	stream->_ended = false;
+	stream->_status = IHR_STREAM_NEED_MORE;
+	stream->_stage = IHR_STAGE_FORMAT;
+	stream->_format = IHR_FMT_UNDEF;
+	stream->_resume = 0;
+	stream->_tiff_keep_from = 0;
+	stream->_taken = false;
+	stream->_tiff_parser = NULL;
+	stream->_current_page_ptr = NULL;
+}
+
+void ihr_stream_destroy(Ihr_Stream *stream)
+{
+	if(stream == NULL)
+		return;
+
+	release_image_info(&stream->_info);
+
+	free(stream->_buffer);
+
+	free(stream);
+}
+
+static void finish_stream(
+	Ihr_Stream *stream,
+	bool success)
+{
+	//The size of a stream of unknown size is what has been seen of it so far.
+	stream->_info._file_size = stream->_size != UINT64_MAX ? stream->_size : stream->_offset + stream->_length;
+
+	success = finish_image_info(stream->_format, &stream->_info, success, NULL);
+
+	stream->_status = success == true ? IHR_STREAM_DONE : IHR_STREAM_ERROR;
+	stream->_stage = IHR_STAGE_FINISHED;
+}
+
+/**
+* Run the stages as far as the bytes buffered allow. A stage that runs out of bytes leaves the
+* stream waiting for more, it is run again from where it stopped on the next feed.
+*/
+static void advance_stream(Ihr_Stream *stream)
+{
+	Ihr_Source window;
+	ihr_source_from_window(&window, stream->_buffer, stream->_length, stream->_offset, stream->_size);
+
+	Endian sys_endian = check_endian();
+
+	while(stream->_stage != IHR_STAGE_FINISHED)
+	{
+		window._starved = false;
+		window._lowest_offset = UINT64_MAX;
+
+		if(stream->_stage == IHR_STAGE_FORMAT)
+		{
+			stream->_format = resolve_image_format(&window);
+
+			if(window._starved == true)
+				return;
+
+			if(stream->_format == IHR_FMT_UNDEF)
+				finish_stream(stream, false);
+			else if(stream->_format == IHR_FMT_JPEG)
+			{
+				//Jump the leading SOI(aka Start Of Image) symbol.
+				stream->_resume = 2;
+				stream->_stage = IHR_STAGE_JPEG;
+			}
+			else if(stream->_format == IHR_FMT_TIFF)
+				stream->_stage = IHR_STAGE_TIFF_HEADER;
+			else
+				stream->_stage = IHR_STAGE_HEADER;
+		}
+		else if(stream->_stage == IHR_STAGE_HEADER)
+		{
+			//Resolvers may check the declared size against the real one, which is not known yet.
+			initialize_image_info(&stream->_info);
+			stream->_info._file_size = stream->_size;
+
+			bool success = _resolve_func_array[stream->_format](&stream->_info, &window, sys_endian);
+
+			if(window._starved == true)
+				return;
+
+			finish_stream(stream, success);
+		}
+		else if(stream->_stage == IHR_STAGE_JPEG)
+		{
+			//jpeg file header is always stored as big endian.
+			walk_jpeg_segments(&stream->_info, &window, &stream->_resume, sys_endian == IHR_ENDIAN_BIG);
+
+			if(window._starved == true)
+				return;
+
+			stream->_info._color_depth = stream->_info._color_depth * stream->_info._channels;
+
+			finish_stream(stream, true);
+		}
+		else if(stream->_stage == IHR_STAGE_TIFF_HEADER)
+		{
+			bool success = ihr_tiff_resolve_header(&window, &stream->_tiff_parser, &stream->_resume);
+
+			if(window._starved == true)
+				return;
+
+			if(success == false)
+				finish_stream(stream, false);
+			else
+			{
+				start_ifd_cycle_check(&stream->_cycle_check, stream->_resume);
+
+				stream->_stage = IHR_STAGE_TIFF;
+			}
+		}
+		else if(stream->_stage == IHR_STAGE_TIFF)
+		{
+			//Nothing is allocated, the window source is addressable.
+			Tiff_Buffers buffers;
+			memset(&buffers, 0, sizeof(Tiff_Buffers));
+
+			Image_Info page;
+
+			uint64_t next_ifd_pos = 0;
+
+			bool success = stream->_tiff_parser->_resolve_ifd(&window, stream->_resume, &page, &next_ifd_pos, &buffers);
+
+			//The directory is resolved again from the start once more bytes arrive, so the bytes it
+			//read are still needed, the ones well before are not.
+			if(window._starved == true)
+			{
+				uint64_t lowest = window._lowest_offset < stream->_resume ? window._lowest_offset : stream->_resume;
+
+				stream->_tiff_keep_from = lowest > IHR_STREAM_TIFF_LOOK_BEHIND ? lowest - IHR_STREAM_TIFF_LOOK_BEHIND : 0;
+
+				return;
+			}
+
+			if(success == false ||
+			   ihr_append_tif_page(&stream->_info, &stream->_current_page_ptr, &page, NULL) == false)
+			{
+				finish_stream(stream, false);
+			}
+			else if(next_ifd_pos == 0 || next_ifd_pos >= stream->_size)
+				finish_stream(stream, true);
+			else if(ifd_list_loops(&stream->_cycle_check, next_ifd_pos))
+				finish_stream(stream, false);
+			else
+				stream->_resume = next_ifd_pos;
+		}
+	}
+}
+
+/**
+* Drop the buffered bytes before the position the jpeg walk goes on from, or before the lowest
+* offset the tif directory being resolved reads(less the look behind). A tif directory or value
+* pointing back into the bytes dropped fails the stream.
+*/
+static void discard_stream_bytes(Ihr_Stream *stream)
+{
+	uint64_t keep_from = 0;
+
+	if(stream->_stage == IHR_STAGE_JPEG)
+		keep_from = stream->_resume;
+	else if(stream->_stage == IHR_STAGE_TIFF)
+		keep_from = stream->_tiff_keep_from;
+
+	if(keep_from <= stream->_offset)
+		return;
+
+	uint64_t buffer_end = stream->_offset + stream->_length;
+
+	if(keep_from >= buffer_end)
+	{
+		//Nothing buffered is needed, and the bytes up to keep_from need not even be fed.
+		stream->_skip = keep_from - buffer_end;
+		stream->_length = 0;
+	}
+	else
+	{
+		size_t dropped = (size_t)(keep_from - stream->_offset);
+
+		memmove(stream->_buffer, stream->_buffer + dropped, stream->_length - dropped);
+
+		stream->_length -= dropped;
+	}
+
+	stream->_offset = keep_from;
+}
+
+//Append bytes to the buffer of the stream, the stream fails if they can not be held.
+static bool append_stream_bytes(
+	Ihr_Stream *stream,
+	const uint8_t *bytes,
+	size_t length)
+{
+	if(stream->_length + length > stream->_capacity)
+	{
+		size_t capacity = stream->_capacity == 0 ? 4096 : stream->_capacity;
+
+		while(capacity < stream->_length + length)
+			capacity <<= 1;
+
+		uint8_t *buffer = (uint8_t *)realloc(stream->_buffer, capacity);
+
+		if(buffer == NULL)
+		{
+			perror("can not allocate memory for image stream.");
+
+			finish_stream(stream, false);
+
+			return false;
+		}
+
+		stream->_buffer = buffer;
+		stream->_capacity = capacity;
+	}
+
+	memcpy(stream->_buffer + stream->_length, bytes, length);
+
+	stream->_length += length;
+
+	return true;
+}
+
+Ihr_Stream_Status ihr_stream_feed(
+	Ihr_Stream *stream,
+	const uint8_t *chunk,
+	size_t len)
+{
+	if(stream->_status != IHR_STREAM_NEED_MORE)
+		return stream->_status;
+
+	if(chunk == NULL || len == 0)
+	{
+		//The end of the stream, so its size is known for sure. _offset is already past the bytes to
+		//skip, and a skip still pending is bytes that never arrive.
+		stream->_ended = true;
+		stream->_size = stream->_offset + stream->_length - stream->_skip;
+
+		//Truncated before the position the resolver goes on from.
+		if(stream->_skip != 0)
+		{
+			stream->_skip = 0;
+
+			finish_stream(stream, false);
+
+			return stream->_status;
+		}
+
+		advance_stream(stream);
+
+		if(stream->_status == IHR_STREAM_NEED_MORE)
+			finish_stream(stream, false);
+
+		return stream->_status;
+	}
+
+	//A chunk larger than the room left is taken in pieces, the bytes no longer needed being dropped
+	//in between, so only the bytes still needed have to fit in the buffer.
+	while(len != 0 && stream->_status == IHR_STREAM_NEED_MORE)
+	{
+		//Bytes the stream told it does not need are dropped here if the caller fed them anyway.
+		size_t skipped = stream->_skip < len ? (size_t)stream->_skip : len;
+
+		chunk += skipped;
+		len -= skipped;
+		stream->_skip -= skipped;
+
+		if(len == 0)
+			break;
+
+		size_t room = IHR_STREAM_MAX_BUFFER - stream->_length;
+		size_t piece = len < room ? len : room;
+
+		if(piece == 0)
+		{
+			finish_stream(stream, false);
+
+			break;
+		}
+
+		if(append_stream_bytes(stream, chunk, piece) == false)
+			break;
+
+		chunk += piece;
+		len -= piece;
+
+		advance_stream(stream);
+
+		if(stream->_status == IHR_STREAM_NEED_MORE)
+			discard_stream_bytes(stream);
+	}
+
+	return stream->_status;
+}
+
+uint64_t ihr_stream_skip_hint(const Ihr_Stream *stream)
+{
+	return stream->_status == IHR_STREAM_NEED_MORE ? stream->_skip : 0;
+}
+
+bool ihr_stream_skip(
+	Ihr_Stream *stream,
+	uint64_t skipped)
+{
+	if(stream->_status != IHR_STREAM_NEED_MORE || skipped > stream->_skip)
+		return false;
+
+	stream->_skip -= skipped;
+
+	return true;
+}
+
+bool ihr_stream_result(
+	Ihr_Stream *stream,
+	Image_Info *out)
+{
+	if(stream->_status != IHR_STREAM_DONE || stream->_taken == true || out == NULL)
+		return false;
+
+	//The page list is handed over to out, the stream stays done.
+	*out = stream->_info;
+
+	initialize_image_info(&stream->_info);
+
+	stream->_taken = true;
+
+	return true;
+}
+
 bool is_image_info_valid(const Image_Info *info)
 {
 	return info->_width > 0 && info->_height > 0 &&
@@ -3,6 +3,7 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <stddef.h>
 
 /**
 * For now, this program supports resolving of *JPEG*, *BMP*, *TIF*, *PNG*, *TGA* image formats. 
@@ -36,6 +37,49 @@ typedef struct Image_Header_Info
     struct Image_Header_Info   *_next;
 } Image_Info;
 
+//I/O statistics of resolving a single image file.
+typedef struct Ihr_Io_Stats
+{
+    uint32_t    _read_calls;                    //number of read system calls issued
+    uint64_t    _bytes_read;                    //number of bytes read from the file
+} Ihr_Io_Stats;
+
+/**
+* Random access reader the resolvers read image content through, so the content can live
+* anywhere(a blob store, a cache, an archive...). Both functions are called with the ctx
+* given along with the reader.
+*/
+typedef struct Ihr_Reader
+{
+    /**
+    * Read exactly length bytes at offset into buffer, offset + length never goes beyond size.
+    * Return true for success, false for failure.
+    */
+    bool        (*read_at)(void *ctx, uint64_t offset, size_t length, void *buffer);
+
+    //Size of the content(in byte).
+    uint64_t    (*size)(void *ctx);
+} Ihr_Reader;
+
+//A range of bytes read from a reader.
+typedef struct Ihr_Byte_Range
+{
+    uint64_t    _offset;
+    uint64_t    _length;
+} Ihr_Byte_Range;
+
+/**
+* The byte ranges a resolve reads, in the order they are read, contiguous reads are merged.
+* _count is the number of ranges read even when it is larger than _capacity, in which case
+* only the first _capacity ranges are stored.
+*/
+typedef struct Ihr_Read_Plan
+{
+    Ihr_Byte_Range  *_ranges;                   //storage provided by the caller
+    size_t          _capacity;                  //number of ranges _ranges can hold
+    size_t          _count;                     //number of ranges read
+} Ihr_Read_Plan;
+
 /**
 * @brief Get the image information of the given image file.
 * @param[in] img_path the file path of the image file
@@ -44,6 +88,675 @@ typedef struct Image_Header_Info
 */
 bool get_image_info(const char *img_path, Image_Info *image_info);
 
+/**
+* @brief Same as get_image_info, and reports how the file was read.
+* @details The prefix of the file is read once and shared by the format detection and the
+* resolvers, so jpeg files with a small header, png, bmp and tga files take exactly one read.
+* @param[out] stats I/O statistics of the resolving, can be NULL
+* @return true for success, false for failure
+*/
+bool get_image_info_stats(const char *img_path, Image_Info *image_info, Ihr_Io_Stats *stats);
+
+//Throughput of one worker thread of a batch.
+typedef struct Ihr_Thread_Stats
+{
+    uint64_t    _files;                         //number of files taken, resolved or not
+    uint64_t    _succeeded;                     //number of files resolved
+    uint64_t    _bytes_read;                    //number of bytes read
+    uint64_t    _busy_ns;                       //time spent on the files(in nanosecond)
+    uint64_t    _steals;                        //number of work chunks taken from other threads
+} Ihr_Thread_Stats;
+
+/**
+* How the files of a batch lie on their devices, the distances are between the first physical
+* extents of consecutive files on the same device, which is what the heads of a disk travel.
+*/
+typedef struct Ihr_Layout_Stats
+{
+    uint64_t    _files_located;                 //number of files whose first physical extent is known
+    uint64_t    _seek_bytes_given;              //distance when read in the order given
+    uint64_t    _seek_bytes_ordered;            //distance when read in the physical order
+} Ihr_Layout_Stats;
+
+typedef struct Ihr_Batch_Options
+{
+    uint32_t            _thread_count;          //number of worker threads the files are dealt to, 0 for all(one per hardware thread)
+    bool                _report_errors;         //whether failures are printed through perror
+    Ihr_Thread_Stats    *_thread_stats;         //where the statistics of each thread are written, can be NULL
+    uint32_t            _thread_stats_capacity; //number of entries _thread_stats holds
+
+    /**
+    * Whether the files are read in the order they lie on their devices(first physical extent where
+    * FIEMAP tells it, inode otherwise) instead of the order given, which saves seeks on spinning
+    * disks. Locating the files costs a stat and, where FIEMAP is supported, an ioctl each through a
+    * descriptor the file is then read through. Use few threads for the order to hold, each thread
+    * takes a contiguous run of the ordered files.
+    */
+    bool                _physical_order;
+    Ihr_Layout_Stats    *_layout_stats;         //where the layout of the files is reported, can be NULL
+} Ihr_Batch_Options;
+
+/**
+* @brief Get the image information of many image files on a pool of threads.
+* @details The paths are cut into chunks spread over the threads, a thread done with its own
+* chunks steals the chunks of the others, so a few slow files do not hold the whole batch up.
+* The batches of the process share one pool with a thread per hardware thread, made on the first
+* batch, each batch waits only for its own files.
+* Failures are not printed unless asked for, they are told by ok.
+* @param[in] paths the file paths of the image files
+* @param[in] n number of paths
+* @param[out] out n entries, out[i] receives the image information of paths[i]
+* @param[out] ok n entries, ok[i] tells if paths[i] is resolved, can be NULL
+* @param[in] opts options of the batch, NULL for the default ones
+* @return number of files resolved
+*/
+size_t get_image_info_batch(
+    const char *const *paths,
+    size_t n,
+    Image_Info *out,
+    bool *ok,
+    const Ihr_Batch_Options *opts);
+
+/**
+* The result of a request submitted to a queue. _info is the first page, the following pages of a
+* multiple paged tif are handed over as they are through _info._next, release them with
+* release_image_info once done.
+*/
+typedef struct Ihr_Completion
+{
+    uint64_t    _user_tag;                      //the tag given when the request was submitted
+    bool        _success;                       //whether the image is resolved
+    Image_Info  _info;
+} Ihr_Completion;
+
+/**
+* Called on a worker thread for every completion instead of queueing it for polling, the
+* completion(and its pages) belongs to the callback.
+*/
+typedef void (*Ihr_Completion_Callback)(void *ctx, Ihr_Completion *completion);
+
+typedef struct Ihr_Queue_Options
+{
+    uint32_t                _thread_count;      //number of worker threads, 0 for one per hardware thread
+    uint32_t                _max_in_flight;     //number of requests submitted and not collected yet, 0 for 1024
+    bool                    _report_errors;     //whether failures are printed through perror
+    Ihr_Completion_Callback _callback;          //receives the completions if not NULL, otherwise they are polled
+    void                    *_callback_ctx;     //passed to every call of _callback
+} Ihr_Queue_Options;
+
+/**
+* A submission/completion queue of resolve requests.
+* Requests are resolved on a pool of threads and their results come out in the order they
+* complete, through ihr_queue_poll or the callback. A request counts against the in-flight window
+* from its submission until its completion is polled(or the callback returns), so a producer
+* faster than its consumer is held back instead of piling results up. Completions are passed
+* through a lock-free ring, neither workers nor pollers take a lock on the way.
+*/
+typedef struct Ihr_Queue Ihr_Queue;
+
+/**
+* @param[in] opts options of the queue, NULL for the default ones
+* @return the queue, or NULL if it fails to be created
+*/
+Ihr_Queue *ihr_queue_create(const Ihr_Queue_Options *opts);
+
+/**
+* @brief Wait for the requests in flight, release the completions not polled and the queue itself.
+*/
+void ihr_queue_destroy(Ihr_Queue *queue);
+
+/**
+* @brief Submit the image file at path(copied) to be resolved.
+* @param[in] wait whether to wait for room when the in-flight window is full
+* @return true if the request is submitted, false if the window is full and wait is false
+*/
+bool ihr_queue_submit_path(Ihr_Queue *queue, const char *path, uint64_t user_tag, bool wait);
+
+/**
+* @brief Submit an image file opened by the caller, the descriptor must stay open until the
+* request completes, it is read with positioned reads only and never closed.
+* @return true if the request is submitted, false if the window is full and wait is false
+*/
+bool ihr_queue_submit_fd(Ihr_Queue *queue, int fd, uint64_t user_tag, bool wait);
+
+/**
+* @brief Collect up to max completions in completion order.
+* @param[in] wait whether to wait for a completion when none is ready and requests are in flight
+* @return number of completions written to out
+*/
+size_t ihr_queue_poll(Ihr_Queue *queue, Ihr_Completion *out, size_t max, bool wait);
+
+/**
+* @brief Number of requests submitted and not collected yet.
+*/
+size_t ihr_queue_in_flight(const Ihr_Queue *queue);
+
+typedef struct Ihr_Engine_Options
+{
+    uint32_t    _queue_depth;                   //number of files in flight, 0 for 64
+    bool        _force_sync;                    //whether to use the synchronous path even if io_uring is there
+} Ihr_Engine_Options;
+
+/**
+* An engine resolving many files with their I/O pipelined through io_uring on Linux.
+* Opening, statx, the probe read and closing of up to _queue_depth files are in flight at once on
+* a single thread. A resolver needing bytes beyond what has been read does not block: the file
+* is resumed once the missing range arrives, while the other files go on.
+* Without io_uring(other systems, old kernels, or forbidden by seccomp) the files are resolved
+* one after another synchronously, ihr_engine_is_async tells which path is taken.
+*/
+typedef struct Ihr_Engine Ihr_Engine;
+
+/**
+* @param[in] opts options of the engine, NULL for the default ones
+* @return the engine, or NULL if it fails to be allocated
+*/
+Ihr_Engine *ihr_engine_create(const Ihr_Engine_Options *opts);
+
+void ihr_engine_destroy(Ihr_Engine *engine);
+
+bool ihr_engine_is_async(const Ihr_Engine *engine);
+
+/**
+* @brief Get the image information of many image files, failures are not printed.
+* @param[out] out n entries, out[i] receives the image information of paths[i]
+* @param[out] ok n entries, ok[i] tells if paths[i] is resolved, can be NULL
+* @return number of files resolved
+*/
+size_t ihr_engine_resolve(
+    Ihr_Engine *engine,
+    const char *const *paths,
+    size_t n,
+    Image_Info *out,
+    bool *ok);
+
+/**
+* @brief Get the image information of an image file through a descriptor the caller holds.
+* @param[in] fd descriptor of the image file opened for reading, it is read with positioned reads
+* only, so its file position is never changed and it is left open
+* @param[out] image_info pointer of memory to hold the resolved data
+* @return true for success, false for failure
+*/
+bool get_image_info_fd(int fd, Image_Info *image_info);
+
+/**
+* @brief Get the image information of an image file already loaded in memory.
+* @param[in] data the content of the image file, it is read in place and never copied
+* @param[in] len size of the content(in byte), which is reported as the file size
+* @param[out] out pointer of memory to hold the resolved data
+* @return true for success, false for failure
+*/
+bool get_image_info_from_memory(const uint8_t *data, size_t len, Image_Info *out);
+
+/**
+* @brief Get the image information of an image read through the given reader.
+* @param[in] reader the functions to read the content with
+* @param[in] ctx context passed to every call of the reader
+* @param[out] image_info pointer of memory to hold the resolved data
+* @return true for success, false for failure
+*/
+bool get_image_info_reader(const Ihr_Reader *reader, void *ctx, Image_Info *image_info);
+
+/**
+* @brief Same as get_image_info_reader, and reports which byte ranges were read.
+* @details Resolving the same content again only reads inside the reported ranges, so they can
+* be prefetched or cached by the caller.
+* @param[out] plan ranges read by the resolve, can be NULL
+* @return true for success, false for failure
+*/
+bool get_image_info_plan(const Ihr_Reader *reader, void *ctx, Image_Info *image_info, Ihr_Read_Plan *plan);
+
+/**
+* A resolver context, owning what resolving needs beyond the stack: the buffers tif directories and
+* values are read into, the large block buffer of jpeg walks, and an arena the pages after the first
+* one of multiple paged tif files are taken from. Buffers grow to the largest size needed and are
+* kept, so a thread resolving file after file through its own context stops allocating once warm.
+* Pages resolved through a context belong to it, never call release_image_info on them. They stay
+* valid until the context is reset or destroyed. A context is used by one thread at a time.
+*/
+typedef struct Ihr_Context Ihr_Context;
+
+typedef struct Ihr_Context_Options
+{
+    Image_Info  *_pages;                        //storage the arena takes pages from first, can be NULL
+    size_t      _page_capacity;                 //number of pages _pages holds
+} Ihr_Context_Options;
+
+/**
+* @param[in] opts options of the context, NULL for the default ones
+* @return the context, or NULL if it fails to be allocated
+*/
+Ihr_Context *ihr_context_create(const Ihr_Context_Options *opts);
+
+void ihr_context_destroy(Ihr_Context *ctx);
+
+/**
+* @brief Give every page of the arena back at once, the memory of the arena is kept for reuse.
+* @details Takes constant time however many pages were handed out.
+*/
+void ihr_context_reset(Ihr_Context *ctx);
+
+/**
+* @brief Same as get_image_info, through a context, failures are not printed.
+* @details Pages of a file failing to resolve are given back to the arena right away.
+* @return true for success, false for failure
+*/
+bool get_image_info_ctx(Ihr_Context *ctx, const char *img_path, Image_Info *image_info);
+
+/**
+* @brief Same as get_image_info_fd, through a context.
+*/
+bool get_image_info_fd_ctx(Ihr_Context *ctx, int fd, Image_Info *image_info);
+
+/**
+* @brief Same as get_image_info_from_memory, through a context.
+*/
+bool get_image_info_from_memory_ctx(Ihr_Context *ctx, const uint8_t *data, size_t len, Image_Info *out);
+
+/**
+* @brief Same as get_image_info_reader, through a context.
+*/
+bool get_image_info_reader_ctx(Ihr_Context *ctx, const Ihr_Reader *reader, void *reader_ctx, Image_Info *image_info);
+
+/**
+* The pages of a tif file resolved on demand. Opening resolves the first page only, the following
+* image file directories are found as pages are asked for, reading just the entry count and the
+* next offset of each directory passed, and the offset of every directory found is kept, so asking
+* again for a page found before resolves its directory straight away. The source stays open until
+* the pages are closed. Files of the other formats open as a single page.
+* A directory list looping back is detected and is an error, as it is for the full resolves:
+* counting fails, the pages found before the loop can still be asked for. A page list is used by
+* one thread at a time.
+*/
+typedef struct Ihr_Tiff_Pages Ihr_Tiff_Pages;
+
+/**
+* @return the pages with the first one resolved, or NULL if the file fails to resolve
+*/
+Ihr_Tiff_Pages *ihr_tiff_pages_open(const char *img_path);
+
+/**
+* @brief Same as ihr_tiff_pages_open, reading through a reader, which has to stay valid until the
+* pages are closed.
+*/
+Ihr_Tiff_Pages *ihr_tiff_pages_open_reader(const Ihr_Reader *reader, void *ctx);
+
+void ihr_tiff_pages_close(Ihr_Tiff_Pages *pages);
+
+/**
+* @brief The first page, _next is always NULL, _page_number is 0 until the end of the directory
+* list is reached(by counting or by asking for pages).
+*/
+const Image_Info *ihr_tiff_pages_first(const Ihr_Tiff_Pages *pages);
+
+/**
+* @brief Number of pages found so far, the pages before it are resolved without any walk.
+*/
+size_t ihr_tiff_pages_found(const Ihr_Tiff_Pages *pages);
+
+/**
+* @brief Resolve page index(0 for the first one), finding the directories up to it if needed.
+* @param[out] page the page, _next is always NULL and _page_number as the one of the first page
+* @return true for success, false if there is no such page or it fails to resolve
+*/
+bool ihr_tiff_pages_get(Ihr_Tiff_Pages *pages, size_t index, Image_Info *page);
+
+/**
+* @brief Count the pages, only finding the directories not found yet without resolving them.
+* @return true for success, false if a directory fails to be read or the list loops back
+*/
+bool ihr_tiff_pages_count(Ihr_Tiff_Pages *pages, size_t *count);
+
+/**
+* A local reader standing in for a remote store, every read waits for the configured latency
+* before reading the file, so reader based resolving can be benchmarked without the store.
+* Pass &_reader as the reader and the Ihr_Latency_Reader itself as ctx.
+*/
+typedef struct Ihr_Latency_Reader
+{
+    Ihr_Reader  _reader;
+    int         _fd;                            //descriptor of the file read
+    uint64_t    _size;                          //size of the file(in byte)
+    uint32_t    _latency_us;                    //latency of every read(in microsecond)
+    uint32_t    _read_calls;                    //number of reads served
+    uint64_t    _bytes_read;                    //number of bytes served
+} Ihr_Latency_Reader;
+
+/**
+* @brief Open a file behind a latency reader.
+* @return true for success, false for failure
+*/
+bool ihr_latency_reader_open(Ihr_Latency_Reader *reader, const char *path, uint32_t latency_us);
+
+/**
+* @brief Close the file behind a latency reader.
+*/
+void ihr_latency_reader_close(Ihr_Latency_Reader *reader);
+
+typedef enum Ihr_Stream_Status
+{
+    IHR_STREAM_NEED_MORE,                       //more bytes are needed to resolve the image
+    IHR_STREAM_DONE,                            //the image is resolved, get it with ihr_stream_result
+    IHR_STREAM_ERROR                            //the image can not be resolved
+} Ihr_Stream_Status;
+
+/**
+* An incremental parser for images arriving in chunks(network bodies, pipes and the like).
+* Bytes are pushed in stream order, only the bytes still needed are kept, and jpeg segments not
+* needed are announced through the skip hint so the caller can avoid fetching them at all.
+* Tif directories are followed forward only, the bytes more than 64 KB before the directory being
+* resolved(and its values) are dropped, so a tif of any size goes through as long as its
+* directories and values do not point further back. The bytes still needed are held to 16 MB.
+*/
+typedef struct Ihr_Stream Ihr_Stream;
+
+/**
+* @brief Create a stream parser.
+* @param[in] expected_size size of the whole stream(in byte), 0 if it is unknown
+* @return the stream parser, or NULL if it fails to be allocated
+*/
+Ihr_Stream *ihr_stream_create(uint64_t expected_size);
+
+/**
+* @brief Make the stream parser ready for another stream, its buffer is kept for reuse.
+*/
+void ihr_stream_reset(Ihr_Stream *ctx, uint64_t expected_size);
+
+void ihr_stream_destroy(Ihr_Stream *ctx);
+
+/**
+* @brief Push the next chunk of the stream.
+* @param[in] chunk bytes following the ones fed(and skipped) before, an empty chunk ends the stream
+* @return IHR_STREAM_NEED_MORE until the image is resolved or fails to be
+*/
+Ihr_Stream_Status ihr_stream_feed(Ihr_Stream *ctx, const uint8_t *chunk, size_t len);
+
+/**
+* @brief Number of upcoming bytes the parser does not need, they can be skipped with ihr_stream_skip
+* instead of being fed. Bytes fed anyway are dropped.
+*/
+uint64_t ihr_stream_skip_hint(const Ihr_Stream *ctx);
+
+/**
+* @brief Tell the parser the caller skipped the given number of bytes, at most the skip hint.
+* @return true for success, false for failure
+*/
+bool ihr_stream_skip(Ihr_Stream *ctx, uint64_t n);
+
+/**
+* @brief Take the resolved image information once the stream is done, pages are handed over to
+* out, release them with release_image_info. The file size reported is the expected size, or the
+* number of bytes seen(fed and skipped) when it is unknown and the stream was not ended.
+* @return true for success, false if the stream is not done or the result was already taken
+*/
+bool ihr_stream_result(Ihr_Stream *ctx, Image_Info *out);
+
+//What tells whether a file changed since it was resolved.
+typedef struct Ihr_File_Key
+{
+    uint64_t    _device;
+    uint64_t    _inode;
+    uint64_t    _size;                          //file size(in byte)
+    int64_t     _mtime_ns;                      //time of the last modification(in nanosecond since the epoch)
+} Ihr_File_Key;
+
+/**
+* @brief Get the key of a file from its status.
+* @return true for success, false for failure
+*/
+bool ihr_file_key(const char *path, Ihr_File_Key *key);
+
+/**
+* A persistent index of resolved headers, keyed by the path and the file key.
+* The index file is made of a section of fixed size records sorted by path hash, followed by the
+* pages and the paths they refer to, then by a tail of entries appended since the file was written.
+* The sorted section is mapped and searched in place, nothing is deserialized. Appended entries
+* carry a checksum each, an entry torn by a crash is dropped when the index is opened and
+* overwritten by the next append. Rewriting the index(ihr_index_rescan) goes through a temporary
+* file renamed over the old one, so a crash leaves either index whole.
+* Lookups and appends can be called from any number of threads at once.
+*/
+typedef struct Ihr_Index Ihr_Index;
+
+/**
+* @brief Open an index file, an empty one is created if it does not exist.
+* @return the index, or NULL if it can not be opened or is not an index file
+*/
+Ihr_Index *ihr_index_open(const char *index_path);
+
+void ihr_index_close(Ihr_Index *index);
+
+/**
+* @brief Number of entries of the index.
+*/
+size_t ihr_index_count(const Ihr_Index *index);
+
+/**
+* @brief Look a file up in the index, the entry only counts if its key is the same as the file's.
+* @param[in] key key of the file, NULL to get it from the file itself
+* @param[out] out the image information stored, release it with release_image_info
+* @param[out] resolved whether the file was resolved when it was indexed, can be NULL
+* @return true if the file is in the index and unchanged, false otherwise
+*/
+bool ihr_index_lookup(
+    Ihr_Index *index,
+    const char *path,
+    const Ihr_File_Key *key,
+    Image_Info *out,
+    bool *resolved);
+
+/**
+* @brief Append the result of resolving a file to the index, to the end of the index file.
+* @param[in] info the image information, NULL if the file failed to resolve
+* @return true for success, false for failure
+*/
+bool ihr_index_append(Ihr_Index *index, const char *path, const Ihr_File_Key *key, const Image_Info *info);
+
+/**
+* @brief Get the image information of a file from the index if it is unchanged, otherwise resolve
+* it and append the result to the index.
+* @return true for success, false for failure
+*/
+bool get_image_info_indexed(Ihr_Index *index, const char *path, Image_Info *image_info);
+
+typedef struct Ihr_Rescan_Stats
+{
+    uint64_t    _unchanged;                     //number of files taken from the index as they are
+    uint64_t    _reparsed;                      //number of files resolved again, as changed or new
+    uint64_t    _pruned;                        //number of entries dropped, as their files are not listed anymore
+} Ihr_Rescan_Stats;
+
+/**
+* @brief Bring the index up to date with the listed files and rewrite it compacted.
+* @details Only the files whose key changed(or that are new) are resolved, as a batch with the given
+* options. Entries of files not listed are dropped.
+* @param[out] stats what the rescan did, can be NULL
+* @return true for success, false for failure
+*/
+bool ihr_index_rescan(
+    const char *index_path,
+    const char *const *paths,
+    size_t n,
+    const Ihr_Batch_Options *opts,
+    Ihr_Rescan_Stats *stats);
+
+//Image formats as numbers, where a byte has to do instead of the name.
+typedef enum Ihr_Format
+{
+    IHR_FORMAT_UNKNOWN,                         //not resolved
+    IHR_FORMAT_JPEG,
+    IHR_FORMAT_BMP,
+    IHR_FORMAT_TIFF,
+    IHR_FORMAT_PNG,
+    IHR_FORMAT_TGA
+} Ihr_Format;
+
+/**
+* @brief Get the format of a format name, as found in Image_Info::_format.
+* @return the format, IHR_FORMAT_UNKNOWN if the name is not one of a format
+*/
+Ihr_Format ihr_format_of(const char *name);
+
+/**
+* @brief Get the name of a format, "" for IHR_FORMAT_UNKNOWN and values out of range.
+*/
+const char *ihr_format_name(Ihr_Format format);
+
+/**
+* A columnar file of resolved headers, for results of billions of files.
+* Every field is stored as an array of its own(a column), each starting on a 64 byte boundary, so
+* a column can be scanned with vector instructions straight from the mapping, nothing is parsed.
+* Columns of files hold _file_count entries, columns of pages hold _page_count entries, the pages of
+* file i are [_page_offset[i], _page_offset[i + 1]). Paths are split into a directory and a name:
+* the directories are stored once each(a dictionary), files refer to theirs by id, and the path of
+* a file is its directory followed by its name. Variable length strings are stored as in Arrow,
+* one offset per string plus one into a buffer of the bytes, without terminators.
+* The file is in the byte order of the machine writing it, it is refused on the other order.
+*/
+typedef struct Ihr_Columns_Writer Ihr_Columns_Writer;
+
+/**
+* @brief Start a columnar file, the columns are streamed to temporary files next to it until it is
+* finished, so memory only grows with the number of directories.
+* @return the writer, or NULL if the temporary files can not be created
+*/
+Ihr_Columns_Writer *ihr_columns_create(const char *columns_path);
+
+/**
+* @brief Append the result of resolving a file, can be called from any number of threads at once.
+* @param[in] info the image information, NULL if the file failed to resolve
+* @return true for success, false for failure
+*/
+bool ihr_columns_append(Ihr_Columns_Writer *writer, const char *path, const Image_Info *info);
+
+/**
+* @brief Gather the columns into the columnar file, through a temporary file renamed over it once
+* it is on the disk, then release the writer.
+* @return true for success, false for failure
+*/
+bool ihr_columns_finish(Ihr_Columns_Writer *writer);
+
+//A columnar file opened for reading, every pointer points into the mapping of the file.
+typedef struct Ihr_Columns
+{
+    uint64_t        _file_count;
+    uint64_t        _page_count;
+    uint64_t        _directory_count;
+
+    //Columns of files.
+    const uint64_t  *_file_size;                //file size(in byte)
+    const uint8_t   *_format;                   //Ihr_Format, IHR_FORMAT_UNKNOWN for files not resolved
+    const uint32_t  *_page_counts;              //number of pages, 0 for files not resolved
+    const uint64_t  *_page_offset;              //_file_count + 1 entries, the first page of each file
+    const uint32_t  *_directory;                //id of the directory of each file
+    const uint64_t  *_name_offset;              //_file_count + 1 entries, where each name starts in _names
+    const char      *_names;
+
+    //Columns of pages.
+    const uint32_t  *_width;
+    const uint32_t  *_height;
+    const uint16_t  *_color_depth;
+    const uint16_t  *_channels;
+
+    //Dictionary of directories, every directory ends with its separator.
+    const uint64_t  *_directory_offset;         //_directory_count + 1 entries
+    const char      *_directories;
+
+    void            *_storage;                  //the mapping, owned by the reader
+} Ihr_Columns;
+
+/**
+* @brief Open a columnar file, it is mapped and checked, nothing is copied.
+* @return true for success, false if it can not be read or is not a columnar file
+*/
+bool ihr_columns_open(const char *columns_path, Ihr_Columns *columns);
+
+void ihr_columns_close(Ihr_Columns *columns);
+
+/**
+* @brief Rebuild the path of a file of a columnar file.
+* @param[out] buffer where the path is written, NUL terminated, as much of it as capacity allows
+* @return length of the path, without the terminator, even if buffer is too small for it
+*/
+size_t ihr_columns_path(const Ihr_Columns *columns, uint64_t file, char *buffer, size_t capacity);
+
+/**
+* A pack of header snapshots, so images on slow(cold, archival) storage can be resolved again
+* without touching them.
+* When a file is added, it is resolved and every byte range the resolvers read(the probe prefix,
+* the jpeg segments up to the frame header, the tif directories and the values they point to) is
+* captured. The ranges of a file are its snapshot. Snapshots are gathered in blocks, compressed
+* with zlib where the library is built with it, and appended to the pack one after another, then
+* an index of the files is written at the end. Resolving from the pack replays the snapshot
+* through a reader, reads outside of the captured ranges fail, so what is resolved is exactly
+* what the resolvers of the time read. Resolving the files of a pack in order reads it sequentially.
+*/
+typedef struct Ihr_Pack_Writer Ihr_Pack_Writer;
+
+/**
+* @brief Start a pack file, written through a temporary file renamed over it once finished.
+* @param[in] compress whether the blocks are compressed, ignored without zlib
+* @return the writer, or NULL if the file can not be created
+*/
+Ihr_Pack_Writer *ihr_pack_create(const char *pack_path, bool compress);
+
+/**
+* @brief Resolve a file and add its snapshot to the pack, can be called from any number of threads
+* at once. Files that fail to resolve are added as well, as long as they can be read.
+* @param[out] image_info the image information resolved, can be NULL
+* @return true if the file is resolved, false otherwise
+*/
+bool ihr_pack_add(Ihr_Pack_Writer *writer, const char *path, Image_Info *image_info);
+
+/**
+* @brief Same as ihr_pack_add, through a descriptor the caller holds, it is read with positioned
+* reads only and left open. path is the one the file is known by in the pack.
+*/
+bool ihr_pack_add_fd(Ihr_Pack_Writer *writer, int fd, const char *path, Image_Info *image_info);
+
+/**
+* @brief Write the last block and the index, then release the writer.
+* @return true for success, false for failure
+*/
+bool ihr_pack_finish(Ihr_Pack_Writer *writer);
+
+//A pack opened for resolving, lookups can be made from any number of threads at once.
+typedef struct Ihr_Pack Ihr_Pack;
+
+/**
+* @return the pack, or NULL if it can not be read, is not a pack, or is compressed and the library
+* is built without zlib
+*/
+Ihr_Pack *ihr_pack_open(const char *pack_path);
+
+void ihr_pack_close(Ihr_Pack *pack);
+
+/**
+* @brief Number of files in the pack.
+*/
+size_t ihr_pack_count(const Ihr_Pack *pack);
+
+/**
+* @brief Path of file i of the pack, in the order they were added, NULL if i is out of range.
+*/
+const char *ihr_pack_path(const Ihr_Pack *pack, size_t i);
+
+/**
+* @brief Find a file in the pack by path.
+* @param[out] i the position of the file, the one added last if it was added more than once
+* @return true if the file is in the pack, false otherwise
+*/
+bool ihr_pack_find(const Ihr_Pack *pack, const char *path, size_t *i);
+
+/**
+* @brief Resolve file i of the pack from its snapshot.
+* @details The block of the snapshot is uncompressed into a buffer of the calling thread, which is
+* kept for the next call, so files resolved in order uncompress every block once.
+* @param[out] image_info pointer of memory to hold the resolved data
+* @return true for success, false for failure
+*/
+bool get_image_info_pack(Ihr_Pack *pack, size_t i, Image_Info *image_info);
+
 /**
 * @brief Check if the given image information is valid.
 * @param[in] info image information to check
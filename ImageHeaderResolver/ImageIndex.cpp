@@ -0,0 +1,893 @@
+#if defined _WIN32 || defined _WIN64
+#define _CRT_SECURE_NO_WARNINGS
+#include <io.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "ImageIndex.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string_view>
+#include <unordered_map>
+
+/**
+* Layout of an index file, in the byte order of the machine writing it:
+*   Index_Header
+*   Index_Record[_record_count]     sorted by path hash, then path
+*   Index_Page[]                    the pages of the records, in the order of the records
+*   paths                           NUL terminated
+*   tail                            entries appended since, up to the end of the file
+* A tail entry is a Tail_Prefix, a payload made of an Index_Record followed by the NUL terminated
+* path and the pages(offsets of the record relative to the payload), and the checksum of the payload.
+*/
+
+static const char index_magic[8] = { 'I', 'H', 'R', 'I', 'N', 'D', 'E', 'X' };
+
+static const uint32_t index_version = 1;
+
+//Tells an index written on a machine of the other byte order.
+static const uint32_t byte_order_mark = 0x01020304;
+
+static const uint32_t tail_magic = 0x4c494154;
+
+struct Index_Header
+{
+    char _magic[8];
+    uint32_t _version;
+    uint32_t _byte_order;
+    uint64_t _record_count;
+    uint64_t _records_offset;
+    uint64_t _tail_offset;                      //where the tail starts, the end of the mapped part
+    uint64_t _reserved[3];
+};
+
+struct Index_Record
+{
+    uint64_t _path_hash;
+    uint64_t _device;
+    uint64_t _inode;
+    uint64_t _size;
+    int64_t _mtime_ns;
+    uint64_t _path_offset;
+    uint64_t _pages_offset;
+    uint32_t _page_count;
+    uint8_t _format;                            //Ihr_Format
+    uint8_t _resolved;
+    uint16_t _reserved;
+};
+
+struct Tail_Prefix
+{
+    uint32_t _magic;
+    uint32_t _payload_length;
+};
+
+static_assert(sizeof(Index_Header) == 64, "the index header is 64 bytes");
+static_assert(sizeof(Index_Record) == 64, "an index record is 64 bytes");
+static_assert(sizeof(Index_Page) == 16, "an index page is 16 bytes");
+
+//FNV-1a, for path hashes and tail checksums.
+static uint64_t hash_bytes(const void *data, std::size_t length)
+{
+    const uint8_t *bytes = static_cast<const uint8_t *>(data);
+
+    uint64_t hash = 0xcbf29ce484222325ULL;
+
+    for(std::size_t i = 0; i < length; ++i)
+    {
+        hash ^= bytes[i];
+        hash *= 0x100000001b3ULL;
+    }
+
+    return hash;
+}
+
+static inline uint64_t hash_path(std::string_view path)
+{
+    return hash_bytes(path.data(), path.size());
+}
+
+static inline bool same_key(const Index_Record &record, const Ihr_File_Key &key)
+{
+    return record._device == key._device && record._inode == key._inode &&
+        record._size == key._size && record._mtime_ns == key._mtime_ns;
+}
+
+//An entry found in an index, pointing into the mapping or into the tail.
+struct Entry_View
+{
+    const Index_Record *_record = nullptr;
+    std::string_view _path;
+    const Index_Page *_pages = nullptr;
+};
+
+struct Tail_Entry
+{
+    Index_Record _record;
+    std::vector<Index_Page> _pages;
+};
+
+struct Ihr_Index
+{
+    int _fd = -1;
+    bool _writable = false;
+
+    //The part before the tail, mapped(or read into _content where mapping is not available).
+    const uint8_t *_data = nullptr;
+    std::size_t _data_length = 0;
+    void *_map = nullptr;
+    std::vector<uint8_t> _content;
+
+    const Index_Record *_records = nullptr;
+    uint64_t _record_count = 0;
+
+    //The tail, the latest entry of every path appended, and where the next append goes.
+    std::shared_mutex _mutex;
+    std::unordered_map<std::string, Tail_Entry> _tail;
+    uint64_t _tail_end = 0;
+
+    //Number of paths of the tail not in the sorted records.
+    std::size_t _tail_only = 0;
+};
+
+static bool read_at(int fd, uint64_t offset, void *buffer, std::size_t length)
+{
+    uint8_t *destination = static_cast<uint8_t *>(buffer);
+
+    while(length > 0)
+    {
+#if defined _WIN32 || defined _WIN64
+        if(_lseeki64(fd, static_cast<int64_t>(offset), SEEK_SET) < 0)
+            return false;
+
+        int read_size = _read(fd, destination, static_cast<unsigned int>(std::min<std::size_t>(length, 1u << 30)));
+#else
+        ssize_t read_size = pread(fd, destination, length, static_cast<off_t>(offset));
+#endif
+        if(read_size <= 0)
+            return false;
+
+        offset += static_cast<uint64_t>(read_size);
+        destination += read_size;
+        length -= static_cast<std::size_t>(read_size);
+    }
+
+    return true;
+}
+
+static bool write_at(int fd, uint64_t offset, const void *buffer, std::size_t length)
+{
+    const uint8_t *source = static_cast<const uint8_t *>(buffer);
+
+    while(length > 0)
+    {
+#if defined _WIN32 || defined _WIN64
+        if(_lseeki64(fd, static_cast<int64_t>(offset), SEEK_SET) < 0)
+            return false;
+
+        int written = _write(fd, source, static_cast<unsigned int>(std::min<std::size_t>(length, 1u << 30)));
+#else
+        ssize_t written = pwrite(fd, source, length, static_cast<off_t>(offset));
+#endif
+        if(written <= 0)
+            return false;
+
+        offset += static_cast<uint64_t>(written);
+        source += written;
+        length -= static_cast<std::size_t>(written);
+    }
+
+    return true;
+}
+
+static uint64_t file_length(int fd)
+{
+#if defined _WIN32 || defined _WIN64
+    struct _stati64 file_stat;
+
+    if(_fstati64(fd, &file_stat) != 0)
+        return 0;
+#else
+    struct stat file_stat;
+
+    if(fstat(fd, &file_stat) != 0)
+        return 0;
+#endif
+
+    return static_cast<uint64_t>(file_stat.st_size);
+}
+
+static void initialize_header(Index_Header &header, uint64_t record_count, uint64_t tail_offset)
+{
+    std::memset(&header, 0, sizeof(Index_Header));
+    std::memcpy(header._magic, index_magic, sizeof(index_magic));
+
+    header._version = index_version;
+    header._byte_order = byte_order_mark;
+    header._record_count = record_count;
+    header._records_offset = sizeof(Index_Header);
+    header._tail_offset = tail_offset;
+}
+
+//Find the latest entry of a path, the caller holds the lock of the tail.
+static bool find_entry(const Ihr_Index &index, std::string_view path, Entry_View &view)
+{
+    auto tail = index._tail.find(std::string(path));
+
+    if(tail != index._tail.end())
+    {
+        view._record = &tail->second._record;
+        view._path = tail->first;
+        view._pages = tail->second._pages.data();
+
+        return true;
+    }
+
+    uint64_t hash = hash_path(path);
+
+    const Index_Record *end = index._records + index._record_count;
+
+    const Index_Record *record = std::lower_bound(index._records, end, hash,
+        [](const Index_Record &left, uint64_t right) { return left._path_hash < right; });
+
+    for(; record != end && record->_path_hash == hash; ++record)
+    {
+        //Offsets are checked, a damaged index misses instead of reading out of the mapping.
+        if(record->_path_offset >= index._data_length ||
+           record->_pages_offset > index._data_length ||
+           record->_page_count > (index._data_length - record->_pages_offset) / sizeof(Index_Page))
+            continue;
+
+        const char *record_path = reinterpret_cast<const char *>(index._data + record->_path_offset);
+
+        std::size_t limit = index._data_length - static_cast<std::size_t>(record->_path_offset);
+
+        const void *terminator = std::memchr(record_path, 0, limit);
+
+        if(terminator == nullptr)
+            continue;
+
+        std::string_view candidate(record_path, static_cast<std::size_t>(static_cast<const char *>(terminator) - record_path));
+
+        if(candidate != path)
+            continue;
+
+        view._record = record;
+        view._path = candidate;
+        view._pages = reinterpret_cast<const Index_Page *>(index._data + record->_pages_offset);
+
+        return true;
+    }
+
+    return false;
+}
+
+//Parse the tail entries of [begin, end), stop at the first one torn or damaged.
+static uint64_t load_tail(Ihr_Index &index, const std::vector<uint8_t> &tail, uint64_t tail_offset)
+{
+    std::size_t position = 0;
+
+    while(tail.size() - position >= sizeof(Tail_Prefix))
+    {
+        Tail_Prefix prefix;
+        std::memcpy(&prefix, tail.data() + position, sizeof(Tail_Prefix));
+
+        std::size_t available = tail.size() - position - sizeof(Tail_Prefix);
+
+        if(prefix._magic != tail_magic || prefix._payload_length < sizeof(Index_Record) + 1 ||
+           available < sizeof(uint64_t) || prefix._payload_length > available - sizeof(uint64_t))
+            break;
+
+        const uint8_t *payload = tail.data() + position + sizeof(Tail_Prefix);
+
+        uint64_t checksum;
+        std::memcpy(&checksum, payload + prefix._payload_length, sizeof(uint64_t));
+
+        if(checksum != hash_bytes(payload, prefix._payload_length))
+            break;
+
+        Tail_Entry entry;
+        std::memcpy(&entry._record, payload, sizeof(Index_Record));
+
+        const char *path = reinterpret_cast<const char *>(payload + sizeof(Index_Record));
+
+        std::size_t path_length = strnlen(path, prefix._payload_length - sizeof(Index_Record));
+
+        std::size_t pages_offset = sizeof(Index_Record) + path_length + 1;
+
+        if(pages_offset + uint64_t(entry._record._page_count) * sizeof(Index_Page) != prefix._payload_length)
+            break;
+
+        entry._pages.resize(entry._record._page_count);
+
+        if(entry._pages.empty() == false)
+            std::memcpy(entry._pages.data(), payload + pages_offset, entry._pages.size() * sizeof(Index_Page));
+
+        std::string key(path, path_length);
+
+        Entry_View existing;
+
+        if(index._tail.count(key) == 0 && find_entry(index, key, existing) == false)
+            ++index._tail_only;
+
+        index._tail[std::move(key)] = std::move(entry);
+
+        position += sizeof(Tail_Prefix) + prefix._payload_length + sizeof(uint64_t);
+    }
+
+    return tail_offset + position;
+}
+
+static void release_index(Ihr_Index *index)
+{
+#if !(defined _WIN32 || defined _WIN64)
+    if(index->_map != nullptr)
+        munmap(index->_map, index->_data_length);
+#endif
+
+    if(index->_fd >= 0)
+        close(index->_fd);
+
+    delete index;
+}
+
+Ihr_Index *ihr_index_open(const char *index_path)
+{
+    if(index_path == nullptr)
+        return nullptr;
+
+    std::unique_ptr<Ihr_Index> index(new Ihr_Index);
+
+#if defined _WIN32 || defined _WIN64
+    index->_fd = _open(index_path, _O_RDWR | _O_CREAT | _O_BINARY, _S_IREAD | _S_IWRITE);
+
+    if(index->_fd < 0)
+        index->_fd = _open(index_path, _O_RDONLY | _O_BINARY);
+    else
+        index->_writable = true;
+#else
+    index->_fd = open(index_path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+
+    if(index->_fd < 0)
+        index->_fd = open(index_path, O_RDONLY | O_CLOEXEC);
+    else
+        index->_writable = true;
+#endif
+
+    if(index->_fd < 0)
+        return nullptr;
+
+    uint64_t length = file_length(index->_fd);
+
+    Index_Header header;
+
+    if(length == 0)
+    {
+        //A new index, empty.
+        initialize_header(header, 0, sizeof(Index_Header));
+
+        if(index->_writable == false || write_at(index->_fd, 0, &header, sizeof(Index_Header)) == false)
+        {
+            release_index(index.release());
+
+            return nullptr;
+        }
+
+        length = sizeof(Index_Header);
+    }
+    else if(length < sizeof(Index_Header) || read_at(index->_fd, 0, &header, sizeof(Index_Header)) == false ||
+        std::memcmp(header._magic, index_magic, sizeof(index_magic)) != 0 ||
+        header._version != index_version || header._byte_order != byte_order_mark ||
+        header._records_offset < sizeof(Index_Header) || header._tail_offset > length ||
+        header._records_offset > header._tail_offset ||
+        header._record_count > (header._tail_offset - header._records_offset) / sizeof(Index_Record))
+    {
+        release_index(index.release());
+
+        return nullptr;
+    }
+
+    index->_data_length = static_cast<std::size_t>(header._tail_offset);
+
+#if defined _WIN32 || defined _WIN64
+    index->_content.resize(index->_data_length);
+
+    if(read_at(index->_fd, 0, index->_content.data(), index->_data_length) == false)
+    {
+        release_index(index.release());
+
+        return nullptr;
+    }
+
+    index->_data = index->_content.data();
+#else
+    void *map = mmap(nullptr, index->_data_length, PROT_READ, MAP_SHARED, index->_fd, 0);
+
+    if(map == MAP_FAILED)
+    {
+        release_index(index.release());
+
+        return nullptr;
+    }
+
+    index->_map = map;
+    index->_data = static_cast<const uint8_t *>(map);
+#endif
+
+    index->_records = reinterpret_cast<const Index_Record *>(index->_data + header._records_offset);
+    index->_record_count = header._record_count;
+
+    std::vector<uint8_t> tail(static_cast<std::size_t>(length - header._tail_offset));
+
+    if(tail.empty() == false && read_at(index->_fd, header._tail_offset, tail.data(), tail.size()) == false)
+        tail.clear();
+
+    index->_tail_end = load_tail(*index, tail, header._tail_offset);
+
+    return index.release();
+}
+
+void ihr_index_close(Ihr_Index *index)
+{
+    if(index != nullptr)
+        release_index(index);
+}
+
+size_t ihr_index_count(const Ihr_Index *index)
+{
+    return index == nullptr ? 0 : static_cast<size_t>(index->_record_count) + index->_tail_only;
+}
+
+bool ihr_file_key(const char *path, Ihr_File_Key *key)
+{
+    if(path == nullptr || key == nullptr)
+        return false;
+
+#if defined _WIN32 || defined _WIN64
+    struct _stati64 file_stat;
+
+    if(_stati64(path, &file_stat) != 0)
+        return false;
+
+    key->_mtime_ns = static_cast<int64_t>(file_stat.st_mtime) * 1000000000LL;
+#else
+    struct stat file_stat;
+
+    if(stat(path, &file_stat) != 0)
+        return false;
+
+#if defined __APPLE__
+    key->_mtime_ns = static_cast<int64_t>(file_stat.st_mtimespec.tv_sec) * 1000000000LL + file_stat.st_mtimespec.tv_nsec;
+#else
+    key->_mtime_ns = static_cast<int64_t>(file_stat.st_mtim.tv_sec) * 1000000000LL + file_stat.st_mtim.tv_nsec;
+#endif
+#endif
+
+    key->_device = static_cast<uint64_t>(file_stat.st_dev);
+    key->_inode = static_cast<uint64_t>(file_stat.st_ino);
+    key->_size = static_cast<uint64_t>(file_stat.st_size);
+
+    return true;
+}
+
+//Build the image information of an entry, the pages after the first one are allocated.
+static bool entry_to_image_info(const Entry_View &view, Image_Info *out)
+{
+    std::memset(out, 0, sizeof(Image_Info));
+
+    if(view._record->_resolved == 0 || view._record->_page_count == 0)
+        return true;
+
+    Image_Info *last = nullptr;
+
+    for(uint32_t i = 0; i < view._record->_page_count; ++i)
+    {
+        Index_Page page;
+        std::memcpy(&page, view._pages + i, sizeof(Index_Page));
+
+        Image_Info *current = out;
+
+        if(last != nullptr)
+        {
+            current = static_cast<Image_Info *>(std::calloc(1, sizeof(Image_Info)));
+
+            if(current == nullptr)
+            {
+                release_image_info(out);
+
+                std::memset(out, 0, sizeof(Image_Info));
+
+                return false;
+            }
+
+            last->_next = current;
+        }
+
+        current->_file_size = view._record->_size;
+        std::strcpy(current->_format, ihr_format_name(static_cast<Ihr_Format>(view._record->_format)));
+        current->_width = page._width;
+        current->_height = page._height;
+        current->_color_depth = page._color_depth;
+        current->_channels = page._channels;
+        current->_page_number = view._record->_page_count;
+
+        last = current;
+    }
+
+    return true;
+}
+
+bool ihr_index_lookup(
+    Ihr_Index *index,
+    const char *path,
+    const Ihr_File_Key *key,
+    Image_Info *out,
+    bool *resolved)
+{
+    if(index == nullptr || path == nullptr || out == nullptr)
+        return false;
+
+    Ihr_File_Key file_key;
+
+    if(key == nullptr)
+    {
+        if(ihr_file_key(path, &file_key) == false)
+            return false;
+
+        key = &file_key;
+    }
+
+    std::shared_lock<std::shared_mutex> lock(index->_mutex);
+
+    Entry_View view;
+
+    if(find_entry(*index, path, view) == false || same_key(*view._record, *key) == false)
+        return false;
+
+    if(entry_to_image_info(view, out) == false)
+        return false;
+
+    if(resolved != nullptr)
+        *resolved = view._record->_resolved != 0;
+
+    return true;
+}
+
+Index_Entry make_index_entry(const char *path, const Ihr_File_Key &key, const Image_Info *info)
+{
+    Index_Entry entry;
+    entry._path = path;
+    entry._key = key;
+    entry._resolved = info != nullptr;
+
+    if(info != nullptr)
+    {
+        entry._format = static_cast<uint8_t>(ihr_format_of(info->_format));
+
+        for(const Image_Info *page = info; page != nullptr; page = page->_next)
+            entry._pages.push_back(Index_Page{ page->_width, page->_height, page->_color_depth, page->_channels, 0 });
+    }
+
+    return entry;
+}
+
+static Index_Record make_record(const Index_Entry &entry, uint64_t path_offset, uint64_t pages_offset)
+{
+    Index_Record record;
+    std::memset(&record, 0, sizeof(Index_Record));
+
+    record._path_hash = hash_path(entry._path);
+    record._device = entry._key._device;
+    record._inode = entry._key._inode;
+    record._size = entry._key._size;
+    record._mtime_ns = entry._key._mtime_ns;
+    record._path_offset = path_offset;
+    record._pages_offset = pages_offset;
+    record._page_count = static_cast<uint32_t>(entry._pages.size());
+    record._format = entry._format;
+    record._resolved = entry._resolved ? 1 : 0;
+
+    return record;
+}
+
+bool ihr_index_append(Ihr_Index *index, const char *path, const Ihr_File_Key *key, const Image_Info *info)
+{
+    if(index == nullptr || path == nullptr || key == nullptr || index->_writable == false)
+        return false;
+
+    Index_Entry entry = make_index_entry(path, *key, info);
+
+    uint64_t pages_offset = sizeof(Index_Record) + entry._path.size() + 1;
+
+    Index_Record record = make_record(entry, sizeof(Index_Record), pages_offset);
+
+    std::vector<uint8_t> bytes(sizeof(Tail_Prefix) + pages_offset + entry._pages.size() * sizeof(Index_Page) + sizeof(uint64_t));
+
+    Tail_Prefix prefix = { tail_magic, static_cast<uint32_t>(bytes.size() - sizeof(Tail_Prefix) - sizeof(uint64_t)) };
+
+    uint8_t *payload = bytes.data() + sizeof(Tail_Prefix);
+
+    std::memcpy(bytes.data(), &prefix, sizeof(Tail_Prefix));
+    std::memcpy(payload, &record, sizeof(Index_Record));
+    std::memcpy(payload + sizeof(Index_Record), entry._path.c_str(), entry._path.size() + 1);
+
+    if(entry._pages.empty() == false)
+        std::memcpy(payload + pages_offset, entry._pages.data(), entry._pages.size() * sizeof(Index_Page));
+
+    uint64_t checksum = hash_bytes(payload, prefix._payload_length);
+    std::memcpy(payload + prefix._payload_length, &checksum, sizeof(uint64_t));
+
+    std::unique_lock<std::shared_mutex> lock(index->_mutex);
+
+    //Whatever a crash left after the last whole entry is overwritten.
+    if(write_at(index->_fd, index->_tail_end, bytes.data(), bytes.size()) == false)
+        return false;
+
+    index->_tail_end += bytes.size();
+
+    Entry_View existing;
+
+    if(index->_tail.count(entry._path) == 0 && find_entry(*index, entry._path, existing) == false)
+        ++index->_tail_only;
+
+    Tail_Entry &tail_entry = index->_tail[entry._path];
+    tail_entry._record = record;
+    tail_entry._pages = std::move(entry._pages);
+
+    return true;
+}
+
+bool get_image_info_indexed(Ihr_Index *index, const char *path, Image_Info *image_info)
+{
+    if(image_info == nullptr)
+        return false;
+
+    std::memset(image_info, 0, sizeof(Image_Info));
+
+    Ihr_File_Key key;
+
+    if(path == nullptr || ihr_file_key(path, &key) == false)
+        return false;
+
+    bool resolved = false;
+
+    if(ihr_index_lookup(index, path, &key, image_info, &resolved))
+        return resolved;
+
+    bool success = get_image_info(path, image_info);
+
+    ihr_index_append(index, path, &key, success ? image_info : nullptr);
+
+    return success;
+}
+
+//Write all of buffer, through stdio so small writes are gathered.
+static inline bool write_all(std::FILE *file, const void *buffer, std::size_t length)
+{
+    return length == 0 || std::fwrite(buffer, 1, length, file) == length;
+}
+
+bool write_index(const char *index_path, const std::vector<Index_Entry> &entries)
+{
+    std::vector<std::pair<uint64_t, const Index_Entry *>> sorted;
+    sorted.reserve(entries.size());
+
+    for(const Index_Entry &entry : entries)
+        sorted.emplace_back(hash_path(entry._path), &entry);
+
+    //Sorted by path hash then path, the latest entry of a path is kept.
+    std::stable_sort(sorted.begin(), sorted.end(), [](const auto &left, const auto &right)
+    {
+        if(left.first != right.first)
+            return left.first < right.first;
+
+        return left.second->_path < right.second->_path;
+    });
+
+    std::vector<const Index_Entry *> kept;
+    kept.reserve(sorted.size());
+
+    for(const auto &[hash, entry] : sorted)
+    {
+        if(kept.empty() == false && kept.back()->_path == entry->_path)
+            kept.back() = entry;
+        else
+            kept.push_back(entry);
+    }
+
+    uint64_t page_count = 0, paths_length = 0;
+
+    for(const Index_Entry *entry : kept)
+    {
+        page_count += entry->_pages.size();
+        paths_length += entry->_path.size() + 1;
+    }
+
+    uint64_t records_offset = sizeof(Index_Header);
+    uint64_t pages_offset = records_offset + kept.size() * sizeof(Index_Record);
+    uint64_t paths_offset = pages_offset + page_count * sizeof(Index_Page);
+    uint64_t tail_offset = paths_offset + paths_length;
+
+    std::string temporary_path = std::string(index_path) + ".tmp";
+
+    std::FILE *file = std::fopen(temporary_path.c_str(), "wb");
+
+    if(file == nullptr)
+        return false;
+
+    std::vector<char> file_buffer(1 << 20);
+    std::setvbuf(file, file_buffer.data(), _IOFBF, file_buffer.size());
+
+    Index_Header header;
+    initialize_header(header, kept.size(), tail_offset);
+
+    bool success = write_all(file, &header, sizeof(Index_Header));
+
+    uint64_t next_page = pages_offset, next_path = paths_offset;
+
+    for(const Index_Entry *entry : kept)
+    {
+        Index_Record record = make_record(*entry, next_path, next_page);
+
+        success = success && write_all(file, &record, sizeof(Index_Record));
+
+        next_page += entry->_pages.size() * sizeof(Index_Page);
+        next_path += entry->_path.size() + 1;
+    }
+
+    for(const Index_Entry *entry : kept)
+        success = success && write_all(file, entry->_pages.data(), entry->_pages.size() * sizeof(Index_Page));
+
+    for(const Index_Entry *entry : kept)
+        success = success && write_all(file, entry->_path.c_str(), entry->_path.size() + 1);
+
+    //The new index must be on the disk before it replaces the old one.
+    success = std::fflush(file) == 0 && success;
+
+#if defined _WIN32 || defined _WIN64
+    success = success && _commit(_fileno(file)) == 0;
+#else
+    success = success && fsync(fileno(file)) == 0;
+#endif
+
+    success = std::fclose(file) == 0 && success;
+
+    if(success == false)
+    {
+        std::remove(temporary_path.c_str());
+
+        return false;
+    }
+
+#if defined _WIN32 || defined _WIN64
+    //Windows does not rename over an existing file.
+    std::remove(index_path);
+#endif
+
+    if(std::rename(temporary_path.c_str(), index_path) != 0)
+    {
+        std::remove(temporary_path.c_str());
+
+        return false;
+    }
+
+#if !(defined _WIN32 || defined _WIN64)
+    //Make the rename itself durable.
+    std::string directory = index_path;
+    std::size_t slash = directory.find_last_of('/');
+    directory = slash == std::string::npos ? "." : slash == 0 ? "/" : directory.substr(0, slash);
+
+    int directory_fd = open(directory.c_str(), O_RDONLY | O_CLOEXEC);
+
+    if(directory_fd >= 0)
+    {
+        fsync(directory_fd);
+
+        close(directory_fd);
+    }
+#endif
+
+    return true;
+}
+
+bool ihr_index_rescan(
+    const char *index_path,
+    const char *const *paths,
+    size_t n,
+    const Ihr_Batch_Options *opts,
+    Ihr_Rescan_Stats *stats)
+{
+    if(stats != nullptr)
+        std::memset(stats, 0, sizeof(Ihr_Rescan_Stats));
+
+    Ihr_Index *index = ihr_index_open(index_path);
+
+    if(index == nullptr || (paths == nullptr && n != 0))
+    {
+        ihr_index_close(index);
+
+        return false;
+    }
+
+    std::vector<Index_Entry> entries;
+    entries.reserve(n);
+
+    std::vector<const char *> changed_paths;
+    std::vector<Ihr_File_Key> changed_keys;
+
+    uint64_t listed_in_index = 0;
+
+    for(size_t i = 0; i < n; ++i)
+    {
+        Ihr_File_Key key;
+
+        //Files gone since they were listed are dropped as well.
+        if(paths[i] == nullptr || ihr_file_key(paths[i], &key) == false)
+            continue;
+
+        Entry_View view;
+
+        bool found = find_entry(*index, paths[i], view);
+
+        if(found)
+            ++listed_in_index;
+
+        if(found && same_key(*view._record, key))
+        {
+            Index_Entry entry;
+            entry._path = paths[i];
+            entry._key = key;
+            entry._resolved = view._record->_resolved != 0;
+            entry._format = view._record->_format;
+            entry._pages.resize(view._record->_page_count);
+
+            if(entry._pages.empty() == false)
+                std::memcpy(entry._pages.data(), view._pages, entry._pages.size() * sizeof(Index_Page));
+
+            entries.push_back(std::move(entry));
+        }
+        else
+        {
+            changed_paths.push_back(paths[i]);
+            changed_keys.push_back(key);
+        }
+    }
+
+    uint64_t indexed = ihr_index_count(index);
+
+    ihr_index_close(index);
+
+    std::vector<Image_Info> infos(changed_paths.size());
+    std::unique_ptr<bool[]> ok(new bool[changed_paths.size() + 1]);
+
+    get_image_info_batch(changed_paths.data(), changed_paths.size(), infos.data(), ok.get(), opts);
+
+    for(std::size_t i = 0; i < changed_paths.size(); ++i)
+    {
+        entries.push_back(make_index_entry(changed_paths[i], changed_keys[i], ok[i] ? &infos[i] : nullptr));
+
+        if(ok[i])
+            release_image_info(&infos[i]);
+    }
+
+    if(stats != nullptr)
+    {
+        stats->_unchanged = entries.size() - changed_paths.size();
+        stats->_reparsed = changed_paths.size();
+        stats->_pruned = indexed - std::min(indexed, listed_in_index);
+    }
+
+    return write_index(index_path, entries);
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include "ImageHeaderResolver.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+//A page as stored in an index file.
+struct Index_Page
+{
+	uint32_t _width;
+	uint32_t _height;
+	uint16_t _color_depth;
+	uint16_t _channels;
+	uint32_t _reserved;
+};
+
+//An entry to be written to an index file.
+struct Index_Entry
+{
+	std::string _path;
+	Ihr_File_Key _key;
+	bool _resolved = false;
+	uint8_t _format = 0;				//Ihr_Format
+	std::vector<Index_Page> _pages;
+};
+
+/**
+* @brief Make an index entry of a file, info is NULL if the file failed to resolve.
+*/
+Index_Entry make_index_entry(const char *path, const Ihr_File_Key &key, const Image_Info *info);
+
+/**
+* @brief Write the entries as a compacted index(sorted, without tail) to a temporary file, then rename
+* it over index_path once it is on the disk.
+* @return true for success, false for failure
+*/
+bool write_index(const char *index_path, const std::vector<Index_Entry> &entries);
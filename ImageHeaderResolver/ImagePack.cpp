@@ -0,0 +1,844 @@
+#if defined _WIN32 || defined _WIN64
+#define _CRT_SECURE_NO_WARNINGS
+#include <io.h>
+#include <fcntl.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef IHR_HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+#include "ImageHeaderResolver.h"
+#include "ImageSource.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+* Layout of a pack file, in the byte order of the machine writing it:
+*   Pack_Header
+*   blocks                          each stored compressed, or as it is when that is not smaller
+*   Pack_Block[_block_count]        the index, from _index_offset
+*   Pack_Entry[_entry_count]        in the order the files were added
+*   Pack_Key[_entry_count]          sorted by path hash, then entry
+*   paths                           NUL terminated
+*   Pack_Footer
+* A block, once uncompressed, is a run of snapshots, each a Snapshot_Header followed by its
+* Snapshot_Range(sorted by offset, neither overlapping nor touching) then the bytes of the ranges.
+* Blocks and snapshots start on 8 byte boundaries, so their fixed fields are read in place.
+*/
+
+static const char pack_magic[8] = { 'I', 'H', 'R', 'P', 'A', 'C', 'K', '1' };
+
+static const uint32_t pack_version = 1;
+
+//Tells a pack written on a machine of the other byte order.
+static const uint32_t byte_order_mark = 0x01020304;
+
+//Number of snapshot bytes gathered before a block is compressed and written.
+static const std::size_t block_size = 1 << 20;
+
+struct Pack_Header
+{
+    char _magic[8];
+    uint32_t _version;
+    uint32_t _byte_order;
+    uint64_t _reserved[6];
+};
+
+struct Pack_Footer
+{
+    uint64_t _block_count;
+    uint64_t _entry_count;
+    uint64_t _index_offset;
+    uint64_t _paths_length;
+    uint64_t _reserved[3];
+    char _magic[8];                             //last, a pack cut short does not end with it
+};
+
+struct Pack_Block
+{
+    uint64_t _offset;
+    uint32_t _stored_length;                    //_raw_length when stored as it is
+    uint32_t _raw_length;
+};
+
+struct Pack_Entry
+{
+    uint64_t _path_offset;                      //from the beginning of the paths
+    uint32_t _block;
+    uint32_t _offset;                           //of the snapshot in the block uncompressed
+    uint32_t _length;
+    uint32_t _reserved;
+};
+
+struct Pack_Key
+{
+    uint64_t _path_hash;
+    uint64_t _entry;
+};
+
+struct Snapshot_Header
+{
+    uint64_t _file_size;
+    uint32_t _range_count;
+    uint32_t _reserved;
+};
+
+struct Snapshot_Range
+{
+    uint64_t _offset;                           //in the file
+    uint64_t _length;
+    uint64_t _position;                         //of its bytes, from the end of the ranges
+};
+
+static_assert(sizeof(Pack_Header) == 64, "the pack header is 64 bytes");
+static_assert(sizeof(Pack_Footer) == 64, "the pack footer is 64 bytes");
+static_assert(sizeof(Pack_Block) == 16, "a pack block is 16 bytes");
+static_assert(sizeof(Pack_Entry) == 24, "a pack entry is 24 bytes");
+static_assert(sizeof(Pack_Key) == 16, "a pack key is 16 bytes");
+
+static inline std::size_t align8(std::size_t length)
+{
+    return (length + 7) & ~static_cast<std::size_t>(7);
+}
+
+//FNV-1a, the same hash as the index uses for paths.
+static uint64_t hash_path(std::string_view path)
+{
+    uint64_t hash = 0xcbf29ce484222325ULL;
+
+    for(char c : path)
+    {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= 0x100000001b3ULL;
+    }
+
+    return hash;
+}
+
+//A read made by the resolvers while a file is captured.
+struct Captured_Read
+{
+    uint64_t _offset;
+    uint64_t _length;
+    std::size_t _position;                      //of its bytes in the capture
+};
+
+//Reader passing the reads through to the reader of the file and keeping what they return.
+struct Capture
+{
+    const Ihr_Reader *_reader;
+    void *_ctx;
+    std::vector<Captured_Read> _reads;
+    std::vector<uint8_t> _bytes;
+};
+
+static bool capture_read_at(void *ctx, uint64_t offset, size_t length, void *buffer)
+{
+    Capture *capture = static_cast<Capture *>(ctx);
+
+    if(capture->_reader->read_at(capture->_ctx, offset, length, buffer) == false)
+        return false;
+
+    capture->_reads.push_back(Captured_Read{ offset, length, capture->_bytes.size() });
+
+    const uint8_t *bytes = static_cast<const uint8_t *>(buffer);
+
+    capture->_bytes.insert(capture->_bytes.end(), bytes, bytes + length);
+
+    return true;
+}
+
+static uint64_t capture_size(void *ctx)
+{
+    Capture *capture = static_cast<Capture *>(ctx);
+
+    return capture->_reader->size(capture->_ctx);
+}
+
+static const Ihr_Reader capture_reader = { capture_read_at, capture_size };
+
+//Merge the reads of a capture into the ranges of a snapshot, written to snapshot.
+static void make_snapshot(Capture &capture, uint64_t file_size, std::vector<uint8_t> &snapshot)
+{
+    std::sort(capture._reads.begin(), capture._reads.end(),
+        [](const Captured_Read &left, const Captured_Read &right) { return left._offset < right._offset; });
+
+    std::vector<Snapshot_Range> ranges;
+    std::vector<uint8_t> data;
+
+    for(const Captured_Read &read : capture._reads)
+    {
+        uint64_t end = read._offset + read._length;
+
+        //Overlapping or touching the last range, only what goes beyond it is added.
+        if(ranges.empty() == false && read._offset <= ranges.back()._offset + ranges.back()._length)
+        {
+            uint64_t last_end = ranges.back()._offset + ranges.back()._length;
+
+            if(end > last_end)
+            {
+                const uint8_t *bytes = capture._bytes.data() + read._position + (last_end - read._offset);
+
+                data.insert(data.end(), bytes, bytes + (end - last_end));
+
+                ranges.back()._length += end - last_end;
+            }
+
+            continue;
+        }
+
+        ranges.push_back(Snapshot_Range{ read._offset, read._length, data.size() });
+
+        const uint8_t *bytes = capture._bytes.data() + read._position;
+
+        data.insert(data.end(), bytes, bytes + read._length);
+    }
+
+    Snapshot_Header header = { file_size, static_cast<uint32_t>(ranges.size()), 0 };
+
+    snapshot.resize(align8(sizeof(Snapshot_Header) + ranges.size() * sizeof(Snapshot_Range) + data.size()));
+
+    uint8_t *out = snapshot.data();
+
+    std::memcpy(out, &header, sizeof(Snapshot_Header));
+    out += sizeof(Snapshot_Header);
+
+    if(ranges.empty() == false)
+        std::memcpy(out, ranges.data(), ranges.size() * sizeof(Snapshot_Range));
+
+    out += ranges.size() * sizeof(Snapshot_Range);
+
+    if(data.empty() == false)
+        std::memcpy(out, data.data(), data.size());
+
+    out += data.size();
+
+    std::memset(out, 0, static_cast<std::size_t>(snapshot.data() + snapshot.size() - out));
+}
+
+//Reader serving the ranges of a snapshot, anything else fails.
+struct Snapshot
+{
+    uint64_t _file_size;
+    const Snapshot_Range *_ranges;
+    uint32_t _range_count;
+    const uint8_t *_data;
+    uint64_t _data_length;
+};
+
+static bool snapshot_read_at(void *ctx, uint64_t offset, size_t length, void *buffer)
+{
+    const Snapshot *snapshot = static_cast<const Snapshot *>(ctx);
+
+    const Snapshot_Range *end = snapshot->_ranges + snapshot->_range_count;
+
+    //The last range starting at or before offset.
+    const Snapshot_Range *range = std::upper_bound(snapshot->_ranges, end, offset,
+        [](uint64_t value, const Snapshot_Range &range) { return value < range._offset; });
+
+    if(range == snapshot->_ranges)
+        return false;
+
+    --range;
+
+    uint64_t skip = offset - range->_offset;
+
+    if(skip > range->_length || length > range->_length - skip ||
+       range->_position > snapshot->_data_length || range->_length > snapshot->_data_length - range->_position)
+        return false;
+
+    std::memcpy(buffer, snapshot->_data + range->_position + skip, length);
+
+    return true;
+}
+
+static uint64_t snapshot_size(void *ctx)
+{
+    return static_cast<const Snapshot *>(ctx)->_file_size;
+}
+
+static const Ihr_Reader snapshot_reader = { snapshot_read_at, snapshot_size };
+
+struct Ihr_Pack_Writer
+{
+    std::string _path;
+    std::string _temporary_path;
+    bool _compress = false;
+
+    //The snapshots of the block being gathered, and the entries.
+    std::mutex _mutex;
+    std::vector<uint8_t> _block;
+    uint32_t _block_count = 0;
+    std::vector<Pack_Entry> _entries;
+    std::string _paths;
+
+    //Blocks are compressed outside of _mutex, then written in whatever order they are done.
+    std::mutex _file_mutex;
+    std::FILE *_file = nullptr;
+    std::vector<char> _file_buffer;
+    uint64_t _file_end = 0;
+    std::vector<Pack_Block> _blocks;
+    bool _failed = false;
+};
+
+static bool write_block(Ihr_Pack_Writer *writer, uint32_t block, const std::vector<uint8_t> &raw)
+{
+    const uint8_t *stored = raw.data();
+    std::size_t stored_length = raw.size();
+
+#ifdef IHR_HAVE_ZLIB
+    std::vector<uint8_t> compressed;
+
+    if(writer->_compress)
+    {
+        uLongf compressed_length = compressBound(static_cast<uLong>(raw.size()));
+
+        compressed.resize(compressed_length);
+
+        if(compress2(compressed.data(), &compressed_length, raw.data(), static_cast<uLong>(raw.size()), Z_DEFAULT_COMPRESSION) == Z_OK &&
+           compressed_length < raw.size())
+        {
+            stored = compressed.data();
+            stored_length = compressed_length;
+        }
+    }
+#endif
+
+    static const uint8_t padding[8] = {};
+
+    std::lock_guard<std::mutex> lock(writer->_file_mutex);
+
+    std::size_t padding_length = align8(stored_length) - stored_length;
+
+    bool success = std::fwrite(stored, 1, stored_length, writer->_file) == stored_length &&
+        (padding_length == 0 || std::fwrite(padding, 1, padding_length, writer->_file) == padding_length);
+
+    if(writer->_blocks.size() <= block)
+        writer->_blocks.resize(block + 1);
+
+    writer->_blocks[block] = Pack_Block{ writer->_file_end, static_cast<uint32_t>(stored_length), static_cast<uint32_t>(raw.size()) };
+
+    writer->_file_end += stored_length + padding_length;
+
+    if(success == false)
+        writer->_failed = true;
+
+    return success;
+}
+
+Ihr_Pack_Writer *ihr_pack_create(const char *pack_path, bool compress)
+{
+    if(pack_path == nullptr)
+        return nullptr;
+
+    std::unique_ptr<Ihr_Pack_Writer> writer(new Ihr_Pack_Writer);
+    writer->_path = pack_path;
+    writer->_temporary_path = writer->_path + ".tmp";
+    writer->_compress = compress;
+
+    writer->_file = std::fopen(writer->_temporary_path.c_str(), "wb");
+
+    if(writer->_file == nullptr)
+        return nullptr;
+
+    writer->_file_buffer.resize(1 << 20);
+    std::setvbuf(writer->_file, writer->_file_buffer.data(), _IOFBF, writer->_file_buffer.size());
+
+    Pack_Header header;
+    std::memset(&header, 0, sizeof(Pack_Header));
+    std::memcpy(header._magic, pack_magic, sizeof(pack_magic));
+
+    header._version = pack_version;
+    header._byte_order = byte_order_mark;
+
+    if(std::fwrite(&header, sizeof(Pack_Header), 1, writer->_file) != 1)
+    {
+        std::fclose(writer->_file);
+
+        std::remove(writer->_temporary_path.c_str());
+
+        return nullptr;
+    }
+
+    writer->_file_end = sizeof(Pack_Header);
+
+    return writer.release();
+}
+
+//Append a snapshot to the block being gathered, the block is written once full.
+static bool add_snapshot(Ihr_Pack_Writer *writer, const char *path, const std::vector<uint8_t> &snapshot)
+{
+    //Offsets in a block are 32 bits.
+    if(snapshot.size() > UINT32_MAX - block_size)
+        return false;
+
+    std::vector<uint8_t> full_block;
+    uint32_t full_block_id = 0;
+
+    {
+        std::lock_guard<std::mutex> lock(writer->_mutex);
+
+        Pack_Entry entry = {};
+        entry._path_offset = writer->_paths.size();
+        entry._block = writer->_block_count;
+        entry._offset = static_cast<uint32_t>(writer->_block.size());
+        entry._length = static_cast<uint32_t>(snapshot.size());
+
+        writer->_entries.push_back(entry);
+
+        writer->_paths.append(path);
+        writer->_paths.push_back('\0');
+
+        writer->_block.insert(writer->_block.end(), snapshot.begin(), snapshot.end());
+
+        if(writer->_block.size() >= block_size)
+        {
+            full_block.swap(writer->_block);
+            full_block_id = writer->_block_count++;
+
+            writer->_block.reserve(block_size + block_size / 4);
+        }
+    }
+
+    return full_block.empty() || write_block(writer, full_block_id, full_block);
+}
+
+bool ihr_pack_add_fd(Ihr_Pack_Writer *writer, int fd, const char *path, Image_Info *image_info)
+{
+    Image_Info info;
+
+    if(image_info == nullptr)
+        image_info = &info;
+
+    std::memset(image_info, 0, sizeof(Image_Info));
+
+    if(writer == nullptr || path == nullptr || fd < 0)
+        return false;
+
+    //Kept by the thread, so their storage is reused from one file to the next.
+    thread_local Capture capture;
+    thread_local std::vector<uint8_t> snapshot;
+
+    capture._reader = ihr_source_fd_reader();
+    capture._ctx = reinterpret_cast<void *>(static_cast<intptr_t>(fd));
+    capture._reads.clear();
+    capture._bytes.clear();
+
+    uint64_t file_size = capture_size(&capture);
+
+    bool success = get_image_info_reader(&capture_reader, &capture, image_info);
+
+    make_snapshot(capture, file_size, snapshot);
+
+    bool added = add_snapshot(writer, path, snapshot);
+
+    if(image_info == &info && success)
+        release_image_info(&info);
+
+    return success && added;
+}
+
+bool ihr_pack_add(Ihr_Pack_Writer *writer, const char *path, Image_Info *image_info)
+{
+    if(image_info != nullptr)
+        std::memset(image_info, 0, sizeof(Image_Info));
+
+    if(writer == nullptr || path == nullptr)
+        return false;
+
+#if defined _WIN32 || defined _WIN64
+    int fd = _open(path, _O_RDONLY | _O_BINARY);
+#else
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+#endif
+
+    if(fd < 0)
+        return false;
+
+    bool success = ihr_pack_add_fd(writer, fd, path, image_info);
+
+#if defined _WIN32 || defined _WIN64
+    _close(fd);
+#else
+    close(fd);
+#endif
+
+    return success;
+}
+
+bool ihr_pack_finish(Ihr_Pack_Writer *writer)
+{
+    if(writer == nullptr)
+        return false;
+
+    std::unique_ptr<Ihr_Pack_Writer> owner(writer);
+
+    bool success = writer->_block.empty() || write_block(writer, writer->_block_count++, writer->_block);
+
+    std::vector<Pack_Key> keys(writer->_entries.size());
+
+    for(std::size_t i = 0; i < keys.size(); ++i)
+        keys[i] = Pack_Key{ hash_path(writer->_paths.c_str() + writer->_entries[i]._path_offset), i };
+
+    std::sort(keys.begin(), keys.end(), [](const Pack_Key &left, const Pack_Key &right)
+    {
+        return left._path_hash != right._path_hash ? left._path_hash < right._path_hash : left._entry < right._entry;
+    });
+
+    Pack_Footer footer;
+    std::memset(&footer, 0, sizeof(Pack_Footer));
+    std::memcpy(footer._magic, pack_magic, sizeof(pack_magic));
+
+    footer._block_count = writer->_blocks.size();
+    footer._entry_count = writer->_entries.size();
+    footer._index_offset = writer->_file_end;
+    footer._paths_length = writer->_paths.size();
+
+    std::FILE *file = writer->_file;
+
+    writer->_file = nullptr;
+
+    success = success && writer->_failed == false &&
+        (writer->_blocks.empty() || std::fwrite(writer->_blocks.data(), sizeof(Pack_Block), writer->_blocks.size(), file) == writer->_blocks.size()) &&
+        (writer->_entries.empty() || std::fwrite(writer->_entries.data(), sizeof(Pack_Entry), writer->_entries.size(), file) == writer->_entries.size()) &&
+        (keys.empty() || std::fwrite(keys.data(), sizeof(Pack_Key), keys.size(), file) == keys.size()) &&
+        (writer->_paths.empty() || std::fwrite(writer->_paths.data(), 1, writer->_paths.size(), file) == writer->_paths.size()) &&
+        std::fwrite(&footer, sizeof(Pack_Footer), 1, file) == 1;
+
+    //The pack must be on the disk before it replaces the old one.
+    success = std::fflush(file) == 0 && success;
+
+#if defined _WIN32 || defined _WIN64
+    success = success && _commit(_fileno(file)) == 0;
+#else
+    success = success && fsync(fileno(file)) == 0;
+#endif
+
+    success = std::fclose(file) == 0 && success;
+
+#if defined _WIN32 || defined _WIN64
+    //Windows does not rename over an existing file.
+    if(success)
+        std::remove(writer->_path.c_str());
+#endif
+
+    if(success == false || std::rename(writer->_temporary_path.c_str(), writer->_path.c_str()) != 0)
+    {
+        std::remove(writer->_temporary_path.c_str());
+
+        return false;
+    }
+
+#if !(defined _WIN32 || defined _WIN64)
+    //Make the rename itself durable.
+    std::size_t slash = writer->_path.find_last_of('/');
+    std::string directory = slash == std::string::npos ? "." : slash == 0 ? "/" : writer->_path.substr(0, slash);
+
+    int directory_fd = open(directory.c_str(), O_RDONLY | O_CLOEXEC);
+
+    if(directory_fd >= 0)
+    {
+        fsync(directory_fd);
+
+        close(directory_fd);
+    }
+#endif
+
+    return true;
+}
+
+struct Ihr_Pack
+{
+    //The whole pack, mapped(or read into _content where mapping is not available).
+    const uint8_t *_data = nullptr;
+    std::size_t _length = 0;
+    void *_map = nullptr;
+    std::vector<uint8_t> _content;
+
+    const Pack_Block *_blocks = nullptr;
+    uint64_t _block_count = 0;
+    const Pack_Entry *_entries = nullptr;
+    const Pack_Key *_keys = nullptr;
+    uint64_t _entry_count = 0;
+    const char *_paths = nullptr;
+    uint64_t _paths_length = 0;
+
+    //Tells packs apart in the block buffers of the threads, an address could be reused.
+    uint64_t _generation = 0;
+};
+
+static std::atomic<uint64_t> pack_generation{0};
+
+static void release_pack(Ihr_Pack *pack)
+{
+#if !(defined _WIN32 || defined _WIN64)
+    if(pack->_map != nullptr)
+        munmap(pack->_map, pack->_length);
+#endif
+
+    delete pack;
+}
+
+static bool load_pack(const char *pack_path, Ihr_Pack &pack)
+{
+#if defined _WIN32 || defined _WIN64
+    std::FILE *file = std::fopen(pack_path, "rb");
+
+    if(file == nullptr)
+        return false;
+
+    bool success = _fseeki64(file, 0, SEEK_END) == 0;
+
+    int64_t length = success ? _ftelli64(file) : -1;
+
+    success = length > 0 && _fseeki64(file, 0, SEEK_SET) == 0;
+
+    if(success)
+    {
+        pack._content.resize(static_cast<std::size_t>(length));
+
+        success = std::fread(pack._content.data(), 1, pack._content.size(), file) == pack._content.size();
+    }
+
+    std::fclose(file);
+
+    pack._data = pack._content.data();
+    pack._length = pack._content.size();
+
+    return success;
+#else
+    int fd = open(pack_path, O_RDONLY | O_CLOEXEC);
+
+    if(fd < 0)
+        return false;
+
+    struct stat file_stat;
+
+    if(fstat(fd, &file_stat) != 0 || file_stat.st_size <= 0)
+    {
+        close(fd);
+
+        return false;
+    }
+
+    pack._length = static_cast<std::size_t>(file_stat.st_size);
+
+    void *map = mmap(nullptr, pack._length, PROT_READ, MAP_SHARED, fd, 0);
+
+    close(fd);
+
+    if(map == MAP_FAILED)
+        return false;
+
+    //Packs are mostly resolved in order.
+    madvise(map, pack._length, MADV_SEQUENTIAL);
+
+    pack._map = map;
+    pack._data = static_cast<const uint8_t *>(map);
+
+    return true;
+#endif
+}
+
+Ihr_Pack *ihr_pack_open(const char *pack_path)
+{
+    if(pack_path == nullptr)
+        return nullptr;
+
+    std::unique_ptr<Ihr_Pack, void (*)(Ihr_Pack *)> pack(new Ihr_Pack, release_pack);
+
+    if(load_pack(pack_path, *pack) == false || pack->_length < sizeof(Pack_Header) + sizeof(Pack_Footer))
+        return nullptr;
+
+    Pack_Header header;
+    std::memcpy(&header, pack->_data, sizeof(Pack_Header));
+
+    Pack_Footer footer;
+    std::memcpy(&footer, pack->_data + pack->_length - sizeof(Pack_Footer), sizeof(Pack_Footer));
+
+    uint64_t index_end = pack->_length - sizeof(Pack_Footer);
+
+    if(std::memcmp(header._magic, pack_magic, sizeof(pack_magic)) != 0 ||
+       std::memcmp(footer._magic, pack_magic, sizeof(pack_magic)) != 0 ||
+       header._version != pack_version || header._byte_order != byte_order_mark ||
+       footer._index_offset < sizeof(Pack_Header) || footer._index_offset > index_end || footer._index_offset % 8 != 0 ||
+       footer._block_count > (index_end - footer._index_offset) / sizeof(Pack_Block) ||
+       footer._entry_count > (index_end - footer._index_offset - footer._block_count * sizeof(Pack_Block)) / (sizeof(Pack_Entry) + sizeof(Pack_Key)) ||
+       footer._paths_length != index_end - footer._index_offset - footer._block_count * sizeof(Pack_Block) -
+           footer._entry_count * (sizeof(Pack_Entry) + sizeof(Pack_Key)))
+        return nullptr;
+
+    const uint8_t *index = pack->_data + footer._index_offset;
+
+    pack->_blocks = reinterpret_cast<const Pack_Block *>(index);
+    pack->_block_count = footer._block_count;
+    pack->_entries = reinterpret_cast<const Pack_Entry *>(index + footer._block_count * sizeof(Pack_Block));
+    pack->_keys = reinterpret_cast<const Pack_Key *>(pack->_entries + footer._entry_count);
+    pack->_entry_count = footer._entry_count;
+    pack->_paths = reinterpret_cast<const char *>(pack->_keys + footer._entry_count);
+    pack->_paths_length = footer._paths_length;
+
+    //The paths end with a terminator, so none of them can run out of the index.
+    if(pack->_paths_length > 0 && pack->_paths[pack->_paths_length - 1] != '\0')
+        return nullptr;
+
+    for(uint64_t i = 0; i < pack->_block_count; ++i)
+    {
+        const Pack_Block &block = pack->_blocks[i];
+
+        if(block._offset > footer._index_offset || block._stored_length > footer._index_offset - block._offset)
+            return nullptr;
+
+#ifndef IHR_HAVE_ZLIB
+        if(block._stored_length != block._raw_length)
+            return nullptr;
+#endif
+    }
+
+    pack->_generation = ++pack_generation;
+
+    return pack.release();
+}
+
+void ihr_pack_close(Ihr_Pack *pack)
+{
+    if(pack != nullptr)
+        release_pack(pack);
+}
+
+size_t ihr_pack_count(const Ihr_Pack *pack)
+{
+    return pack == nullptr ? 0 : static_cast<size_t>(pack->_entry_count);
+}
+
+const char *ihr_pack_path(const Ihr_Pack *pack, size_t i)
+{
+    if(pack == nullptr || i >= pack->_entry_count || pack->_entries[i]._path_offset >= pack->_paths_length)
+        return nullptr;
+
+    return pack->_paths + pack->_entries[i]._path_offset;
+}
+
+bool ihr_pack_find(const Ihr_Pack *pack, const char *path, size_t *i)
+{
+    if(pack == nullptr || path == nullptr)
+        return false;
+
+    uint64_t hash = hash_path(path);
+
+    const Pack_Key *end = pack->_keys + pack->_entry_count;
+
+    const Pack_Key *key = std::lower_bound(pack->_keys, end, hash,
+        [](const Pack_Key &left, uint64_t right) { return left._path_hash < right; });
+
+    bool found = false;
+
+    //Keys of a path are sorted by entry, the last one found is the latest.
+    for(; key != end && key->_path_hash == hash; ++key)
+    {
+        const char *candidate = ihr_pack_path(pack, static_cast<size_t>(key->_entry));
+
+        if(candidate != nullptr && std::strcmp(candidate, path) == 0)
+        {
+            if(i != nullptr)
+                *i = static_cast<size_t>(key->_entry);
+
+            found = true;
+        }
+    }
+
+    return found;
+}
+
+//The block a thread uncompressed last.
+struct Block_Buffer
+{
+    uint64_t _generation = 0;
+    uint64_t _block = 0;
+    std::vector<uint8_t> _raw;
+};
+
+//Get the uncompressed bytes of a block, blocks stored as they are are not copied.
+static const uint8_t *load_block(const Ihr_Pack &pack, uint64_t block_id)
+{
+    const Pack_Block &block = pack._blocks[block_id];
+
+    if(block._stored_length == block._raw_length)
+        return pack._data + block._offset;
+
+#ifdef IHR_HAVE_ZLIB
+    thread_local Block_Buffer buffer;
+
+    if(buffer._generation == pack._generation && buffer._block == block_id)
+        return buffer._raw.data();
+
+    //Whatever happens, the buffer holds no block until this one is whole.
+    buffer._generation = 0;
+    buffer._raw.resize(block._raw_length);
+
+    uLongf raw_length = block._raw_length;
+
+    if(uncompress(buffer._raw.data(), &raw_length, pack._data + block._offset, block._stored_length) != Z_OK ||
+       raw_length != block._raw_length)
+        return nullptr;
+
+    buffer._generation = pack._generation;
+    buffer._block = block_id;
+
+    return buffer._raw.data();
+#else
+    return nullptr;
+#endif
+}
+
+bool get_image_info_pack(Ihr_Pack *pack, size_t i, Image_Info *image_info)
+{
+    if(image_info == nullptr)
+        return false;
+
+    std::memset(image_info, 0, sizeof(Image_Info));
+
+    if(pack == nullptr || i >= pack->_entry_count)
+        return false;
+
+    const Pack_Entry &entry = pack->_entries[i];
+
+    if(entry._block >= pack->_block_count || entry._offset % 8 != 0 || entry._length < sizeof(Snapshot_Header) ||
+       entry._offset > pack->_blocks[entry._block]._raw_length ||
+       entry._length > pack->_blocks[entry._block]._raw_length - entry._offset)
+        return false;
+
+    const uint8_t *block = load_block(*pack, entry._block);
+
+    if(block == nullptr)
+        return false;
+
+    const uint8_t *bytes = block + entry._offset;
+
+    const Snapshot_Header *header = reinterpret_cast<const Snapshot_Header *>(bytes);
+
+    if(header->_range_count > (entry._length - sizeof(Snapshot_Header)) / sizeof(Snapshot_Range))
+        return false;
+
+    Snapshot snapshot;
+    snapshot._file_size = header->_file_size;
+    snapshot._ranges = reinterpret_cast<const Snapshot_Range *>(bytes + sizeof(Snapshot_Header));
+    snapshot._range_count = header->_range_count;
+    snapshot._data = reinterpret_cast<const uint8_t *>(snapshot._ranges + snapshot._range_count);
+    snapshot._data_length = entry._length - sizeof(Snapshot_Header) - snapshot._range_count * sizeof(Snapshot_Range);
+
+    return get_image_info_reader(&snapshot_reader, &snapshot, image_info);
+}
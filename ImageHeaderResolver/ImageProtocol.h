@@ -0,0 +1,50 @@
+#ifndef IMAGEPROTOCOL_H
+#define IMAGEPROTOCOL_H
+
+#include <stdint.h>
+
+/**
+* The protocol between ihr-daemon and its clients, over a Unix domain socket, in the byte order of
+* the machine(both ends run on it).
+* A request is a frame of IHR_FRAME_REQUEST whose payload is _count paths, each a uint32_t length
+* followed by the bytes of the path(not terminated).
+* A response is a frame of IHR_FRAME_RESPONSE with the request id of its request, whose payload is
+* _count records in the order of the paths, each an Ihr_Wire_Record followed by _page_count pages.
+* Both frames are held to IHR_MAX_PAYLOAD: the records of a response that would go over it are
+* sent as failed(no page), and a frame over it is read through and dropped by the receiving end.
+* A client can send any number of requests without waiting, responses come back as they are done,
+* not necessarily in the order of the requests.
+*/
+
+#define IHR_FRAME_REQUEST       0x51524849u     //"IHRQ"
+#define IHR_FRAME_RESPONSE      0x41524849u     //"IHRA"
+
+//Largest payload of a frame, and most paths of a request.
+#define IHR_MAX_PAYLOAD         (64u << 20)
+#define IHR_MAX_BATCH           65536u
+
+typedef struct Ihr_Frame_Header
+{
+	uint32_t    _magic;
+	uint32_t    _request_id;
+	uint32_t    _count;                         //number of paths or records
+	uint32_t    _payload_length;                //number of bytes following the header
+} Ihr_Frame_Header;
+
+typedef struct Ihr_Wire_Record
+{
+	uint32_t    _success;                       //1 if the file was resolved, 0 otherwise(and no page follows)
+	uint32_t    _page_count;
+	uint64_t    _file_size;
+	char        _format[8];
+} Ihr_Wire_Record;
+
+typedef struct Ihr_Wire_Page
+{
+	uint32_t    _width;
+	uint32_t    _height;
+	uint16_t    _color_depth;
+	uint16_t    _channels;
+} Ihr_Wire_Page;
+
+#endif
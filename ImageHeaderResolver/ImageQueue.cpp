@@ -0,0 +1,214 @@
+#include "ImageHeaderResolver.h"
+#include "ImageSource.h"
+#include "MpmcRing.hpp"
+#include "ThreadPool.hpp"
+#include <atomic>
+#include <cstring>
+#include <string>
+
+static const uint32_t default_max_in_flight = 1024;
+
+struct Ihr_Queue
+{
+    explicit Ihr_Queue(const Ihr_Queue_Options &options) :
+        _options(options),
+        _ring(options._max_in_flight),
+        _pool(options._thread_count)
+    {}
+
+    Ihr_Queue_Options _options;
+
+    //Requests submitted and not collected yet, never more than _options._max_in_flight.
+    std::atomic<uint32_t> _in_flight{0};
+
+    //Bumped whenever completions are queued or collected, pollers wait on it.
+    std::atomic<uint32_t> _events{0};
+
+    //Holds at least _max_in_flight completions, so a worker never finds it full.
+    Mpmc_Ring<Ihr_Completion> _ring;
+
+    //Destroyed first, so every task is done before the ring goes away.
+    Thread_Pool _pool;
+};
+
+//Take a place in the in-flight window.
+static bool reserve_request(Ihr_Queue *queue, bool wait)
+{
+    uint32_t in_flight = queue->_in_flight.load();
+
+    for(;;)
+    {
+        if(in_flight >= queue->_options._max_in_flight)
+        {
+            if(wait == false)
+                return false;
+
+            queue->_in_flight.wait(in_flight);
+
+            in_flight = queue->_in_flight.load();
+
+            continue;
+        }
+
+        if(queue->_in_flight.compare_exchange_weak(in_flight, in_flight + 1))
+            return true;
+    }
+}
+
+static inline void signal_pollers(Ihr_Queue *queue)
+{
+    queue->_events.fetch_add(1);
+
+    queue->_events.notify_all();
+}
+
+static void release_requests(Ihr_Queue *queue, uint32_t count)
+{
+    queue->_in_flight.fetch_sub(count);
+
+    queue->_in_flight.notify_all();
+
+    //A poller waiting for the last requests in flight must see they are gone.
+    signal_pollers(queue);
+}
+
+static void complete_request(Ihr_Queue *queue, Ihr_Completion &completion)
+{
+    if(queue->_options._callback != nullptr)
+    {
+        queue->_options._callback(queue->_options._callback_ctx, &completion);
+
+        release_requests(queue, 1);
+
+        return;
+    }
+
+    //The page list moves with the first page, nothing is copied but the first page itself.
+    queue->_ring.try_push(std::move(completion));
+
+    signal_pollers(queue);
+}
+
+Ihr_Queue *ihr_queue_create(const Ihr_Queue_Options *opts)
+{
+    Ihr_Queue_Options options = {};
+
+    if(opts != nullptr)
+        options = *opts;
+
+    if(options._max_in_flight == 0)
+        options._max_in_flight = default_max_in_flight;
+
+    try
+    {
+        return new Ihr_Queue(options);
+    }
+    catch(...)
+    {
+        return nullptr;
+    }
+}
+
+void ihr_queue_destroy(Ihr_Queue *queue)
+{
+    if(queue == nullptr)
+        return;
+
+    queue->_pool.wait_idle();
+
+    Ihr_Completion completion;
+
+    while(queue->_ring.try_pop(completion))
+        release_image_info(&completion._info);
+
+    delete queue;
+}
+
+bool ihr_queue_submit_path(Ihr_Queue *queue, const char *path, uint64_t user_tag, bool wait)
+{
+    if(queue == nullptr || path == nullptr || reserve_request(queue, wait) == false)
+        return false;
+
+    queue->_pool.submit([queue, path = std::string(path), user_tag]
+    {
+        Ihr_Completion completion;
+        completion._user_tag = user_tag;
+        completion._success = false;
+
+        std::memset(&completion._info, 0, sizeof(Image_Info));
+
+        Ihr_Source source;
+
+        if(ihr_source_open_file(&source, path.c_str(), queue->_options._report_errors))
+        {
+            completion._success = ihr_resolve_source(&source, &completion._info);
+
+            ihr_source_close(&source);
+        }
+
+        complete_request(queue, completion);
+    });
+
+    return true;
+}
+
+bool ihr_queue_submit_fd(Ihr_Queue *queue, int fd, uint64_t user_tag, bool wait)
+{
+    if(queue == nullptr || reserve_request(queue, wait) == false)
+        return false;
+
+    queue->_pool.submit([queue, fd, user_tag]
+    {
+        Ihr_Completion completion;
+        completion._user_tag = user_tag;
+        completion._success = false;
+
+        std::memset(&completion._info, 0, sizeof(Image_Info));
+
+        Ihr_Source source;
+
+        if(ihr_source_from_fd(&source, fd))
+        {
+            completion._success = ihr_resolve_source(&source, &completion._info);
+
+            ihr_source_close(&source);
+        }
+
+        complete_request(queue, completion);
+    });
+
+    return true;
+}
+
+size_t ihr_queue_poll(Ihr_Queue *queue, Ihr_Completion *out, size_t max, bool wait)
+{
+    if(queue == nullptr || out == nullptr || max == 0)
+        return 0;
+
+    std::size_t count = 0;
+
+    for(;;)
+    {
+        //Read before trying the ring, so a completion queued in between wakes the wait below.
+        uint32_t events = queue->_events.load();
+
+        while(count < max && queue->_ring.try_pop(out[count]))
+            ++count;
+
+        if(count != 0 || wait == false || queue->_options._callback != nullptr ||
+           queue->_in_flight.load() == 0)
+            break;
+
+        queue->_events.wait(events);
+    }
+
+    if(count != 0)
+        release_requests(queue, static_cast<uint32_t>(count));
+
+    return count;
+}
+
+size_t ihr_queue_in_flight(const Ihr_Queue *queue)
+{
+    return queue == nullptr ? 0 : queue->_in_flight.load();
+}
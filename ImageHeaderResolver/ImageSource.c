@@ -0,0 +1,409 @@
+#if defined _WIN32 || defined _WIN64
+#define _CRT_SECURE_NO_WARNINGS
+#include <io.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#define open_file(path) _open(path, _O_RDONLY | _O_BINARY)
+#define close_file(fd) _close(fd)
+#define stat_file(fd, st) _fstati64(fd, st)
+typedef struct _stati64 File_Stat;
+#else
+#define _FILE_OFFSET_BITS 64
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#define open_file(path) open(path, O_RDONLY | O_CLOEXEC)
+#define close_file(fd) close(fd)
+#define stat_file(fd, st) fstat(fd, st)
+typedef struct stat File_Stat;
+#endif
+
+#include "ImageSource.h"
+#include <errno.h>
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
+
+/**
+* The built-in descriptor reader, the descriptor itself is carried by the context pointer.
+* Read exactly length bytes at offset without moving the file position, a short read only
+* happens at the end of the file or on an interrupted call.
+*/
+static bool fd_read_at(
+	void *ctx,
+	uint64_t offset,
+	size_t length,
+	void *buffer)
+{
+	int fd = (int)(intptr_t)ctx;
+
+	uint8_t *destination = (uint8_t *)buffer;
+
+	while (length > 0)
+	{
+#if defined _WIN32 || defined _WIN64
+		if (_lseeki64(fd, (int64_t)offset, SEEK_SET) < 0)
+			return false;
+
+		int read_size = _read(fd, destination, length > INT_MAX ? INT_MAX : (unsigned int)length);
+#else
+		ssize_t read_size = pread(fd, destination, length, (off_t)offset);
+
+		if (read_size < 0 && errno == EINTR)
+			continue;
+#endif
+		if (read_size <= 0)
+			return false;
+
+		offset += (uint64_t)read_size;
+		destination += read_size;
+		length -= (size_t)read_size;
+	}
+
+	return true;
+}
+
+static uint64_t fd_size(void *ctx)
+{
+	File_Stat file_stat;
+
+	if (stat_file((int)(intptr_t)ctx, &file_stat) != 0 || file_stat.st_size <= 0)
+		return 0ULL;
+
+	return (uint64_t)file_stat.st_size;
+}
+
+static const Ihr_Reader _fd_reader = { &fd_read_at, &fd_size };
+
+const Ihr_Reader *ihr_source_fd_reader(void)
+{
+	return &_fd_reader;
+}
+
+static inline void reset_source(Ihr_Source *source)
+{
+	//The probe itself is left uninitialized, only _probe_length bytes of it are ever read.
+	source->_data = NULL;
+	source->_data_offset = 0;
+	source->_data_length = 0;
+	source->_starved = false;
+	source->_lowest_offset = UINT64_MAX;
+	source->_reader = NULL;
+	source->_reader_ctx = NULL;
+	source->_fd = -1;
+	source->_size = 0;
+	source->_plan = NULL;
+	source->_context = NULL;
+	source->_read_calls = 0;
+	source->_bytes_read = 0;
+	source->_probe_length = 0;
+	source->_map = NULL;
+	source->_map_length = 0;
+}
+
+static inline bool is_range_valid(
+	const Ihr_Source *source,
+	uint64_t offset,
+	size_t length)
+{
+	return offset <= source->_size && length <= source->_size - offset;
+}
+
+//Find the range in the memory of an addressable source, a range beyond a window starves it.
+static inline const uint8_t *find_data(
+	Ihr_Source *source,
+	uint64_t offset,
+	size_t length)
+{
+	//A stream keeps the bytes of a window from there on, for the resolver to run again.
+	if (offset < source->_lowest_offset)
+		source->_lowest_offset = offset;
+
+	if (is_range_valid(source, offset, length) == false || offset < source->_data_offset)
+		return NULL;
+
+	uint64_t relative = offset - source->_data_offset;
+
+	if (relative <= source->_data_length && length <= source->_data_length - relative)
+		return source->_data + relative;
+
+	source->_starved = true;
+
+	return NULL;
+}
+
+static inline void record_plan_range(
+	Ihr_Read_Plan *plan,
+	uint64_t offset,
+	size_t length)
+{
+	//Contiguous reads are reported as a single range.
+	if (plan->_count != 0 && plan->_count <= plan->_capacity)
+	{
+		Ihr_Byte_Range *last = plan->_ranges + plan->_count - 1;
+
+		if (last->_offset + last->_length == offset)
+		{
+			last->_length += length;
+
+			return;
+		}
+	}
+
+	if (plan->_count < plan->_capacity)
+	{
+		plan->_ranges[plan->_count]._offset = offset;
+		plan->_ranges[plan->_count]._length = length;
+	}
+
+	++plan->_count;
+}
+
+static bool read_reader_at(
+	Ihr_Source *source,
+	uint64_t offset,
+	size_t length,
+	uint8_t *buffer)
+{
+	if (source->_reader == NULL)
+		return false;
+
+	++source->_read_calls;
+
+	if (source->_plan != NULL)
+		record_plan_range(source->_plan, offset, length);
+
+	if (source->_reader->read_at(source->_reader_ctx, offset, length, buffer) == false)
+		return false;
+
+	source->_bytes_read += length;
+
+	return true;
+}
+
+void ihr_source_from_memory(
+	Ihr_Source *source,
+	const uint8_t *data,
+	size_t size)
+{
+	reset_source(source);
+
+	source->_data = data;
+	source->_data_length = size;
+	source->_size = size;
+}
+
+void ihr_source_from_window(
+	Ihr_Source *source,
+	const uint8_t *data,
+	size_t length,
+	uint64_t data_offset,
+	uint64_t size)
+{
+	reset_source(source);
+
+	//A window may hold no byte yet, it is still addressable.
+	static const uint8_t empty_window = 0;
+
+	source->_data = data != NULL ? data : &empty_window;
+	source->_data_offset = data_offset;
+	source->_data_length = length;
+	source->_size = size;
+}
+
+bool ihr_source_from_reader(
+	Ihr_Source *source,
+	const Ihr_Reader *reader,
+	void *ctx)
+{
+	reset_source(source);
+
+	if (reader == NULL || reader->read_at == NULL || reader->size == NULL)
+		return false;
+
+	source->_reader = reader;
+	source->_reader_ctx = ctx;
+	source->_size = reader->size(ctx);
+
+	return true;
+}
+
+bool ihr_source_from_fd(
+	Ihr_Source *source,
+	int fd)
+{
+	reset_source(source);
+
+	File_Stat file_stat;
+
+	if (fd < 0 || stat_file(fd, &file_stat) != 0)
+		return false;
+
+	source->_reader = &_fd_reader;
+	source->_reader_ctx = (void *)(intptr_t)fd;
+	source->_size = file_stat.st_size > 0 ? (uint64_t)file_stat.st_size : 0ULL;
+
+	return true;
+}
+
+bool ihr_source_open_file(
+	Ihr_Source *source,
+	const char *path,
+	bool report_errors)
+{
+	int fd = open_file(path);
+
+	if (fd < 0)
+	{
+		if (report_errors == true)
+			perror(path);
+
+		reset_source(source);
+
+		return false;
+	}
+
+	if (ihr_source_from_fd(source, fd) == false)
+	{
+		if (report_errors == true)
+			perror(path);
+
+		close_file(fd);
+
+		return false;
+	}
+
+	source->_fd = fd;
+
+	return true;
+}
+
+bool ihr_source_map(Ihr_Source *source)
+{
+#if defined _WIN32 || defined _WIN64 || defined IHR_DISABLE_MMAP
+	(void)source;
+
+	return false;
+#else
+	if (source->_map != NULL)
+		return true;
+
+	//Only files read through the descriptor reader can be mapped, and a plan needs every read to be seen.
+	if (source->_reader != &_fd_reader || source->_plan != NULL ||
+		source->_size == 0 || source->_size > SIZE_MAX)
+		return false;
+
+	size_t length = (size_t)source->_size;
+
+	void *map = mmap(NULL, length, PROT_READ, MAP_SHARED, (int)(intptr_t)source->_reader_ctx, 0);
+
+	if (map == MAP_FAILED)
+		return false;
+
+	//Only headers are read, reading ahead would fault in the image data around them.
+	madvise(map, length, MADV_RANDOM);
+
+	source->_map = map;
+	source->_map_length = length;
+
+	source->_data = (const uint8_t *)map;
+	source->_data_offset = 0;
+	source->_data_length = length;
+
+	return true;
+#endif
+}
+
+void ihr_source_close(Ihr_Source *source)
+{
+#if !(defined _WIN32 || defined _WIN64 || defined IHR_DISABLE_MMAP)
+	if (source->_map != NULL)
+		munmap(source->_map, source->_map_length);
+#endif
+
+	if (source->_fd >= 0 && close_file(source->_fd) != 0)
+		perror("problem occurs when closing image file");
+
+	reset_source(source);
+}
+
+bool ihr_source_probe(Ihr_Source *source)
+{
+	if (source->_data != NULL || source->_probe_length != 0)
+		return true;
+
+	size_t length = source->_size < IHR_PROBE_SIZE ? (size_t)source->_size : IHR_PROBE_SIZE;
+
+	if (read_reader_at(source, 0, length, source->_probe) == false)
+		return false;
+
+	source->_probe_length = length;
+
+	return true;
+}
+
+size_t ihr_source_buffered_length(
+	const Ihr_Source *source,
+	uint64_t offset)
+{
+	if (source->_data != NULL)
+	{
+		if (offset < source->_data_offset || offset - source->_data_offset >= source->_data_length)
+			return 0;
+
+		return source->_data_length - (size_t)(offset - source->_data_offset);
+	}
+
+	return offset < source->_probe_length ? source->_probe_length - (size_t)offset : 0;
+}
+
+bool ihr_source_read(
+	Ihr_Source *source,
+	uint64_t offset,
+	size_t length,
+	void *buffer)
+{
+	if (is_range_valid(source, offset, length) == false)
+		return false;
+
+	if (length == 0)
+		return true;
+
+	if (source->_data != NULL)
+	{
+		const uint8_t *data = find_data(source, offset, length);
+
+		if (data == NULL)
+			return false;
+
+		memcpy(buffer, data, length);
+
+		return true;
+	}
+
+	if (offset + length <= source->_probe_length)
+	{
+		memcpy(buffer, source->_probe + offset, length);
+
+		return true;
+	}
+
+	return read_reader_at(source, offset, length, (uint8_t *)buffer);
+}
+
+const uint8_t *ihr_source_view(
+	Ihr_Source *source,
+	uint64_t offset,
+	size_t length,
+	uint8_t *scratch)
+{
+	if (source->_data != NULL)
+		return find_data(source, offset, length);
+
+	if (offset <= source->_probe_length && length <= source->_probe_length - offset)
+		return source->_probe + offset;
+
+	return ihr_source_read(source, offset, length, scratch) ? scratch : NULL;
+}
@@ -0,0 +1,166 @@
+#ifndef IMAGESOURCE_H
+#define IMAGESOURCE_H
+
+#include "ImageHeaderResolver.h"
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//Capacity of the prefix read once from a reader before anything is resolved.
+#define IHR_PROBE_SIZE 4096
+
+//Tif files from this size(in byte) on are mapped instead of read, see ihr_source_map.
+#ifndef IHR_MAP_THRESHOLD
+#define IHR_MAP_THRESHOLD (8ULL << 20)
+#endif
+
+/**
+* The byte source every resolver reads from.
+* A source is either addressable, in which case the whole content lives in memory and views
+* are handed out without any copy, or backed by an Ihr_Reader, in which case the requested
+* bytes are read into the scratch buffer provided by the caller. Files are read through the
+* built-in descriptor reader, which issues a single positioned read(pread) per request, so no
+* stdio buffer is filled and the file position is never moved.
+* A reader backed source reads its prefix(the probe) with one read before the format is
+* detected, views that fall inside the probe point into it, so the detector and the parsers
+* share the same bytes and only go back to the reader for bytes beyond it.
+* A window source is an addressable source holding only [_data_offset, _data_offset + _data_length)
+* of the content, as fed by a stream so far. Reading beyond the window marks the source as starved
+* instead of failing for good, so the resolver can be run again once more bytes arrive.
+* All accesses are bounds checked against the size of the content.
+*/
+typedef struct Image_Source
+{
+	const uint8_t       *_data;                     //the content of an addressable source, otherwise NULL
+	uint64_t            _data_offset;               //offset of the first byte of _data in the content
+	size_t              _data_length;               //number of bytes of the content _data holds
+	bool                _starved;                   //whether a read went beyond the bytes of a window source
+	uint64_t            _lowest_offset;             //lowest offset asked of an addressable source, UINT64_MAX if none
+	const Ihr_Reader    *_reader;                   //the reader of a reader backed source, otherwise NULL
+	void                *_reader_ctx;               //context passed to every call of the reader
+	int                 _fd;                        //descriptor opened by the source itself, otherwise -1
+	uint64_t            _size;                      //size of the content(in byte)
+	Ihr_Read_Plan       *_plan;                     //where the ranges read are recorded, can be NULL
+	Ihr_Context         *_context;                  //where buffers and pages come from, NULL for the heap
+	uint32_t            _read_calls;                //number of reads issued to the reader
+	uint64_t            _bytes_read;                //number of bytes read from the reader
+	size_t              _probe_length;              //number of valid bytes in the probe
+	void                *_map;                      //mapping of the file made by ihr_source_map, otherwise NULL
+	size_t              _map_length;                //length of _map
+	uint8_t             _probe[IHR_PROBE_SIZE];     //the prefix of a reader backed source
+} Ihr_Source;
+
+/**
+* @brief Set up an addressable source over a memory buffer, the buffer is not copied.
+*/
+void ihr_source_from_memory(Ihr_Source *source, const uint8_t *data, size_t size);
+
+/**
+* @brief Set up a window source over the bytes of a stream received so far, the bytes are not copied.
+* @param[in] data bytes received, starting from offset data_offset of the stream
+* @param[in] size size of the whole stream, UINT64_MAX if it is unknown
+*/
+void ihr_source_from_window(
+	Ihr_Source *source,
+	const uint8_t *data,
+	size_t length,
+	uint64_t data_offset,
+	uint64_t size);
+
+/**
+* @brief Set up a source reading through the given reader.
+* @return true for success, false for failure
+*/
+bool ihr_source_from_reader(Ihr_Source *source, const Ihr_Reader *reader, void *ctx);
+
+/**
+* @brief Open the given file as a source read through the descriptor reader.
+* @param[in] report_errors whether a failure is printed through perror, batches leave it to the
+* result instead so workers do not contend on stderr
+* @return true for success, false for failure
+*/
+bool ihr_source_open_file(Ihr_Source *source, const char *path, bool report_errors);
+
+/**
+* @brief Use a descriptor opened by the caller as a source, the descriptor is left open when the
+* source is closed.
+* @return true for success, false for failure
+*/
+bool ihr_source_from_fd(Ihr_Source *source, int fd);
+
+/**
+* @brief The built-in reader over a descriptor, the descriptor is passed as the context through
+* (void *)(intptr_t)fd.
+*/
+const Ihr_Reader *ihr_source_fd_reader(void);
+
+/**
+* @brief Map the file behind a descriptor reader source, the source becomes addressable and the
+* resolvers read directories and values straight from the mapping, still bounds checked.
+* The mapping is advised for random access, so only the pages holding headers are faulted in.
+* Nothing is done on Windows, for other readers, or when a plan is recorded.
+* @return true if the source is mapped, false if it is left as it is
+*/
+bool ihr_source_map(Ihr_Source *source);
+
+/**
+* @brief Release what the source holds(its descriptor and mapping), the memory buffer of an
+* addressable source, the reader and the descriptor of the caller are not touched.
+*/
+void ihr_source_close(Ihr_Source *source);
+
+/**
+* @brief Read the prefix of a reader backed source into the probe with a single read, the probe
+* is sized to the smaller one of the content and IHR_PROBE_SIZE.
+* Nothing is done for addressable sources or when the probe is already loaded.
+* @return true for success, false for failure
+*/
+bool ihr_source_probe(Ihr_Source *source);
+
+/**
+* @brief Number of bytes starting at offset that can be viewed without going to the reader.
+*/
+size_t ihr_source_buffered_length(const Ihr_Source *source, uint64_t offset);
+
+/**
+* @brief Get a view of [offset, offset + length) of the source.
+* @param[in] scratch buffer of at least length bytes, only used when the bytes are not in memory
+* @return pointer to the requested bytes, or NULL if the range is out of the content or fails to be read
+*/
+const uint8_t *ihr_source_view(
+	Ihr_Source *source,
+	uint64_t offset,
+	size_t length,
+	uint8_t *scratch);
+
+/**
+* @brief Copy [offset, offset + length) of the source into buffer.
+* @return true for success, false for failure
+*/
+bool ihr_source_read(
+	Ihr_Source *source,
+	uint64_t offset,
+	size_t length,
+	void *buffer);
+
+static inline bool ihr_source_is_addressable(const Ihr_Source *source)
+{
+	return source->_data != NULL;
+}
+
+/**
+* @brief Resolve the image behind the source into image_info, which must be initialized.
+* @details Every entry point ends here once it has set up its source.
+* @return true for success, false for failure
+*/
+bool ihr_resolve_source(Ihr_Source *source, Image_Info *image_info);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,96 @@
+#if defined _WIN32 || defined _WIN64
+#define _CRT_SECURE_NO_WARNINGS
+#include <windows.h>
+#include <io.h>
+#include <fcntl.h>
+#define open_file(path) _open(path, _O_RDONLY | _O_BINARY)
+#define close_file(fd) _close(fd)
+#else
+#define _FILE_OFFSET_BITS 64
+#define _POSIX_C_SOURCE 200809L
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#define open_file(path) open(path, O_RDONLY | O_CLOEXEC)
+#define close_file(fd) close(fd)
+#endif
+
+#include "ImageHeaderResolver.h"
+#include "ImageSource.h"
+#include <stdio.h>
+
+static void wait_latency(uint32_t latency_us)
+{
+	if (latency_us == 0)
+		return;
+
+#if defined _WIN32 || defined _WIN64
+	Sleep((latency_us + 999) / 1000);
+#else
+	struct timespec duration;
+	duration.tv_sec = (time_t)(latency_us / 1000000);
+	duration.tv_nsec = (long)(latency_us % 1000000) * 1000L;
+
+	while (nanosleep(&duration, &duration) != 0)
+		;
+#endif
+}
+
+static bool latency_read_at(
+	void *ctx,
+	uint64_t offset,
+	size_t length,
+	void *buffer)
+{
+	Ihr_Latency_Reader *reader = (Ihr_Latency_Reader *)ctx;
+
+	//Every request pays the round trip to the store, no matter how many bytes it asks for.
+	wait_latency(reader->_latency_us);
+
+	++reader->_read_calls;
+
+	if (ihr_source_fd_reader()->read_at((void *)(intptr_t)reader->_fd, offset, length, buffer) == false)
+		return false;
+
+	reader->_bytes_read += length;
+
+	return true;
+}
+
+static uint64_t latency_size(void *ctx)
+{
+	return ((Ihr_Latency_Reader *)ctx)->_size;
+}
+
+bool ihr_latency_reader_open(
+	Ihr_Latency_Reader *reader,
+	const char *path,
+	uint32_t latency_us)
+{
+	reader->_reader.read_at = &latency_read_at;
+	reader->_reader.size = &latency_size;
+	reader->_latency_us = latency_us;
+	reader->_read_calls = 0;
+	reader->_bytes_read = 0;
+	reader->_size = 0;
+	reader->_fd = open_file(path);
+
+	if (reader->_fd < 0)
+	{
+		perror(path);
+
+		return false;
+	}
+
+	reader->_size = ihr_source_fd_reader()->size((void *)(intptr_t)reader->_fd);
+
+	return true;
+}
+
+void ihr_latency_reader_close(Ihr_Latency_Reader *reader)
+{
+	if (reader->_fd >= 0 && close_file(reader->_fd) != 0)
+		perror("problem occurs when closing image file");
+
+	reader->_fd = -1;
+}
@@ -0,0 +1,119 @@
+#include "MarkerScanner.h"
+#include <stddef.h>
+#include <string.h>
+
+#if (defined __x86_64__ || defined _M_X64 || defined __SSE2__) && !defined IHR_DISABLE_SIMD
+#define IHR_SCAN_SSE2 1
+#include <emmintrin.h>
+#endif
+
+//Runtime dispatch to AVX2 relies on the target attribute of gcc and clang.
+#if defined IHR_SCAN_SSE2 && defined __GNUC__
+#define IHR_SCAN_AVX2 1
+#include <immintrin.h>
+#endif
+
+static inline const uint8_t *scan_marker_scalar(
+	const uint8_t *begin,
+	const uint8_t *end)
+{
+	const uint8_t *found = (const uint8_t *)memchr(begin, 0xff, (size_t)(end - begin));
+
+	return found == NULL ? end : found;
+}
+
+#ifdef IHR_SCAN_SSE2
+static inline int first_bit(unsigned int mask)
+{
+#ifdef __GNUC__
+	return __builtin_ctz(mask);
+#else
+	int index = 0;
+
+	while ((mask & 1u) == 0)
+	{
+		mask >>= 1;
+		++index;
+	}
+
+	return index;
+#endif
+}
+
+static const uint8_t *scan_marker_sse2(
+	const uint8_t *begin,
+	const uint8_t *end)
+{
+	const __m128i marker = _mm_set1_epi8((char)0xff);
+
+	while (end - begin >= 16)
+	{
+		__m128i block = _mm_loadu_si128((const __m128i *)begin);
+
+		unsigned int mask = (unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(block, marker));
+
+		if (mask != 0)
+			return begin + first_bit(mask);
+
+		begin += 16;
+	}
+
+	return scan_marker_scalar(begin, end);
+}
+#endif
+
+#ifdef IHR_SCAN_AVX2
+__attribute__((target("avx2")))
+static const uint8_t *scan_marker_avx2(
+	const uint8_t *begin,
+	const uint8_t *end)
+{
+	const __m256i marker = _mm256_set1_epi8((char)0xff);
+
+	while (end - begin >= 64)
+	{
+		__m256i low = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)begin), marker);
+		__m256i high = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(begin + 32)), marker);
+
+		//Most blocks hold no mark at all, test both halves at once.
+		if (_mm256_testz_si256(_mm256_or_si256(low, high), _mm256_or_si256(low, high)) == 0)
+		{
+			unsigned int mask = (unsigned int)_mm256_movemask_epi8(low);
+
+			if (mask != 0)
+				return begin + first_bit(mask);
+
+			return begin + 32 + first_bit((unsigned int)_mm256_movemask_epi8(high));
+		}
+
+		begin += 64;
+	}
+
+	return scan_marker_sse2(begin, end);
+}
+
+static int avx2_support = -1;
+#endif
+
+const uint8_t *ihr_scan_marker(
+	const uint8_t *begin,
+	const uint8_t *end)
+{
+	if (begin >= end)
+		return end;
+
+#if defined IHR_SCAN_AVX2
+	//A benign race, every thread stores the same answer.
+	if (avx2_support < 0)
+		avx2_support = __builtin_cpu_supports("avx2") ? 1 : 0;
+
+	if (avx2_support == 1)
+		return scan_marker_avx2(begin, end);
+#endif
+
+#if defined IHR_SCAN_SSE2
+	return scan_marker_sse2(begin, end);
+#else
+	return scan_marker_scalar(begin, end);
+#endif
+}
@@ -0,0 +1,14 @@
+#ifndef MARKERSCANNER_H
+#define MARKERSCANNER_H
+
+#include <stdint.h>
+
+/**
+* @brief Find the first 0xff byte(the jpeg symbol mark indicator) in [begin, end).
+* @details The block is scanned with AVX2 when the processor supports it, SSE2 otherwise on
+* x86 processors, and through memchr everywhere else.
+* @return pointer to the first 0xff byte, or end if there is none
+*/
+const uint8_t *ihr_scan_marker(const uint8_t *begin, const uint8_t *end);
+
+#endif
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+
+/**
+* A bounded multi-producer multi-consumer ring without locks.
+* Every cell carries a sequence number telling whose turn it is: a producer claims the cell at
+* the enqueue position when the sequence equals the position, a consumer claims the cell at the
+* dequeue position when the sequence is one past it. Claims are a single compare-and-swap on the
+* position, so producers and consumers only ever contend with their own kind.
+*/
+template<typename T>
+class Mpmc_Ring
+{
+public:
+	/**@param[in] capacity number of values the ring holds at least, rounded up to a power of two*/
+	explicit Mpmc_Ring(std::size_t capacity)
+	{
+		std::size_t size = 2;
+
+		while(size < capacity)
+			size <<= 1;
+
+		_cells.reset(new Cell[size]);
+		_mask = size - 1;
+
+		for(std::size_t i = 0; i < size; ++i)
+			_cells[i]._sequence.store(i, std::memory_order_relaxed);
+	}
+
+	Mpmc_Ring(const Mpmc_Ring &) = delete;
+	Mpmc_Ring &operator=(const Mpmc_Ring &) = delete;
+
+	std::size_t capacity() const { return _mask + 1; }
+
+	/**@return false if the ring is full*/
+	bool try_push(T &&value)
+	{
+		std::size_t position = _enqueue_position.load(std::memory_order_relaxed);
+
+		for(;;)
+		{
+			Cell &cell = _cells[position & _mask];
+
+			std::size_t sequence = cell._sequence.load(std::memory_order_acquire);
+
+			std::ptrdiff_t difference = static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(position);
+
+			if(difference == 0)
+			{
+				if(_enqueue_position.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+				{
+					cell._value = std::move(value);
+
+					cell._sequence.store(position + 1, std::memory_order_release);
+
+					return true;
+				}
+			}
+			else if(difference < 0)
+				return false;
+			else
+				position = _enqueue_position.load(std::memory_order_relaxed);
+		}
+	}
+
+	/**@return false if the ring is empty*/
+	bool try_pop(T &value)
+	{
+		std::size_t position = _dequeue_position.load(std::memory_order_relaxed);
+
+		for(;;)
+		{
+			Cell &cell = _cells[position & _mask];
+
+			std::size_t sequence = cell._sequence.load(std::memory_order_acquire);
+
+			std::ptrdiff_t difference = static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(position + 1);
+
+			if(difference == 0)
+			{
+				if(_dequeue_position.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+				{
+					value = std::move(cell._value);
+
+					//The cell is free again for the producer one lap ahead.
+					cell._sequence.store(position + _mask + 1, std::memory_order_release);
+
+					return true;
+				}
+			}
+			else if(difference < 0)
+				return false;
+			else
+				position = _dequeue_position.load(std::memory_order_relaxed);
+		}
+	}
+
+private:
+	struct Cell
+	{
+		std::atomic<std::size_t> _sequence;
+		T _value;
+	};
+
+	std::unique_ptr<Cell[]> _cells;
+	std::size_t _mask = 0;
+
+	//Producers and consumers spin on their own position, keep them on different cache lines.
+	alignas(64) std::atomic<std::size_t> _enqueue_position{0};
+	alignas(64) std::atomic<std::size_t> _dequeue_position{0};
+};
@@ -0,0 +1,164 @@
+#include "ThreadPool.hpp"
+#include <algorithm>
+
+//The pool and the index of the worker running on this thread.
+static thread_local const Thread_Pool *_current_pool = nullptr;
+static thread_local int _current_worker = -1;
+
+Thread_Pool::Thread_Pool(unsigned int thread_count)
+{
+    if(thread_count == 0)
+        thread_count = std::max(1u, std::thread::hardware_concurrency());
+
+    _workers.reserve(thread_count);
+
+    for(unsigned int i = 0; i < thread_count; ++i)
+        _workers.emplace_back(new Worker);
+
+    //Workers are started once every deque exists, as they steal from each other.
+    for(unsigned int i = 0; i < thread_count; ++i)
+        _workers[i]->_thread = std::thread(&Thread_Pool::run, this, i);
+}
+
+Thread_Pool::~Thread_Pool()
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        _stopping = true;
+    }
+
+    _task_ready.notify_all();
+
+    for(auto &worker : _workers)
+        worker->_thread.join();
+}
+
+void Thread_Pool::submit(std::function<void()> task)
+{
+    int current = current_worker();
+
+    unsigned int worker = current >= 0 ? static_cast<unsigned int>(current) :
+        _next_worker.fetch_add(1, std::memory_order_relaxed) % thread_count();
+
+    submit_to(worker, std::move(task));
+}
+
+void Thread_Pool::submit_to(unsigned int worker, std::function<void()> task)
+{
+    _unfinished.fetch_add(1);
+
+    {
+        Worker &target = *_workers[worker % thread_count()];
+
+        std::lock_guard<std::mutex> lock(target._mutex);
+
+        target._tasks.push_back(std::move(task));
+    }
+
+    _queued.fetch_add(1);
+
+    //A worker going to sleep counts itself before it checks _queued, so one of the two sees the other.
+    if(_sleeping.load() != 0)
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        _task_ready.notify_one();
+    }
+}
+
+void Thread_Pool::wait_idle()
+{
+    std::unique_lock<std::mutex> lock(_mutex);
+
+    _idle.wait(lock, [this] { return _unfinished.load() == 0; });
+}
+
+std::uint64_t Thread_Pool::steals(unsigned int worker) const
+{
+    return _workers[worker]->_steals.load(std::memory_order_relaxed);
+}
+
+int Thread_Pool::current_worker() const
+{
+    return _current_pool == this ? _current_worker : -1;
+}
+
+bool Thread_Pool::take_task(unsigned int index, std::function<void()> &task)
+{
+    {
+        Worker &own = *_workers[index];
+
+        std::lock_guard<std::mutex> lock(own._mutex);
+
+        if(own._tasks.empty() == false)
+        {
+            task = std::move(own._tasks.back());
+
+            own._tasks.pop_back();
+
+            return true;
+        }
+    }
+
+    //Steal from the others, starting next to this worker so thieves spread over the victims.
+    for(unsigned int offset = 1; offset < thread_count(); ++offset)
+    {
+        Worker &victim = *_workers[(index + offset) % thread_count()];
+
+        std::lock_guard<std::mutex> lock(victim._mutex);
+
+        if(victim._tasks.empty() == false)
+        {
+            task = std::move(victim._tasks.front());
+
+            victim._tasks.pop_front();
+
+            _workers[index]->_steals.fetch_add(1, std::memory_order_relaxed);
+
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void Thread_Pool::run(unsigned int index)
+{
+    _current_pool = this;
+    _current_worker = static_cast<int>(index);
+
+    std::function<void()> task;
+
+    for(;;)
+    {
+        if(take_task(index, task) == true)
+        {
+            _queued.fetch_sub(1);
+
+            task();
+
+            task = nullptr;
+
+            if(_unfinished.fetch_sub(1) == 1)
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+
+                _idle.notify_all();
+            }
+
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(_mutex);
+
+        _sleeping.fetch_add(1);
+
+        _task_ready.wait(lock, [this] { return _queued.load() != 0 || _stopping; });
+
+        _sleeping.fetch_sub(1);
+
+        if(_queued.load() == 0 && _stopping)
+            return;
+    }
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+* The work-stealing pool the batch and queue interfaces run on.
+* Every worker owns a deque of tasks, it takes its own tasks from the back(the most recently
+* pushed, still warm in cache) and steals from the front of the other deques when it runs out,
+* so workers contend only when one of them is stealing. A task submitted from a worker goes to
+* the deque of that worker, tasks submitted from outside are spread over the deques in turn.
+*/
+class Thread_Pool
+{
+public:
+	/**@param[in] thread_count number of workers, 0 for one per hardware thread*/
+	explicit Thread_Pool(unsigned int thread_count);
+
+	/**@brief finish every task submitted, then stop the workers*/
+	~Thread_Pool();
+
+	Thread_Pool(const Thread_Pool &) = delete;
+	Thread_Pool &operator=(const Thread_Pool &) = delete;
+
+	unsigned int thread_count() const { return static_cast<unsigned int>(_workers.size()); }
+
+	void submit(std::function<void()> task);
+
+	/**@brief submit a task to the deque of the given worker, others can still steal it*/
+	void submit_to(unsigned int worker, std::function<void()> task);
+
+	/**@brief wait until every task submitted so far is done*/
+	void wait_idle();
+
+	/**@brief number of tasks the given worker stole from the others*/
+	std::uint64_t steals(unsigned int worker) const;
+
+	/**@brief index of the worker running the calling thread, -1 if it is not a worker of this pool*/
+	int current_worker() const;
+
+private:
+	struct Worker
+	{
+		std::mutex _mutex;
+		std::deque<std::function<void()>> _tasks;
+		std::atomic<std::uint64_t> _steals{0};
+		std::thread _thread;
+	};
+
+	void run(unsigned int index);
+
+	bool take_task(unsigned int index, std::function<void()> &task);
+
+private:
+	std::vector<std::unique_ptr<Worker>> _workers;
+
+	std::atomic<unsigned int> _next_worker{0};
+
+	//Tasks in the deques, and tasks submitted and not finished yet.
+	std::atomic<std::size_t> _queued{0};
+	std::atomic<std::size_t> _unfinished{0};
+
+	//Only idle workers and waiters take the mutex, to sleep.
+	std::mutex _mutex;
+	std::condition_variable _task_ready;
+	std::condition_variable _idle;
+	std::atomic<unsigned int> _sleeping{0};
+	bool _stopping = false;
+};
@@ -0,0 +1,710 @@
+#include "TiffParser.h"
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <type_traits>
+#if defined _MSC_VER && !defined __cpp_lib_byteswap
+#include <stdlib.h>
+#endif
+
+/**
+* The tif parser, one template instantiated for each variant: classic or big tif, little or big
+* endian. Everything depending on the variant(the byte order, the widths of offsets, counts and
+* entries) is a compile time constant of the instance, so the directory walk has no branch on it
+* and every load is a plain load, byte swapped or not. The variant is picked once per file from its
+* header, the C resolver goes through the Tiff_Parser of the instance.
+*/
+
+//Data types of directory entries(only the ones our program concerns).
+enum class Entry_Type : std::uint16_t
+{
+    u8 = 1,                     //BYTE
+    u16 = 3,                    //SHORT
+    u32 = 4,                    //LONG
+    s8 = 6,                     //SBYTE
+    s16 = 8,                    //SSHORT
+    s32 = 9,                    //SLONG
+    u64 = 16,                   //LONG8
+    s64 = 17                    //SLONG8
+};
+
+//Tiff tag reference(only baseline tags).
+enum class Tiff_Tag : std::uint16_t
+{
+    no_reference = 0x0000,
+    new_subfile_type = 0x00fe,
+    subfile_type = 0x00ff,
+    image_width = 0x0100,
+    image_height = 0x0101,
+    bits_per_sample = 0x0102,
+    compression = 0x0103,
+    photo_metric_interpretation = 0x0106,
+    thresholding = 0x0107,
+    cell_width = 0x0108,
+    cell_height = 0x0109,
+    fill_order = 0x010a,
+    image_description = 0x010e,
+    scanner_maker = 0x010f,
+    scanner_model = 0x0110,
+    strip_offset = 0x0111,
+    orientation = 0x0112,
+    samples_per_pixel = 0x0115,
+    rows_per_strip = 0x0116,
+    strip_byte_count = 0x0117,
+    min_sample_value = 0x0118,
+    max_sample_value = 0x0119,
+    xresolution = 0x011a,
+    yresolution = 0x011b,
+    planar_configuration = 0x011c,
+    free_offset = 0x0120,
+    free_byte_count = 0x0121,
+    gray_response_unit = 0x0122,
+    gray_response_curve = 0x0123,
+    resolution_unit = 0x0128,
+    software = 0x0131,
+    date_time = 0x0132,
+    artist = 0x013b,
+    host_computer = 0x013c,
+    color_map = 0x0140,
+    extra_samples = 0x0152,
+    copyright = 0x8298
+};
+
+//New subfile type of image file directory that uses bit mask.
+static const std::uint64_t nst_reduced_image = 0x01;
+static const std::uint64_t nst_transparent_mask = 0x04;
+static const std::uint64_t nst_depth_map = 0x08;
+
+//Subfile type of image directory that uses value(this field is deprecated).
+static const std::uint64_t st_filetype_reduced_image = 2;
+
+//Out-of-line values of concern a directory has at most when every tag of concern appears once, as in a valid file.
+static const std::size_t inline_value_refs = 8;
+
+//Out-of-line values no further apart than this(in byte) are read together.
+static const std::uint64_t value_gap = 4096;
+
+//An out-of-line value of a directory entry, gathered with the other ones of the directory.
+struct Tiff_Value_Ref
+{
+    std::uint64_t _offset;      //where the value is in the file
+    std::uint64_t _size;        //size of the value(in byte)
+    const std::uint8_t *_data;  //the value once gathered
+};
+
+//The out-of-line values of a directory in entry order, held in place unless the directory has more.
+struct Tiff_Value_Refs
+{
+    Tiff_Value_Ref _inline_refs[inline_value_refs];
+    Tiff_Value_Ref *_inline_pending[inline_value_refs];
+
+    Tiff_Value_Ref *_refs = _inline_refs;
+    Tiff_Value_Ref **_pending = _inline_pending;   //room for sorting the refs to read by offset
+    std::size_t _count = 0;
+    std::size_t _capacity = inline_value_refs;
+
+    Tiff_Value_Refs() = default;
+
+    Tiff_Value_Refs(const Tiff_Value_Refs &) = delete;
+    Tiff_Value_Refs &operator=(const Tiff_Value_Refs &) = delete;
+
+    ~Tiff_Value_Refs()
+    {
+        if(_refs != _inline_refs)
+        {
+            std::free(_refs);
+            std::free(_pending);
+        }
+    }
+
+    bool push(const Tiff_Value_Ref &ref)
+    {
+        if(_count == _capacity)
+        {
+            std::size_t capacity = _capacity * 2;
+
+            Tiff_Value_Ref *refs = static_cast<Tiff_Value_Ref *>(std::malloc(capacity * sizeof(Tiff_Value_Ref)));
+            Tiff_Value_Ref **pending = static_cast<Tiff_Value_Ref **>(std::malloc(capacity * sizeof(Tiff_Value_Ref *)));
+
+            if(refs == nullptr || pending == nullptr)
+            {
+                std::perror("");//Run out of memory.
+
+                std::free(refs);
+                std::free(pending);
+
+                return false;
+            }
+
+            std::memcpy(refs, _refs, _count * sizeof(Tiff_Value_Ref));
+
+            if(_refs != _inline_refs)
+            {
+                std::free(_refs);
+                std::free(_pending);
+            }
+
+            _refs = refs;
+            _pending = pending;
+            _capacity = capacity;
+        }
+
+        _refs[_count++] = ref;
+
+        return true;
+    }
+};
+
+template<typename T>
+static inline T swap_bytes(T value)
+{
+#ifdef __cpp_lib_byteswap
+    return std::byteswap(value);
+#else
+    using Unsigned = std::make_unsigned_t<T>;
+
+    Unsigned bits = static_cast<Unsigned>(value);
+
+    if constexpr(sizeof(T) == 1)
+        return value;
+#if defined _MSC_VER
+    else if constexpr(sizeof(T) == 2)
+        bits = _byteswap_ushort(bits);
+    else if constexpr(sizeof(T) == 4)
+        bits = _byteswap_ulong(bits);
+    else
+        bits = _byteswap_uint64(bits);
+#else
+    else if constexpr(sizeof(T) == 2)
+        bits = __builtin_bswap16(bits);
+    else if constexpr(sizeof(T) == 4)
+        bits = __builtin_bswap32(bits);
+    else
+        bits = __builtin_bswap64(bits);
+#endif
+
+    return static_cast<T>(bits);
+#endif
+}
+
+/**
+* Merge the sorted refs from begin on that are close enough to be read with it, end is set to the
+* first ref left out.
+* @return the end of the range the merged refs take
+*/
+static std::uint64_t merge_value_range(Tiff_Value_Ref *const *refs, std::size_t begin, std::size_t count, std::size_t &end)
+{
+    std::uint64_t range_end = refs[begin]->_offset + refs[begin]->_size;
+
+    std::size_t i = begin + 1;
+
+    for(; i != count && refs[i]->_offset <= range_end + value_gap; ++i)
+    {
+        if(refs[i]->_offset + refs[i]->_size > range_end)
+            range_end = refs[i]->_offset + refs[i]->_size;
+    }
+
+    end = i;
+
+    return range_end;
+}
+
+/**
+* Read the out-of-line values of a directory, refs in entry order. Values viewed without a read(the
+* source is addressable or they are in the probe) are left where they are, the other ones are sorted
+* by offset and the ones close to each other are read as a single range into the content buffer,
+* so a directory takes one read for all of its values in the common case.
+*/
+static bool gather_values(Ihr_Source *source, Tiff_Value_Refs &refs, Tiff_Buffers *buffers)
+{
+    //Refs to read, sorted by offset once all are known.
+    Tiff_Value_Ref **pending = refs._pending;
+    std::size_t pending_count = 0;
+
+    for(std::size_t i = 0; i != refs._count; ++i)
+    {
+        Tiff_Value_Ref *ref = &refs._refs[i];
+
+        if(ref->_offset > source->_size || ref->_size > source->_size - ref->_offset)
+            return false;
+
+        if(ihr_source_is_addressable(source) || ihr_source_buffered_length(source, ref->_offset) >= ref->_size)
+        {
+            ref->_data = ihr_source_view(source, ref->_offset, static_cast<std::size_t>(ref->_size), nullptr);
+
+            if(ref->_data == nullptr)
+                return false;
+
+            continue;
+        }
+
+        pending[pending_count++] = ref;
+    }
+
+    if(pending_count == 0)
+        return true;
+
+    std::sort(pending, pending + pending_count,
+        [](const Tiff_Value_Ref *left, const Tiff_Value_Ref *right) { return left->_offset < right->_offset; });
+
+    //Size the content buffer to the ranges read, the gaps inside a range included.
+    std::uint64_t total_size = 0;
+
+    for(std::size_t begin = 0, end = 0; begin != pending_count; begin = end)
+        total_size += merge_value_range(pending, begin, pending_count, end) - pending[begin]->_offset;
+
+    if(buffers->_content == nullptr || buffers->_content_size < total_size)
+    {
+        std::free(buffers->_content);
+
+        buffers->_content = static_cast<std::uint8_t *>(std::malloc(static_cast<std::size_t>(total_size)));
+
+        if(buffers->_content == nullptr)
+        {
+            std::perror("");//Run out of memory.
+
+            buffers->_content_size = 0;
+
+            return false;
+        }
+
+        buffers->_content_size = total_size;
+    }
+
+    std::uint8_t *content = buffers->_content;
+
+    for(std::size_t begin = 0, end = 0; begin != pending_count; begin = end)
+    {
+        std::uint64_t range_begin = pending[begin]->_offset;
+        std::uint64_t range_end = merge_value_range(pending, begin, pending_count, end);
+
+        const std::uint8_t *range = ihr_source_view(source, range_begin, static_cast<std::size_t>(range_end - range_begin), content);
+
+        if(range == nullptr)
+            return false;
+
+        for(std::size_t i = begin; i != end; ++i)
+            pending[i]->_data = range + (pending[i]->_offset - range_begin);
+
+        content += range_end - range_begin;
+    }
+
+    return true;
+}
+
+template<bool Big_Tif, bool Little_Endian>
+class Tiff_Variant
+{
+public:
+    //Offsets, counts and values stored in entries, 4 bytes for classic tif, 8 bytes for big tif.
+    using Offset = std::conditional_t<Big_Tif, std::uint64_t, std::uint32_t>;
+
+    //Number of entries of a directory, 2 bytes for classic tif, 8 bytes for big tif.
+    using Entry_Count = std::conditional_t<Big_Tif, std::uint64_t, std::uint16_t>;
+
+    //The tag, the data type, the count and the value, 12 bytes for classic tif, 20 bytes for big tif.
+    static constexpr std::uint64_t entry_size = 4 + 2 * sizeof(Offset);
+
+    static const Tiff_Parser parser;
+
+    template<typename T>
+    static T load(const std::uint8_t *data)
+    {
+        T value;
+        std::memcpy(&value, data, sizeof(T));
+
+        if constexpr(Little_Endian != (std::endian::native == std::endian::little))
+            value = swap_bytes(value);
+
+        return value;
+    }
+
+    static Offset convert_value(Entry_Type data_type, const std::uint8_t *content)
+    {
+        switch(data_type)
+        {
+            case Entry_Type::u8:
+                return static_cast<Offset>(load<std::uint8_t>(content));
+            case Entry_Type::u16:
+                return static_cast<Offset>(load<std::uint16_t>(content));
+            case Entry_Type::u32:
+                return static_cast<Offset>(load<std::uint32_t>(content));
+            case Entry_Type::u64:
+                return static_cast<Offset>(load<std::uint64_t>(content));
+            case Entry_Type::s8:
+                return static_cast<Offset>(load<std::int8_t>(content));
+            case Entry_Type::s16:
+                return static_cast<Offset>(load<std::int16_t>(content));
+            case Entry_Type::s32:
+                return static_cast<Offset>(load<std::int32_t>(content));
+            case Entry_Type::s64:
+                return static_cast<Offset>(load<std::int64_t>(content));
+            default:
+                return 0;
+        }
+    }
+
+    static std::uint64_t value_size(Entry_Type data_type, Offset count)
+    {
+        std::uint64_t size = count;
+
+        switch(data_type)
+        {
+            case Entry_Type::u16:
+            case Entry_Type::s16:
+                return size << 1;
+            case Entry_Type::u32:
+            case Entry_Type::s32:
+                return size << 2;
+            case Entry_Type::u64:
+            case Entry_Type::s64:
+                return size << 3;
+            default:
+                return size;
+        }
+    }
+
+    //The bits of every sample added up, wrapping around as the 16 bits of the color depth do.
+    template<typename T>
+    static std::uint16_t sum_samples(const std::uint8_t *content, Offset count)
+    {
+        std::uint16_t color_depth = 0;
+
+        for(std::uint64_t i = 0; i != static_cast<std::uint64_t>(count); ++i)
+            color_depth = static_cast<std::uint16_t>(color_depth + static_cast<std::uint16_t>(load<T>(content + i * sizeof(T))));
+
+        return color_depth;
+    }
+
+    static std::uint16_t bits_per_sample(Entry_Type data_type, Offset count, const std::uint8_t *content)
+    {
+        switch(data_type)
+        {
+            case Entry_Type::u8:
+                return sum_samples<std::uint8_t>(content, count);
+            case Entry_Type::u16:
+                return sum_samples<std::uint16_t>(content, count);
+            case Entry_Type::u32:
+                return sum_samples<std::uint32_t>(content, count);
+            case Entry_Type::u64:
+                return sum_samples<std::uint64_t>(content, count);
+            case Entry_Type::s8:
+                return sum_samples<std::int8_t>(content, count);
+            case Entry_Type::s16:
+                return sum_samples<std::int16_t>(content, count);
+            case Entry_Type::s32:
+                return sum_samples<std::int32_t>(content, count);
+            case Entry_Type::s64:
+                return sum_samples<std::int64_t>(content, count);
+            default:
+                return 0;
+        }
+    }
+
+    static bool resolve_entry(Image_Info *page, Tiff_Tag tag, Entry_Type data_type, Offset count, const std::uint8_t *content, bool &is_single_page)
+    {
+        switch(tag)
+        {
+            case Tiff_Tag::new_subfile_type:
+                is_single_page = (convert_value(data_type, content) & (nst_reduced_image | nst_transparent_mask | nst_depth_map)) == 0;
+            break;
+            case Tiff_Tag::subfile_type:
+                is_single_page = convert_value(data_type, content) != st_filetype_reduced_image;
+            break;
+            case Tiff_Tag::image_width:
+                page->_width = static_cast<std::uint32_t>(convert_value(data_type, content));
+            break;
+            case Tiff_Tag::image_height:
+                page->_height = static_cast<std::uint32_t>(convert_value(data_type, content));
+            break;
+            case Tiff_Tag::bits_per_sample:
+                if(page->_channels != 0 && page->_channels != count)
+                {
+                    //We encountered an inconsistency in tif file.
+                    std::printf("error in tif : the IHR_TIF_TAG_SAMPLES_PER_PIXEL value conflicts "
+                        "with the IHR_TIF_TAG_BITS_PER_SAMPLE value.");
+
+                    return false;
+                }
+
+                page->_color_depth = bits_per_sample(data_type, count, content);
+                page->_channels = static_cast<std::uint16_t>(count);
+            break;
+            case Tiff_Tag::samples_per_pixel:
+            {
+                Offset samples = convert_value(data_type, content);
+
+                if(page->_channels != 0 && page->_channels != samples)
+                {
+                    //We encountered an inconsistency in tif file.
+                    std::printf("error in tif : the IHR_TIF_TAG_SAMPLES_PER_PIXEL value conflicts "
+                        "with the IHR_TIF_TAG_BITS_PER_SAMPLE value.");
+
+                    return false;
+                }
+
+                page->_channels = static_cast<std::uint16_t>(samples);
+            }
+            break;
+            default:
+            break;
+        }
+
+        return true;
+    }
+
+    //Our program only concerns about tags from new_subfile_type to bits_per_sample and samples_per_pixel.
+    static bool is_tag_of_concern(std::uint16_t tag)
+    {
+        return (tag >= static_cast<std::uint16_t>(Tiff_Tag::new_subfile_type) && tag <= static_cast<std::uint16_t>(Tiff_Tag::bits_per_sample)) ||
+            tag == static_cast<std::uint16_t>(Tiff_Tag::samples_per_pixel);
+    }
+
+    static bool resolve_ifd(Ihr_Source *source, std::uint64_t ifd_pos, Image_Info *page, std::uint64_t *next_ifd_pos, Tiff_Buffers *buffers)
+    {
+        std::memset(page, 0, sizeof(Image_Info));
+
+        std::uint8_t number_scratch[8];
+        const std::uint8_t *number_data = ihr_source_view(source, ifd_pos, sizeof(Entry_Count), number_scratch);
+
+        if(number_data == nullptr)
+            return false;
+
+        Entry_Count entry_count = load<Entry_Count>(number_data);
+
+        //The entry list can never be larger than the file itself.
+        if(static_cast<std::uint64_t>(entry_count) > source->_size / entry_size)
+            return false;
+
+        std::uint64_t entry_list_size = entry_size * static_cast<std::uint64_t>(entry_count);
+
+        //The offset of the next directory follows the entry list, both are read at once.
+        std::uint64_t entry_list_read_size = entry_list_size + sizeof(Offset);
+
+        //Previous buffer is not allocated or is not big enough to store current entry lists.
+        if(ihr_source_is_addressable(source) == false &&
+           (buffers->_entry_list == nullptr || entry_list_read_size > buffers->_entry_list_size))
+        {
+            std::free(buffers->_entry_list);
+
+            buffers->_entry_list = static_cast<std::uint8_t *>(std::malloc(static_cast<std::size_t>(entry_list_read_size)));
+
+            buffers->_entry_list_size = entry_list_read_size;
+
+            //Memory allocation is failed.
+            if(buffers->_entry_list == nullptr)
+            {
+                std::perror("");
+
+                return false;
+            }
+        }
+
+        const std::uint8_t *entry_list = ihr_source_view(source, ifd_pos + sizeof(Entry_Count),
+            static_cast<std::size_t>(entry_list_read_size), buffers->_entry_list);
+
+        if(entry_list == nullptr)
+            return false;
+
+        //Out-of-line values of the entries of concern, in entry order.
+        Tiff_Value_Refs value_refs;
+
+        //The entries are passed twice, first to find the values stored out of the entry list, which
+        //are then read together, and then to resolve the entries.
+        for(int pass = 0; pass != 2; ++pass)
+        {
+            bool is_single_page = true;
+
+            std::size_t value_ref_index = 0;
+
+            for(Entry_Count i = 0; i != entry_count; ++i)
+            {
+                const std::uint8_t *entry = entry_list + entry_size * static_cast<std::uint64_t>(i);
+
+                std::uint16_t tag = load<std::uint16_t>(entry);//offset:0
+
+                if(is_tag_of_concern(tag) == false)
+                    continue;
+
+                Entry_Type data_type = static_cast<Entry_Type>(load<std::uint16_t>(entry + 2));//offset:2
+                Offset count = load<Offset>(entry + 4);//offset:4
+                const std::uint8_t *content = entry + 4 + sizeof(Offset);//offset:8 for classic tif, 12 for big tif
+
+                //A value is never larger than the file itself.
+                if(static_cast<std::uint64_t>(count) > source->_size)
+                    return false;
+
+                std::uint64_t content_size = value_size(data_type, count);
+
+                //The value can be stored in content, otherwise content is just an offset.
+                const std::uint8_t *content_ptr = content;
+
+                if(content_size > sizeof(Offset))
+                {
+                    if(pass == 0)
+                    {
+                        if(value_refs.push(Tiff_Value_Ref{ load<Offset>(content), content_size, nullptr }) == false)
+                            return false;
+
+                        continue;
+                    }
+
+                    content_ptr = value_refs._refs[value_ref_index++]._data;
+                }
+                else if(pass == 0)
+                    continue;
+
+                if(resolve_entry(page, static_cast<Tiff_Tag>(tag), data_type, count, content_ptr, is_single_page) == false)
+                    return false;
+            }
+
+            if(pass == 0)
+            {
+                if(gather_values(source, value_refs, buffers) == false)
+                    return false;
+
+                continue;
+            }
+
+            //Should be a valid image page, but the result is invalid, abort resolving.
+            if(is_single_page && (page->_width == 0 || page->_height == 0 || page->_color_depth == 0 || page->_channels == 0))
+                return false;
+        }
+
+        *next_ifd_pos = load<Offset>(entry_list + entry_list_size);
+
+        return true;
+    }
+
+    static bool read_next_ifd_pos(Ihr_Source *source, std::uint64_t ifd_pos, std::uint64_t *next_ifd_pos)
+    {
+        std::uint8_t number_scratch[8];
+        const std::uint8_t *number_data = ihr_source_view(source, ifd_pos, sizeof(Entry_Count), number_scratch);
+
+        if(number_data == nullptr)
+            return false;
+
+        Entry_Count entry_count = load<Entry_Count>(number_data);
+
+        if(static_cast<std::uint64_t>(entry_count) > source->_size / entry_size)
+            return false;
+
+        const std::uint8_t *next_ifd_data = ihr_source_view(source,
+            ifd_pos + sizeof(Entry_Count) + entry_size * static_cast<std::uint64_t>(entry_count), sizeof(Offset), number_scratch);
+
+        if(next_ifd_data == nullptr)
+            return false;
+
+        *next_ifd_pos = load<Offset>(next_ifd_data);
+
+        return true;
+    }
+
+    static bool resolve_pages(Image_Info *info, Ihr_Source *source, std::uint64_t first_ifd_pos)
+    {
+        //Only needed when the source is not addressable, otherwise views point into the source directly.
+        Tiff_Buffers buffers;
+        ihr_acquire_tiff_buffers(source, &buffers);
+
+        std::uint64_t next_ifd_pos = first_ifd_pos;
+
+        //Pointer of currently resolved image page.
+        Image_Info *current_page_ptr = nullptr;
+
+        Ifd_Cycle_Check cycle_check;
+        start_ifd_cycle_check(&cycle_check, first_ifd_pos);
+
+        bool success = true;
+
+        do
+        {
+            Image_Info current_page;
+
+            if(resolve_ifd(source, next_ifd_pos, &current_page, &next_ifd_pos, &buffers) == false ||
+               ihr_append_tif_page(info, &current_page_ptr, &current_page, source->_context) == false)
+            {
+                success = false;
+
+                break;
+            }
+
+            //A list looping back would never end, the file is rejected.
+            if(next_ifd_pos != 0 && next_ifd_pos < source->_size && ifd_list_loops(&cycle_check, next_ifd_pos))
+            {
+                success = false;
+
+                break;
+            }
+        //If the next ifd position is 0 or an invalid value(locate out of file), stop traversing the ifd list.
+        } while(next_ifd_pos != 0 && next_ifd_pos < source->_size);
+
+        //Deallocate the buffers last used, or hand them back to the context.
+        ihr_release_tiff_buffers(source, &buffers);
+
+        return success;
+    }
+};
+
+template<bool Big_Tif, bool Little_Endian>
+const Tiff_Parser Tiff_Variant<Big_Tif, Little_Endian>::parser =
+{
+    &Tiff_Variant::resolve_ifd,
+    &Tiff_Variant::read_next_ifd_pos,
+    &Tiff_Variant::resolve_pages
+};
+
+bool ihr_tiff_resolve_header(Ihr_Source *source, const Tiff_Parser **parser, uint64_t *first_ifd_pos)
+{
+    std::uint8_t scratch[16];
+    const std::uint8_t *file_header = ihr_source_view(source, 0, 8, scratch);
+
+    if(file_header == nullptr)
+        return false;
+
+    //The same check as the format detection, a byte order mark and 42(43 for big tif) in either order.
+    bool is_byte_order_mark = (file_header[0] == 0x49 && file_header[1] == 0x49) || (file_header[0] == 0x4d && file_header[1] == 0x4d);
+    bool is_version = ((file_header[2] == 0x2a || file_header[2] == 0x2b) && file_header[3] == 0) ||
+                      (file_header[2] == 0 && (file_header[3] == 0x2a || file_header[3] == 0x2b));
+
+    if(is_byte_order_mark == false || is_version == false)
+        return false;
+
+    bool is_little_endian = file_header[0] == 0x49 && file_header[1] == 0x49;
+
+    bool is_big_tif = file_header[2] == 0x2b || file_header[3] == 0x2b;
+
+    //The offset of the first directory follows the 0x0008 0x0000 of big tif.
+    if(is_big_tif)
+    {
+        file_header = ihr_source_view(source, 0, 16, scratch);
+
+        if(file_header == nullptr)
+            return false;
+    }
+
+    if(is_big_tif && is_little_endian)
+    {
+        *parser = &Tiff_Variant<true, true>::parser;
+        *first_ifd_pos = Tiff_Variant<true, true>::load<std::uint64_t>(file_header + 8);
+    }
+    else if(is_big_tif)
+    {
+        *parser = &Tiff_Variant<true, false>::parser;
+        *first_ifd_pos = Tiff_Variant<true, false>::load<std::uint64_t>(file_header + 8);
+    }
+    else if(is_little_endian)
+    {
+        *parser = &Tiff_Variant<false, true>::parser;
+        *first_ifd_pos = Tiff_Variant<false, true>::load<std::uint32_t>(file_header + 4);
+    }
+    else
+    {
+        *parser = &Tiff_Variant<false, false>::parser;
+        *first_ifd_pos = Tiff_Variant<false, false>::load<std::uint32_t>(file_header + 4);
+    }
+
+    return true;
+}
@@ -0,0 +1,107 @@
+#ifndef TIFFPARSER_H
+#define TIFFPARSER_H
+
+#include "ImageHeaderResolver.h"
+#include "ImageSource.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//Buffers the entry lists and the values are read into when the source is not addressable.
+typedef struct Tiff_Buffers
+{
+	uint8_t     *_entry_list;
+	uint64_t    _entry_list_size;
+	uint8_t     *_content;
+	uint64_t    _content_size;
+} Tiff_Buffers;
+
+/**
+* Detection of image file directory lists looping back(Brent's algorithm), in constant memory
+* however long the list is. Every offset of the list is checked in order, the one met at each power
+* of two steps is kept as the mark, a loop comes back to the mark within twice its length.
+*/
+typedef struct Ifd_Cycle_Check
+{
+	uint64_t    _mark;
+	uint64_t    _power;
+	uint64_t    _steps;
+} Ifd_Cycle_Check;
+
+static inline void start_ifd_cycle_check(Ifd_Cycle_Check *check, uint64_t first_ifd_pos)
+{
+	check->_mark = first_ifd_pos;
+	check->_power = 1;
+	check->_steps = 0;
+}
+
+//Check the offset of the next directory of the list, true if the list loops.
+static inline bool ifd_list_loops(Ifd_Cycle_Check *check, uint64_t ifd_pos)
+{
+	if(ifd_pos == check->_mark)
+		return true;
+
+	if(++check->_steps == check->_power)
+	{
+		check->_mark = ifd_pos;
+		check->_power <<= 1;
+		check->_steps = 0;
+	}
+
+	return false;
+}
+
+/**
+* The parser of a tif variant(classic or big tif, little or big endian), picked once per file from
+* its header. Every variant is an instance of the parser template of TiffParser.cpp, the byte order
+* and the widths of offsets and counts are fixed at compile time.
+*/
+typedef struct Tiff_Parser
+{
+	//Resolve the directory at ifd_pos into page, and tell where the next one is.
+	bool    (*_resolve_ifd)(Ihr_Source *source, uint64_t ifd_pos, Image_Info *page, uint64_t *next_ifd_pos,
+		Tiff_Buffers *buffers);
+
+	//Tell where the directory after the one at ifd_pos is, without going through its entries.
+	bool    (*_read_next_ifd_pos)(Ihr_Source *source, uint64_t ifd_pos, uint64_t *next_ifd_pos);
+
+	//Resolve the directory list from first_ifd_pos on into the page list of info.
+	bool    (*_resolve_pages)(Image_Info *info, Ihr_Source *source, uint64_t first_ifd_pos);
+} Tiff_Parser;
+
+/**
+* @brief Resolve the tif file header, which tells the byte order, the tif variant and where the
+* first image file directory is.
+* @param[out] parser the parser of the variant
+* @return true for success, false for failure or if the source is not a tif
+*/
+bool ihr_tiff_resolve_header(Ihr_Source *source, const Tiff_Parser **parser, uint64_t *first_ifd_pos);
+
+/**
+* @brief Append a resolved tif page to the page list, the first page is stored in info itself and
+* the following pages are allocated(taken from the arena of the context if any). *current_page_ptr
+* points to the last page of the list.
+*/
+bool ihr_append_tif_page(Image_Info *info, Image_Info **current_page_ptr, const Image_Info *page, Ihr_Context *context);
+
+/**
+* @brief Set up what the pages of a tif resolved directory by directory share(file size, format,
+* page count) and check them. The page list is released when anything is wrong.
+* @return true for success, false for failure
+*/
+bool ihr_finish_tif_pages(Image_Info *info, uint64_t file_size);
+
+//Get the buffers of the context of the source to read into, or empty ones allocated as they are needed.
+void ihr_acquire_tiff_buffers(Ihr_Source *source, Tiff_Buffers *buffers);
+
+//Hand the buffers back to the context of the source, or deallocate them.
+void ihr_release_tiff_buffers(Ihr_Source *source, Tiff_Buffers *buffers);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
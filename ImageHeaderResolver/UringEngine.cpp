@@ -0,0 +1,1006 @@
+#include "ImageHeaderResolver.h"
+#include "ImageSource.h"
+#include "TiffParser.h"
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+#include <vector>
+
+#if defined __linux__ && !defined IHR_DISABLE_URING && __has_include(<linux/io_uring.h>)
+#define IHR_HAS_URING 1
+#include <linux/io_uring.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+static const uint32_t default_queue_depth = 64;
+
+//Continuation reads are widened to whole blocks, so a resolver walking forward needs few of them.
+static const uint64_t fetch_block = 4 * IHR_PROBE_SIZE;
+
+//Resolve a single file synchronously, the path taken without io_uring.
+static bool resolve_file(const char *path, Image_Info *info)
+{
+    std::memset(info, 0, sizeof(Image_Info));
+
+    Ihr_Source source;
+
+    if(path == nullptr || ihr_source_open_file(&source, path, false) == false)
+        return false;
+
+    bool success = ihr_resolve_source(&source, info);
+
+    ihr_source_close(&source);
+
+    return success;
+}
+
+#ifdef IHR_HAS_URING
+//The rings shared with the kernel, set up through the raw system calls.
+struct Uring
+{
+    int _fd = -1;
+
+    unsigned *_sq_head = nullptr;
+    unsigned *_sq_tail = nullptr;
+    unsigned _sq_mask = 0;
+    unsigned _sq_entries = 0;
+    unsigned *_sq_array = nullptr;
+    io_uring_sqe *_sqes = nullptr;
+
+    unsigned *_cq_head = nullptr;
+    unsigned *_cq_tail = nullptr;
+    unsigned _cq_mask = 0;
+    io_uring_cqe *_cqes = nullptr;
+
+    void *_sq_map = MAP_FAILED;
+    size_t _sq_map_size = 0;
+    void *_cq_map = MAP_FAILED;
+    size_t _cq_map_size = 0;
+    size_t _sqes_size = 0;
+
+    //Entries queued and not handed to the kernel yet.
+    unsigned _unsubmitted = 0;
+};
+
+static void close_uring(Uring &ring)
+{
+    if(ring._sqes != nullptr)
+        munmap(ring._sqes, ring._sqes_size);
+
+    if(ring._cq_map != MAP_FAILED && ring._cq_map != ring._sq_map)
+        munmap(ring._cq_map, ring._cq_map_size);
+
+    if(ring._sq_map != MAP_FAILED)
+        munmap(ring._sq_map, ring._sq_map_size);
+
+    if(ring._fd >= 0)
+        close(ring._fd);
+
+    ring = Uring();
+}
+
+//Whether the kernel supports every operation the engine submits, which is asked through the probe.
+static bool has_uring_operations(int fd)
+{
+    static const uint8_t operations[] = { IORING_OP_OPENAT, IORING_OP_STATX, IORING_OP_READ, IORING_OP_CLOSE };
+
+    static const unsigned probe_entries = 256;
+
+    //The probe is followed by an entry per operation.
+    std::vector<uint8_t> storage(sizeof(io_uring_probe) + probe_entries * sizeof(io_uring_probe_op));
+    io_uring_probe *probe = reinterpret_cast<io_uring_probe *>(storage.data());
+
+    if(syscall(__NR_io_uring_register, fd, IORING_REGISTER_PROBE, probe, probe_entries) < 0)
+        return false;
+
+    for(uint8_t operation : operations)
+    {
+        if(operation > probe->last_op || (probe->ops[operation].flags & IO_URING_OP_SUPPORTED) == 0)
+            return false;
+    }
+
+    return true;
+}
+
+static bool open_uring(Uring &ring, unsigned entries)
+{
+    io_uring_params params;
+    std::memset(&params, 0, sizeof(params));
+
+    ring._fd = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+
+    if(ring._fd < 0)
+        return false;
+
+    //Kernels from 5.1 to 5.5 set a ring up, and then fail every open and read of the engine.
+    if(has_uring_operations(ring._fd) == false)
+    {
+        close_uring(ring);
+
+        return false;
+    }
+
+    ring._sq_map_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    ring._cq_map_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+
+    //Both rings live in one mapping on kernels with IORING_FEAT_SINGLE_MMAP.
+    if(params.features & IORING_FEAT_SINGLE_MMAP)
+        ring._sq_map_size = ring._cq_map_size = std::max(ring._sq_map_size, ring._cq_map_size);
+
+    ring._sq_map = mmap(nullptr, ring._sq_map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring._fd, IORING_OFF_SQ_RING);
+
+    if(ring._sq_map == MAP_FAILED)
+    {
+        close_uring(ring);
+
+        return false;
+    }
+
+    if(params.features & IORING_FEAT_SINGLE_MMAP)
+        ring._cq_map = ring._sq_map;
+    else
+        ring._cq_map = mmap(nullptr, ring._cq_map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring._fd, IORING_OFF_CQ_RING);
+
+    ring._sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+
+    void *sqes = mmap(nullptr, ring._sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring._fd, IORING_OFF_SQES);
+
+    if(ring._cq_map == MAP_FAILED || sqes == MAP_FAILED)
+    {
+        close_uring(ring);
+
+        return false;
+    }
+
+    uint8_t *sq = static_cast<uint8_t *>(ring._sq_map);
+    uint8_t *cq = static_cast<uint8_t *>(ring._cq_map);
+
+    ring._sq_head = reinterpret_cast<unsigned *>(sq + params.sq_off.head);
+    ring._sq_tail = reinterpret_cast<unsigned *>(sq + params.sq_off.tail);
+    ring._sq_mask = *reinterpret_cast<unsigned *>(sq + params.sq_off.ring_mask);
+    ring._sq_entries = params.sq_entries;
+    ring._sq_array = reinterpret_cast<unsigned *>(sq + params.sq_off.array);
+    ring._sqes = static_cast<io_uring_sqe *>(sqes);
+
+    ring._cq_head = reinterpret_cast<unsigned *>(cq + params.cq_off.head);
+    ring._cq_tail = reinterpret_cast<unsigned *>(cq + params.cq_off.tail);
+    ring._cq_mask = *reinterpret_cast<unsigned *>(cq + params.cq_off.ring_mask);
+    ring._cqes = reinterpret_cast<io_uring_cqe *>(cq + params.cq_off.cqes);
+
+    return true;
+}
+
+static int enter_uring(Uring &ring, unsigned min_complete)
+{
+    unsigned flags = min_complete != 0 ? IORING_ENTER_GETEVENTS : 0;
+
+    for(;;)
+    {
+        int submitted = static_cast<int>(syscall(__NR_io_uring_enter, ring._fd, ring._unsubmitted, min_complete, flags, nullptr, 0));
+
+        if(submitted >= 0)
+        {
+            ring._unsubmitted -= std::min(ring._unsubmitted, static_cast<unsigned>(submitted));
+
+            return submitted;
+        }
+
+        if(errno != EINTR)
+            return -1;
+    }
+}
+
+//Get an entry to fill, handing the queued ones to the kernel first if the ring is full.
+static io_uring_sqe *get_sqe(Uring &ring)
+{
+    if(ring._fd < 0)
+        return nullptr;
+
+    unsigned tail = *ring._sq_tail;
+
+    while(tail - __atomic_load_n(ring._sq_head, __ATOMIC_ACQUIRE) >= ring._sq_entries)
+    {
+        if(enter_uring(ring, 0) < 0)
+            return nullptr;
+    }
+
+    unsigned index = tail & ring._sq_mask;
+
+    io_uring_sqe *sqe = ring._sqes + index;
+    std::memset(sqe, 0, sizeof(io_uring_sqe));
+
+    ring._sq_array[index] = index;
+
+    __atomic_store_n(ring._sq_tail, tail + 1, __ATOMIC_RELEASE);
+
+    ++ring._unsubmitted;
+
+    return sqe;
+}
+
+//The operation a completion belongs to is kept in the low bits of its user data.
+enum Uring_Operation : uint64_t
+{
+    IHR_OP_OPEN,
+    IHR_OP_STATX,
+    IHR_OP_READ,
+    IHR_OP_CLOSE
+};
+
+static const unsigned operation_bits = 2;
+
+struct Cached_Range
+{
+    uint64_t _offset;
+    std::vector<uint8_t> _bytes;
+};
+
+//A file in flight.
+struct Uring_Slot
+{
+    std::size_t _index = 0;                         //index of the file in the batch
+    int _fd = -1;
+    unsigned _pending = 0;                          //operations submitted and not completed
+    bool _failed = false;
+    bool _statx_done = false;
+    struct statx _statx;
+    uint64_t _size = 0;
+    uint64_t _end_seen = UINT64_MAX;                //where a short read found the file to end
+
+    //Bytes read so far, sorted and never overlapping or adjacent.
+    std::vector<Cached_Range> _cache;
+
+    //Buffer of the read in flight.
+    uint64_t _read_offset = 0;
+    std::vector<uint8_t> _read_buffer;
+
+    //The first range a resolve missed, its length is 0 if none.
+    uint64_t _missing_offset = 0;
+    uint64_t _missing_length = 0;
+
+    //Operations the ring had no entry for, submitted again after the next enter.
+    bool _deferred = false;
+    bool _statx_deferred = false;
+    bool _read_deferred = false;
+
+    //The pages of a tif resolved so far, a continuation goes on from the directory it stopped at.
+    const Tiff_Parser *_tiff_parser = nullptr;
+    uint64_t _next_ifd_pos = 0;
+    Image_Info _pages;
+    Image_Info *_last_page = nullptr;
+    Ifd_Cycle_Check _cycle_check;
+};
+
+//The first cached range ending at or after offset, the one offset may be in.
+static std::vector<Cached_Range>::iterator find_range(Uring_Slot &slot, uint64_t offset)
+{
+    auto range = std::upper_bound(slot._cache.begin(), slot._cache.end(), offset,
+        [](uint64_t value, const Cached_Range &cached) { return value < cached._offset; });
+
+    if(range != slot._cache.begin() && std::prev(range)->_offset + std::prev(range)->_bytes.size() >= offset)
+        --range;
+
+    return range;
+}
+
+static void insert_range(Uring_Slot &slot, uint64_t offset, std::vector<uint8_t> &&bytes)
+{
+    uint64_t end = offset + bytes.size();
+
+    //The ranges the inserted one overlaps or is adjacent to.
+    auto first = find_range(slot, offset);
+    auto last = first;
+
+    while(last != slot._cache.end() && last->_offset <= end)
+        ++last;
+
+    if(first == last)
+    {
+        slot._cache.insert(first, Cached_Range{offset, std::move(bytes)});
+
+        return;
+    }
+
+    //Grow them all into the first, in place when it starts first, as it does when a walk goes forward.
+    uint64_t begin = std::min(first->_offset, offset);
+    uint64_t last_end = std::max(end, std::prev(last)->_offset + std::prev(last)->_bytes.size());
+
+    if(begin < first->_offset)
+    {
+        std::vector<uint8_t> combined(static_cast<std::size_t>(last_end - begin));
+
+        std::memcpy(combined.data() + (first->_offset - begin), first->_bytes.data(), first->_bytes.size());
+
+        first->_bytes = std::move(combined);
+        first->_offset = begin;
+    }
+    else
+        first->_bytes.resize(static_cast<std::size_t>(last_end - begin));
+
+    for(auto range = std::next(first); range != last; ++range)
+        std::memcpy(first->_bytes.data() + (range->_offset - begin), range->_bytes.data(), range->_bytes.size());
+
+    std::memcpy(first->_bytes.data() + (offset - begin), bytes.data(), bytes.size());
+
+    slot._cache.erase(std::next(first), last);
+}
+
+//The reader the resolvers run on, serving the bytes read so far and noting the first one missing.
+static bool cache_read_at(void *ctx, uint64_t offset, size_t length, void *buffer)
+{
+    Uring_Slot &slot = *static_cast<Uring_Slot *>(ctx);
+
+    auto range = find_range(slot, offset);
+
+    if(range != slot._cache.end() && offset >= range->_offset && offset + length <= range->_offset + range->_bytes.size())
+    {
+        std::memcpy(buffer, range->_bytes.data() + (offset - range->_offset), length);
+
+        return true;
+    }
+
+    if(slot._missing_length == 0)
+    {
+        slot._missing_offset = offset;
+        slot._missing_length = length;
+    }
+
+    return false;
+}
+
+static uint64_t cache_size(void *ctx)
+{
+    return static_cast<Uring_Slot *>(ctx)->_size;
+}
+
+static const Ihr_Reader _cache_reader = { &cache_read_at, &cache_size };
+#endif
+
+struct Ihr_Engine
+{
+    Ihr_Engine_Options _options;
+
+#ifdef IHR_HAS_URING
+    Uring _ring;
+
+    std::vector<Uring_Slot> _slots;
+
+    std::vector<std::size_t> _free_slots;
+
+    //Slots with an operation waiting for an entry of the ring.
+    std::vector<std::size_t> _deferred_slots;
+
+    //Operations queued or submitted and not completed.
+    std::size_t _in_flight = 0;
+#endif
+
+    bool _async = false;
+};
+
+#ifdef IHR_HAS_URING
+static inline uint64_t user_data(std::size_t slot, Uring_Operation operation)
+{
+    return (static_cast<uint64_t>(slot) << operation_bits) | operation;
+}
+
+static bool submit_open(Ihr_Engine &engine, std::size_t slot_index, const char *path)
+{
+    io_uring_sqe *sqe = get_sqe(engine._ring);
+
+    if(sqe == nullptr)
+        return false;
+
+    sqe->opcode = IORING_OP_OPENAT;
+    sqe->fd = AT_FDCWD;
+    sqe->addr = reinterpret_cast<uint64_t>(path);
+    sqe->open_flags = O_RDONLY | O_CLOEXEC;
+    sqe->user_data = user_data(slot_index, IHR_OP_OPEN);
+
+    ++engine._slots[slot_index]._pending;
+    ++engine._in_flight;
+
+    return true;
+}
+
+static bool submit_statx(Ihr_Engine &engine, std::size_t slot_index)
+{
+    static const char empty_path[] = "";
+
+    Uring_Slot &slot = engine._slots[slot_index];
+
+    io_uring_sqe *sqe = get_sqe(engine._ring);
+
+    if(sqe == nullptr)
+        return false;
+
+    sqe->opcode = IORING_OP_STATX;
+    sqe->fd = slot._fd;
+    sqe->addr = reinterpret_cast<uint64_t>(empty_path);
+    sqe->len = STATX_SIZE;
+    sqe->statx_flags = AT_EMPTY_PATH;
+    sqe->off = reinterpret_cast<uint64_t>(&slot._statx);
+    sqe->user_data = user_data(slot_index, IHR_OP_STATX);
+
+    ++slot._pending;
+    ++engine._in_flight;
+
+    return true;
+}
+
+static bool submit_read(Ihr_Engine &engine, std::size_t slot_index, uint64_t offset, std::size_t length)
+{
+    Uring_Slot &slot = engine._slots[slot_index];
+
+    //Kept even without an entry, for the read to be submitted again as it is.
+    slot._read_offset = offset;
+    slot._read_buffer.resize(length);
+
+    io_uring_sqe *sqe = get_sqe(engine._ring);
+
+    if(sqe == nullptr)
+        return false;
+
+    sqe->opcode = IORING_OP_READ;
+    sqe->fd = slot._fd;
+    sqe->addr = reinterpret_cast<uint64_t>(slot._read_buffer.data());
+    sqe->len = static_cast<uint32_t>(length);
+    sqe->off = offset;
+    sqe->user_data = user_data(slot_index, IHR_OP_READ);
+
+    ++slot._pending;
+    ++engine._in_flight;
+
+    return true;
+}
+
+//Start over with a slot, the pages of a tif it was resolving are released.
+static void reset_slot(Uring_Slot &slot)
+{
+    if(slot._tiff_parser != nullptr)
+        release_image_info(&slot._pages);
+
+    slot._tiff_parser = nullptr;
+    slot._last_page = nullptr;
+    std::memset(&slot._pages, 0, sizeof(Image_Info));
+
+    slot._deferred = slot._statx_deferred = slot._read_deferred = false;
+
+    slot._end_seen = UINT64_MAX;
+}
+
+//Close the file of a slot without waiting for it, and give the slot back.
+static void finish_slot(Ihr_Engine &engine, std::size_t slot_index)
+{
+    Uring_Slot &slot = engine._slots[slot_index];
+
+    if(slot._fd >= 0)
+    {
+        io_uring_sqe *sqe = get_sqe(engine._ring);
+
+        if(sqe != nullptr)
+        {
+            sqe->opcode = IORING_OP_CLOSE;
+            sqe->fd = slot._fd;
+            sqe->user_data = user_data(slot_index, IHR_OP_CLOSE);
+
+            ++engine._in_flight;
+        }
+        else
+            close(slot._fd);
+    }
+
+    if(slot._deferred)
+        engine._deferred_slots.erase(std::find(engine._deferred_slots.begin(), engine._deferred_slots.end(), slot_index));
+
+    reset_slot(slot);
+
+    slot._fd = -1;
+    slot._cache.clear();
+    slot._read_buffer.clear();
+
+    engine._free_slots.push_back(slot_index);
+}
+
+//Keep the operations of a slot the ring has no entry for, to submit them after the next enter.
+static void defer_slot(Ihr_Engine &engine, std::size_t slot_index, bool statx, bool read)
+{
+    Uring_Slot &slot = engine._slots[slot_index];
+
+    slot._statx_deferred = slot._statx_deferred || statx;
+    slot._read_deferred = slot._read_deferred || read;
+
+    if(slot._deferred == false)
+    {
+        slot._deferred = true;
+
+        engine._deferred_slots.push_back(slot_index);
+    }
+}
+
+//Read the range the last resolve missed, widened to whole blocks.
+static bool submit_missing_read(Ihr_Engine &engine, std::size_t slot_index)
+{
+    Uring_Slot &slot = engine._slots[slot_index];
+
+    uint64_t begin = slot._missing_offset / fetch_block * fetch_block;
+    uint64_t end = std::min(slot._size, (slot._missing_offset + slot._missing_length + fetch_block - 1) / fetch_block * fetch_block);
+
+    return submit_read(engine, slot_index, begin, static_cast<std::size_t>(end - begin));
+}
+
+//Submit what was deferred, the slots still without an entry stay deferred.
+static void submit_deferred(Ihr_Engine &engine)
+{
+    std::vector<std::size_t> deferred_slots;
+    deferred_slots.swap(engine._deferred_slots);
+
+    for(std::size_t slot_index : deferred_slots)
+    {
+        Uring_Slot &slot = engine._slots[slot_index];
+
+        slot._deferred = false;
+
+        bool statx = slot._statx_deferred && submit_statx(engine, slot_index) == false;
+        bool read = slot._read_deferred && submit_read(engine, slot_index, slot._read_offset, slot._read_buffer.size()) == false;
+
+        slot._statx_deferred = slot._read_deferred = false;
+
+        if(statx || read)
+            defer_slot(engine, slot_index, statx, read);
+    }
+}
+
+/**
+* Resolve the directories of a tif from the one the last run stopped at, as far as the bytes read
+* so far go. The pages resolved stay in the slot, none of them is resolved twice.
+* @return true if the whole list is resolved, false if it is broken or bytes are missing
+*/
+static bool continue_tiff_pages(Uring_Slot &slot, Ihr_Source *source)
+{
+    Tiff_Buffers buffers;
+    ihr_acquire_tiff_buffers(source, &buffers);
+
+    bool success = true;
+
+    do
+    {
+        Image_Info page;
+        uint64_t next_ifd_pos = 0;
+
+        if(slot._tiff_parser->_resolve_ifd(source, slot._next_ifd_pos, &page, &next_ifd_pos, &buffers) == false ||
+           ihr_append_tif_page(&slot._pages, &slot._last_page, &page, nullptr) == false)
+        {
+            success = false;
+
+            break;
+        }
+
+        slot._next_ifd_pos = next_ifd_pos;
+
+        //A list looping back would never end, the file is rejected.
+        if(next_ifd_pos != 0 && next_ifd_pos < source->_size && ifd_list_loops(&slot._cycle_check, next_ifd_pos))
+        {
+            success = false;
+
+            break;
+        }
+    } while(slot._next_ifd_pos != 0 && slot._next_ifd_pos < source->_size);
+
+    ihr_release_tiff_buffers(source, &buffers);
+
+    return success;
+}
+
+/**
+* Run the resolver over the bytes read so far. If it needs more, the missing range(widened to whole
+* blocks) is read and the resolver is run again once it arrives. A tif goes on from the directory it
+* stopped at, other formats are resolved again from the start, the bytes they need being few.
+* @return true if the file is done, resolved or not
+*/
+static bool continue_slot(Ihr_Engine &engine, std::size_t slot_index, Image_Info *info, bool &success)
+{
+    Uring_Slot &slot = engine._slots[slot_index];
+
+    slot._missing_length = 0;
+
+    Ihr_Source source;
+
+    std::memset(info, 0, sizeof(Image_Info));
+
+    if(ihr_source_from_reader(&source, &_cache_reader, &slot) == false)
+    {
+        success = false;
+
+        return true;
+    }
+
+    uint64_t first_ifd_pos = 0;
+
+    if(slot._tiff_parser == nullptr && slot._size != 0 && ihr_source_probe(&source) &&
+       ihr_tiff_resolve_header(&source, &slot._tiff_parser, &first_ifd_pos))
+    {
+        slot._next_ifd_pos = first_ifd_pos;
+
+        start_ifd_cycle_check(&slot._cycle_check, first_ifd_pos);
+    }
+
+    if(slot._tiff_parser != nullptr)
+    {
+        success = continue_tiff_pages(slot, &source);
+
+        //The pages are handed over, or released if the list turns out to be broken.
+        if(slot._missing_length == 0)
+        {
+            *info = slot._pages;
+
+            if(success)
+                success = ihr_finish_tif_pages(info, slot._size);
+            else
+            {
+                release_image_info(info);
+
+                std::memset(info, 0, sizeof(Image_Info));
+            }
+
+            slot._tiff_parser = nullptr;
+            slot._last_page = nullptr;
+            std::memset(&slot._pages, 0, sizeof(Image_Info));
+        }
+    }
+    else
+    {
+        success = ihr_resolve_source(&source, info);
+
+        //Whatever was resolved without the missing bytes is not to be trusted.
+        if(slot._missing_length != 0 && success)
+            release_image_info(info);
+    }
+
+    ihr_source_close(&source);
+
+    if(slot._missing_length == 0)
+        return true;
+
+    success = false;
+
+    if(submit_missing_read(engine, slot_index) == false)
+        defer_slot(engine, slot_index, false, true);
+
+    return false;
+}
+
+/**
+* Wait for the operations submitted to complete before the ring is closed, they would still write
+* into the buffers of the slots. Files opened meanwhile are closed, the synchronous path opens them
+* again. If even waiting fails, the buffers stay allocated until the engine is destroyed.
+*/
+static void drain_uring(Ihr_Engine &engine)
+{
+    Uring &ring = engine._ring;
+
+    //The entries never handed to the kernel do not complete.
+    std::size_t submitted = engine._in_flight - std::min<std::size_t>(engine._in_flight, ring._unsubmitted);
+
+    while(submitted != 0)
+    {
+        unsigned head = *ring._cq_head;
+        unsigned tail = __atomic_load_n(ring._cq_tail, __ATOMIC_ACQUIRE);
+
+        for(; head != tail && submitted != 0; ++head, --submitted)
+        {
+            const io_uring_cqe &cqe = ring._cqes[head & ring._cq_mask];
+
+            if((cqe.user_data & ((1u << operation_bits) - 1)) == IHR_OP_OPEN && cqe.res >= 0)
+                close(cqe.res);
+        }
+
+        __atomic_store_n(ring._cq_head, head, __ATOMIC_RELEASE);
+
+        if(submitted == 0)
+            break;
+
+        int waited = -1;
+
+        do
+            waited = static_cast<int>(syscall(__NR_io_uring_enter, ring._fd, 0, 1, IORING_ENTER_GETEVENTS, nullptr, 0));
+        while(waited < 0 && errno == EINTR);
+
+        if(waited < 0)
+            break;
+    }
+
+    engine._in_flight = 0;
+}
+
+static std::size_t resolve_uring(
+    Ihr_Engine &engine,
+    const char *const *paths,
+    std::size_t n,
+    Image_Info *out,
+    bool *ok)
+{
+    Uring &ring = engine._ring;
+
+    std::size_t next = 0, done = 0, succeeded = 0;
+
+    auto complete_file = [&](std::size_t slot_index, bool success)
+    {
+        Uring_Slot &slot = engine._slots[slot_index];
+
+        if(success == false)
+            std::memset(out + slot._index, 0, sizeof(Image_Info));
+        else
+            ++succeeded;
+
+        if(ok != nullptr)
+            ok[slot._index] = success;
+
+        ++done;
+
+        finish_slot(engine, slot_index);
+    };
+
+    while(done < n)
+    {
+        //Keep the pipeline full, until the ring has no entry left for an open.
+        bool open_deferred = false;
+
+        while(next < n && engine._free_slots.empty() == false && open_deferred == false)
+        {
+            std::size_t slot_index = engine._free_slots.back();
+            engine._free_slots.pop_back();
+
+            Uring_Slot &slot = engine._slots[slot_index];
+            reset_slot(slot);
+            slot._index = next++;
+            slot._fd = -1;
+            slot._pending = 0;
+            slot._failed = false;
+            slot._statx_done = false;
+
+            if(paths[slot._index] == nullptr)
+                complete_file(slot_index, false);
+            else if(submit_open(engine, slot_index, paths[slot._index]) == false)
+            {
+                //The file is opened after the next enter.
+                --next;
+
+                engine._free_slots.push_back(slot_index);
+
+                open_deferred = true;
+            }
+        }
+
+        if(done == n)
+            break;
+
+        //Nothing may be in flight while operations are deferred, so the enter does not wait then.
+        if(enter_uring(ring, engine._deferred_slots.empty() && open_deferred == false ? 1 : 0) < 0)
+        {
+            //The ring broke down, what is left goes through the synchronous path.
+            drain_uring(engine);
+
+            close_uring(ring);
+
+            engine._async = false;
+
+            engine._deferred_slots.clear();
+
+            for(std::size_t slot_index = 0; slot_index < engine._slots.size(); ++slot_index)
+            {
+                Uring_Slot &slot = engine._slots[slot_index];
+
+                if(std::find(engine._free_slots.begin(), engine._free_slots.end(), slot_index) != engine._free_slots.end())
+                    continue;
+
+                if(slot._fd >= 0)
+                    close(slot._fd);
+
+                slot._fd = -1;
+
+                complete_file(slot_index, resolve_file(paths[slot._index], out + slot._index));
+            }
+
+            for(; next < n; ++next)
+            {
+                bool success = resolve_file(paths[next], out + next);
+
+                if(ok != nullptr)
+                    ok[next] = success;
+
+                if(success)
+                    ++succeeded;
+            }
+
+            return succeeded;
+        }
+
+        unsigned head = *ring._cq_head;
+        unsigned tail = __atomic_load_n(ring._cq_tail, __ATOMIC_ACQUIRE);
+
+        for(; head != tail; ++head)
+        {
+            const io_uring_cqe &cqe = ring._cqes[head & ring._cq_mask];
+
+            Uring_Operation operation = static_cast<Uring_Operation>(cqe.user_data & ((1u << operation_bits) - 1));
+            std::size_t slot_index = static_cast<std::size_t>(cqe.user_data >> operation_bits);
+            int result = cqe.res;
+
+            --engine._in_flight;
+
+            //Nothing waits for a close, the slot was given back when it was submitted.
+            if(operation == IHR_OP_CLOSE)
+                continue;
+
+            Uring_Slot &slot = engine._slots[slot_index];
+
+            --slot._pending;
+
+            if(operation == IHR_OP_OPEN)
+            {
+                //Ask for the size and the probe at the same time.
+                if(result < 0)
+                    slot._failed = true;
+                else
+                {
+                    slot._fd = result;
+
+                    bool statx = submit_statx(engine, slot_index) == false;
+                    bool read = submit_read(engine, slot_index, 0, IHR_PROBE_SIZE) == false;
+
+                    if(statx || read)
+                        defer_slot(engine, slot_index, statx, read);
+                }
+            }
+            else if(operation == IHR_OP_STATX)
+            {
+                if(result < 0)
+                    slot._failed = true;
+                else
+                {
+                    slot._size = std::min<uint64_t>(slot._statx.stx_size, slot._end_seen);
+                    slot._statx_done = true;
+                }
+            }
+            else if(operation == IHR_OP_READ)
+            {
+                if(result < 0)
+                    slot._failed = true;
+                else
+                {
+                    //A read short of the end told by statx means the file shrank since, it is
+                    //taken as truncated there, so the missing bytes are not asked for again.
+                    if(static_cast<std::size_t>(result) < slot._read_buffer.size())
+                    {
+                        slot._end_seen = std::min<uint64_t>(slot._end_seen, slot._read_offset + static_cast<uint64_t>(result));
+
+                        if(slot._statx_done)
+                            slot._size = std::min(slot._size, slot._end_seen);
+                    }
+
+                    slot._read_buffer.resize(static_cast<std::size_t>(result));
+
+                    insert_range(slot, slot._read_offset, std::move(slot._read_buffer));
+
+                    slot._read_buffer = std::vector<uint8_t>();
+                }
+            }
+
+            if(slot._pending != 0)
+                continue;
+
+            if(slot._failed)
+            {
+                complete_file(slot_index, false);
+
+                continue;
+            }
+
+            if(slot._statx_done == false || slot._deferred)
+                continue;
+
+            bool success = false;
+
+            if(continue_slot(engine, slot_index, out + slot._index, success))
+                complete_file(slot_index, success);
+        }
+
+        __atomic_store_n(ring._cq_head, head, __ATOMIC_RELEASE);
+
+        submit_deferred(engine);
+    }
+
+    //Hand the last closes to the kernel.
+    if(ring._unsubmitted != 0)
+        enter_uring(ring, 0);
+
+    return succeeded;
+}
+#endif
+
+Ihr_Engine *ihr_engine_create(const Ihr_Engine_Options *opts)
+{
+    Ihr_Engine *engine = nullptr;
+
+    try
+    {
+        engine = new Ihr_Engine;
+    }
+    catch(...)
+    {
+        return nullptr;
+    }
+
+    engine->_options = opts != nullptr ? *opts : Ihr_Engine_Options{};
+
+    if(engine->_options._queue_depth == 0)
+        engine->_options._queue_depth = default_queue_depth;
+
+#ifdef IHR_HAS_URING
+    //A file has at most two operations in flight, closes come on top.
+    if(engine->_options._force_sync == false && open_uring(engine->_ring, 4 * engine->_options._queue_depth))
+    {
+        engine->_async = true;
+
+        engine->_slots.resize(engine->_options._queue_depth);
+
+        for(std::size_t i = engine->_slots.size(); i > 0; --i)
+            engine->_free_slots.push_back(i - 1);
+    }
+#endif
+
+    return engine;
+}
+
+void ihr_engine_destroy(Ihr_Engine *engine)
+{
+    if(engine == nullptr)
+        return;
+
+#ifdef IHR_HAS_URING
+    close_uring(engine->_ring);
+#endif
+
+    delete engine;
+}
+
+bool ihr_engine_is_async(const Ihr_Engine *engine)
+{
+    return engine != nullptr && engine->_async;
+}
+
+size_t ihr_engine_resolve(
+    Ihr_Engine *engine,
+    const char *const *paths,
+    size_t n,
+    Image_Info *out,
+    bool *ok)
+{
+    if(engine == nullptr || paths == nullptr || out == nullptr)
+        return 0;
+
+#ifdef IHR_HAS_URING
+    if(engine->_async)
+        return resolve_uring(*engine, paths, n, out, ok);
+#endif
+
+    std::size_t succeeded = 0;
+
+    for(std::size_t i = 0; i < n; ++i)
+    {
+        bool success = resolve_file(paths[i], out + i);
+
+        if(ok != nullptr)
+            ok[i] = success;
+
+        if(success)
+            ++succeeded;
+    }
+
+    return succeeded;
+}
@@ -2,6 +2,7 @@
 #include <iostream>
 #include <string>
 #include <chrono>
+#include <vector>
 
 void printInfo(const Image_Header *info, long long span)
 {
@@ -36,6 +37,35 @@ int main(int argc, char *argv[])
 
 		printInfo(info.get(), span.count());
 	}
+	else if (argc > 2)
+	{
+		//Resolve all the files given at once.
+		std::vector<std::string> paths(argv + 1, argv + argc);
+
+		auto start = std::chrono::high_resolution_clock::now();
+
+		std::vector<std::shared_ptr<Image_Header>> infos = Image_Header::read_images(paths);
+
+		auto end = std::chrono::high_resolution_clock::now();
+
+		auto span = std::chrono::duration_cast<std::chrono::microseconds>(end - start);
+
+		for (std::size_t i = 0; i < paths.size(); ++i)
+		{
+			std::cout << "file \'" << paths[i] << "\' :";
+
+			if (infos[i] == nullptr)
+			{
+				std::cout << " failed to resolve.\n";
+
+				continue;
+			}
+
+			std::cout << '\n';
+
+			printInfo(infos[i].get(), span.count() / static_cast<long long>(paths.size()));
+		}
+	}
 	else if (argc == 1)
 	{
 		std::string console_input;
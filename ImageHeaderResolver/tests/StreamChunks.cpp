@@ -0,0 +1,199 @@
+#include "ImageHeaderResolver.h"
+#include "TiffFixtures.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+/**
+* Test of the stream parser. Every file is fed in chunks of 1 byte, of 4 KB and whole, and each
+* stream must resolve to what get_image_info resolves the file to, pages and file size included.
+* The bytes the skip hint announces are fed all the same, for the parser to drop them.
+*/
+
+struct Test_File
+{
+    const char *_name;
+    std::vector<std::uint8_t> _bytes;
+};
+
+static void append_big_endian(std::vector<std::uint8_t> &bytes, std::uint64_t value, std::size_t size)
+{
+    for(std::size_t i = 0; i < size; ++i)
+        bytes.push_back(static_cast<std::uint8_t>(value >> (8 * (size - 1 - i))));
+}
+
+//A png with its header chunk, the resolver reads nothing past it.
+static std::vector<std::uint8_t> make_png(std::uint32_t width, std::uint32_t height)
+{
+    std::vector<std::uint8_t> bytes = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+
+    append_big_endian(bytes, 13, 4);
+    bytes.insert(bytes.end(), { 'I', 'H', 'D', 'R' });
+    append_big_endian(bytes, width, 4);
+    append_big_endian(bytes, height, 4);
+    bytes.insert(bytes.end(), { 8, 2, 0, 0, 0 });
+    append_big_endian(bytes, 0, 4);
+
+    bytes.resize(bytes.size() + 256);
+
+    return bytes;
+}
+
+//A jpeg with large application segments before its frame, which the skip hint announces.
+static std::vector<std::uint8_t> make_jpeg(std::uint16_t width, std::uint16_t height, int app_segments)
+{
+    std::vector<std::uint8_t> bytes = { 0xff, 0xd8 };
+
+    for(int i = 0; i < app_segments; ++i)
+    {
+        bytes.insert(bytes.end(), { 0xff, 0xe1 });
+        append_big_endian(bytes, 60002, 2);
+        bytes.resize(bytes.size() + 60000, static_cast<std::uint8_t>(i));
+    }
+
+    bytes.insert(bytes.end(), { 0xff, 0xc0 });
+    append_big_endian(bytes, 8 + 3 * 3, 2);
+    bytes.push_back(8);
+    append_big_endian(bytes, height, 2);
+    append_big_endian(bytes, width, 2);
+    bytes.push_back(3);
+
+    for(std::uint8_t component = 1; component <= 3; ++component)
+        bytes.insert(bytes.end(), { component, 0x11, 0 });
+
+    bytes.insert(bytes.end(), { 0xff, 0xda });
+    append_big_endian(bytes, 12, 2);
+    bytes.resize(bytes.size() + 10 + 200);
+    bytes.insert(bytes.end(), { 0xff, 0xd9 });
+
+    return bytes;
+}
+
+static std::vector<Test_File> test_files()
+{
+    std::vector<Test_File> files;
+
+    files.push_back({ "png", make_png(640, 480) });
+    files.push_back({ "jpeg with 4 app segments", make_jpeg(1920, 1080, 4) });
+
+    files.push_back({ "classic II tif", make_tiff(Tiff_Fixture{ false, false, { { 800, 600, 8, 3 } } }) });
+    files.push_back({ "classic MM tif, 3 pages", make_tiff(Tiff_Fixture{ false, true, { { 800, 600, 8, 3 }, { 400, 300, 8, 1 }, { 200, 150, 16, 4 } } }) });
+    files.push_back({ "BigTIFF II, 10 out-of-line values", make_tiff(Tiff_Fixture{ true, false, { { 64, 32, 8, 5, 10 }, { 7, 9, 8, 5, 10 } } }) });
+
+    //Past the 16 MB the stream holds, its directories 8 MB apart.
+    files.push_back({ "BigTIFF MM, 25 MB", make_tiff(Tiff_Fixture{ true, true, { { 5000, 4000, 8, 3 }, { 2500, 2000, 8, 3 }, { 1250, 1000, 8, 1 } }, 8u << 20 }) });
+
+    return files;
+}
+
+//The pages of an Image_Info, one line each.
+static std::string describe(const Image_Info &info)
+{
+    std::string description;
+
+    for(const Image_Info *page = &info; page != nullptr; page = page->_next)
+    {
+        char line[160];
+
+        std::snprintf(line, sizeof(line), "%s %llu %ux%u d%u c%u p%u\n", page->_format, static_cast<unsigned long long>(page->_file_size),
+            page->_width, page->_height, page->_color_depth, page->_channels, page->_page_number);
+
+        description += line;
+    }
+
+    return description;
+}
+
+//What the stream resolves the bytes to when fed in chunks of the given size, "failed" if it fails to.
+static std::string stream_in_chunks(const std::vector<std::uint8_t> &bytes, std::size_t chunk_size)
+{
+    Ihr_Stream *stream = ihr_stream_create(bytes.size());
+
+    if(stream == nullptr)
+        return "not created";
+
+    Ihr_Stream_Status status = IHR_STREAM_NEED_MORE;
+
+    for(std::size_t position = 0; position < bytes.size() && status == IHR_STREAM_NEED_MORE; position += chunk_size)
+        status = ihr_stream_feed(stream, bytes.data() + position, std::min(chunk_size, bytes.size() - position));
+
+    //An empty chunk ends the stream.
+    if(status == IHR_STREAM_NEED_MORE)
+        status = ihr_stream_feed(stream, nullptr, 0);
+
+    std::string description = "failed";
+
+    Image_Info info;
+
+    if(status == IHR_STREAM_DONE && ihr_stream_result(stream, &info))
+    {
+        description = describe(info);
+
+        release_image_info(&info);
+    }
+
+    ihr_stream_destroy(stream);
+
+    return description;
+}
+
+int main()
+{
+    std::filesystem::path directory = std::filesystem::temp_directory_path();
+
+    int failures = 0;
+
+    std::size_t index = 0;
+
+    for(const Test_File &file : test_files())
+    {
+        std::string path = (directory / ("ihr-stream-chunks-" + std::to_string(index++))).string();
+
+        std::string expected = "failed";
+
+        {
+            std::ofstream output(path, std::ios::binary | std::ios::trunc);
+
+            output.write(reinterpret_cast<const char *>(file._bytes.data()), static_cast<std::streamsize>(file._bytes.size()));
+        }
+
+        Image_Info info;
+
+        if(get_image_info(path.c_str(), &info))
+        {
+            expected = describe(info);
+
+            release_image_info(&info);
+        }
+
+        std::remove(path.c_str());
+
+        if(expected == "failed")
+        {
+            std::printf("FAIL %s: get_image_info failed\n", file._name);
+
+            ++failures;
+
+            continue;
+        }
+
+        for(std::size_t chunk_size : { std::size_t(1), std::size_t(4096), file._bytes.size() })
+        {
+            std::string streamed = stream_in_chunks(file._bytes, chunk_size);
+
+            if(streamed == expected)
+                std::printf("ok   %s, %zu byte chunks\n", file._name, chunk_size);
+            else
+            {
+                std::printf("FAIL %s, %zu byte chunks:\n%sexpected:\n%s", file._name, chunk_size, streamed.c_str(), expected.c_str());
+
+                ++failures;
+            }
+        }
+    }
+
+    return failures == 0 ? 0 : 1;
+}
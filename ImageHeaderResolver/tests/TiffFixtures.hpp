@@ -0,0 +1,150 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+//A page of a tif fixture, its directory holds the tags the resolver reads.
+struct Tiff_Fixture_Page
+{
+	std::uint32_t _width;
+	std::uint32_t _height;
+	std::uint16_t _bits;                        //bits of each sample
+	std::uint16_t _samples;
+	std::uint16_t _repeats = 1;                 //number of bits per sample entries, each with a value of its own
+};
+
+struct Tiff_Fixture
+{
+	bool _big = false;                          //BigTIFF rather than classic tif
+	bool _big_endian = false;                   //MM rather than II
+	std::vector<Tiff_Fixture_Page> _pages;
+	std::uint64_t _gap = 0;                     //bytes of padding before each directory
+	bool _loops = false;                        //whether the last directory points back to the first
+};
+
+/**
+* Build a tif in memory. The values too large for their entry go right before the directory, the
+* directories follow each other forward from the header.
+*/
+inline std::vector<std::uint8_t> make_tiff(const Tiff_Fixture &fixture)
+{
+	std::vector<std::uint8_t> bytes;
+
+	auto put = [&](std::size_t position, std::uint64_t value, std::size_t size)
+	{
+		if(bytes.size() < position + size)
+			bytes.resize(position + size);
+
+		for(std::size_t i = 0; i < size; ++i)
+		{
+			std::size_t shift = 8 * (fixture._big_endian ? size - 1 - i : i);
+
+			bytes[position + i] = static_cast<std::uint8_t>(value >> shift);
+		}
+	};
+
+	auto append = [&](std::uint64_t value, std::size_t size) { put(bytes.size(), value, size); };
+
+	//Size of an offset(and of the content of an entry), and of an entry count.
+	std::size_t offset_size = fixture._big ? 8 : 4;
+	std::size_t count_size = fixture._big ? 8 : 2;
+
+	const std::uint16_t type_short = 3;
+	const std::uint16_t type_long = 4;
+
+	append(fixture._big_endian ? 0x4d4d : 0x4949, 2);
+
+	if(fixture._big)
+	{
+		append(43, 2);
+		append(8, 2);
+		append(0, 2);
+	}
+	else
+		append(42, 2);
+
+	//Where the offset of the next directory goes, the header first.
+	std::size_t next_position = bytes.size();
+	append(0, offset_size);
+
+	std::uint64_t first_ifd = 0;
+
+	for(const Tiff_Fixture_Page &page : fixture._pages)
+	{
+		bytes.resize(bytes.size() + fixture._gap);
+
+		std::size_t value_size = 2u * page._samples;
+
+		//The bits per sample values, if they do not fit in their entries.
+		std::vector<std::uint64_t> value_offsets;
+
+		if(value_size > offset_size)
+		{
+			for(std::uint16_t r = 0; r < page._repeats; ++r)
+			{
+				value_offsets.push_back(bytes.size());
+
+				for(std::uint16_t s = 0; s < page._samples; ++s)
+					append(page._bits, 2);
+			}
+		}
+
+		if(bytes.size() % 2 != 0)
+			append(0, 1);
+
+		std::uint64_t ifd = bytes.size();
+
+		if(first_ifd == 0)
+			first_ifd = ifd;
+
+		put(next_position, ifd, offset_size);
+
+		auto append_entry = [&](std::uint16_t tag, std::uint16_t type, std::uint64_t count, std::uint64_t value, std::size_t size)
+		{
+			append(tag, 2);
+			append(type, 2);
+			append(count, offset_size);
+
+			std::size_t content = bytes.size();
+
+			put(content, 0, offset_size);
+			put(content, value, size);
+		};
+
+		append(4u + page._repeats, count_size);
+
+		append_entry(254, type_long, 1, 0, 4);
+		append_entry(256, type_long, 1, page._width, 4);
+		append_entry(257, type_long, 1, page._height, 4);
+
+		for(std::uint16_t r = 0; r < page._repeats; ++r)
+		{
+			if(value_offsets.empty())
+			{
+				append(258, 2);
+				append(type_short, 2);
+				append(page._samples, offset_size);
+
+				std::size_t content = bytes.size();
+
+				put(content, 0, offset_size);
+
+				for(std::uint16_t s = 0; s < page._samples; ++s)
+					put(content + 2u * s, page._bits, 2);
+			}
+			else
+				append_entry(258, type_short, page._samples, value_offsets[r], offset_size);
+		}
+
+		append_entry(277, type_short, 1, page._samples, 2);
+
+		next_position = bytes.size();
+		append(0, offset_size);
+	}
+
+	if(fixture._loops)
+		put(next_position, first_ifd, offset_size);
+
+	return bytes;
+}
@@ -0,0 +1,166 @@
+#include "ImageHeaderResolver.h"
+#include "TiffFixtures.hpp"
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+/**
+* Regression test of the tif resolver. Tifs built in memory are written out and resolved through
+* get_image_info, the pages found are checked against what the macro generated parser(before the
+* values were gathered and the parser became a template) found in them. A directory list looping back
+* must fail rather than hang, the test has a timeout for that.
+*/
+
+//What a page is expected to resolve to.
+struct Expected_Page
+{
+    std::uint32_t _width;
+    std::uint32_t _height;
+    std::uint16_t _color_depth;
+    std::uint16_t _channels;
+};
+
+struct Test_Case
+{
+    const char *_name;
+    Tiff_Fixture _fixture;
+    bool _resolves;
+    std::vector<Expected_Page> _pages;
+};
+
+static std::vector<Test_Case> test_cases()
+{
+    std::vector<Test_Case> cases;
+
+    cases.push_back({ "classic II", Tiff_Fixture{ false, false, { { 800, 600, 8, 3 } } }, true,
+        { { 800, 600, 24, 3 } } });
+
+    cases.push_back({ "classic MM, 3 pages", Tiff_Fixture{ false, true, { { 800, 600, 8, 3 }, { 400, 300, 8, 1 }, { 200, 150, 16, 4 } } }, true,
+        { { 800, 600, 24, 3 }, { 400, 300, 8, 1 }, { 200, 150, 64, 4 } } });
+
+    cases.push_back({ "BigTIFF II, 2 pages", Tiff_Fixture{ true, false, { { 1000, 2000, 8, 3 }, { 10, 20, 8, 1 } } }, true,
+        { { 1000, 2000, 24, 3 }, { 10, 20, 8, 1 } } });
+
+    Test_Case long_list = { "BigTIFF MM, 500 pages", Tiff_Fixture{ true, true, {} }, true, {} };
+
+    for(int i = 0; i < 500; ++i)
+    {
+        long_list._fixture._pages.push_back({ 64, 64, 16, 2 });
+        long_list._pages.push_back({ 64, 64, 32, 2 });
+    }
+
+    cases.push_back(long_list);
+
+    //More values out of their entries than the refs kept inline by the parser.
+    cases.push_back({ "classic II, 10 out-of-line values", Tiff_Fixture{ false, false, { { 64, 32, 8, 4, 10 } } }, true,
+        { { 64, 32, 32, 4 } } });
+
+    cases.push_back({ "BigTIFF MM, 10 out-of-line values", Tiff_Fixture{ true, true, { { 64, 32, 8, 5, 10 }, { 7, 9, 8, 5, 10 } } }, true,
+        { { 64, 32, 40, 5 }, { 7, 9, 40, 5 } } });
+
+    cases.push_back({ "classic MM, looping list", Tiff_Fixture{ false, true, { { 80, 60, 8, 3 }, { 40, 30, 8, 3 }, { 20, 15, 8, 3 } }, 0, true }, false, {} });
+
+    cases.push_back({ "BigTIFF II, directory pointing at itself", Tiff_Fixture{ true, false, { { 80, 60, 8, 1 } }, 0, true }, false, {} });
+
+    return cases;
+}
+
+static bool write_file(const std::string &path, const std::vector<std::uint8_t> &bytes)
+{
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+
+    file.write(reinterpret_cast<const char *>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+
+    return file.good();
+}
+
+//The differences between what the case resolves to and what it is expected to, empty if none.
+static std::string check_case(const Test_Case &test, const std::string &path, std::uint64_t file_size)
+{
+    Image_Info info;
+
+    bool success = get_image_info(path.c_str(), &info);
+
+    if(success != test._resolves)
+    {
+        if(success)
+            release_image_info(&info);
+
+        return success ? "resolved, expected to fail" : "failed to resolve";
+    }
+
+    if(success == false)
+        return std::string();
+
+    std::string error;
+
+    std::size_t page_count = 0;
+
+    for(const Image_Info *page = &info; page != nullptr; page = page->_next, ++page_count)
+    {
+        if(page_count >= test._pages.size())
+            continue;
+
+        const Expected_Page &expected = test._pages[page_count];
+
+        if(page->_width != expected._width || page->_height != expected._height ||
+           page->_color_depth != expected._color_depth || page->_channels != expected._channels)
+        {
+            char message[160];
+
+            std::snprintf(message, sizeof(message), "page %zu is %ux%u d%u c%u, expected %ux%u d%u c%u; ", page_count,
+                page->_width, page->_height, page->_color_depth, page->_channels,
+                expected._width, expected._height, expected._color_depth, expected._channels);
+
+            error += message;
+        }
+    }
+
+    if(page_count != test._pages.size() || info._page_number != test._pages.size())
+        error += "found " + std::to_string(page_count) + " pages(" + std::to_string(info._page_number) + " told), expected " +
+            std::to_string(test._pages.size()) + "; ";
+
+    if(std::strcmp(info._format, "tiff") != 0)
+        error += std::string("format ") + info._format + "; ";
+
+    if(info._file_size != file_size)
+        error += "file size " + std::to_string(info._file_size) + "; ";
+
+    release_image_info(&info);
+
+    return error;
+}
+
+int main()
+{
+    std::filesystem::path directory = std::filesystem::temp_directory_path();
+
+    int failures = 0;
+
+    std::size_t index = 0;
+
+    for(const Test_Case &test : test_cases())
+    {
+        std::vector<std::uint8_t> bytes = make_tiff(test._fixture);
+
+        std::string path = (directory / ("ihr-tiff-regression-" + std::to_string(index++) + ".tif")).string();
+
+        std::string error = write_file(path, bytes) ? check_case(test, path, bytes.size()) : "could not write " + path;
+
+        std::remove(path.c_str());
+
+        if(error.empty())
+            std::printf("ok   %s\n", test._name);
+        else
+        {
+            std::printf("FAIL %s: %s\n", test._name, error.c_str());
+
+            ++failures;
+        }
+    }
+
+    return failures == 0 ? 0 : 1;
+}
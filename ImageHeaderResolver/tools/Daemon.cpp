@@ -0,0 +1,544 @@
+#include "ImageHeaderResolver.h"
+#include "ImageClient.h"
+#include "ImageProtocol.h"
+#include "ImageSource.h"
+#include "HeaderCache.hpp"
+#include "ThreadPool.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <condition_variable>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+#ifndef SOCK_CLOEXEC
+#define SOCK_CLOEXEC 0
+#endif
+
+/**
+* ihr-daemon, keeps the resolver resident and answers requests over a Unix domain socket(see
+* ImageProtocol.h for the protocol and ImageClient.h for the client).
+* Every connection has a thread reading its requests. A request is cut into batches resolved on the
+* work-stealing pool, the last batch done sends the response, so the requests of a connection are
+* resolved concurrently and can be pipelined. A connection has a bounded number of requests in
+* flight, its thread stops reading once it reaches it.
+* With a cache budget, files unchanged since they were resolved are answered from the header cache.
+*/
+
+//Paths resolved by a single task of the pool.
+static const std::size_t batch_size = 32;
+
+//Requests of a connection in flight at most.
+static const std::size_t max_requests_in_flight = 64;
+
+static volatile std::sig_atomic_t stop_requested = 0;
+
+static void request_stop(int)
+{
+    stop_requested = 1;
+}
+
+static bool read_all(int fd, void *buffer, std::size_t length)
+{
+    uint8_t *destination = static_cast<uint8_t *>(buffer);
+
+    while(length > 0)
+    {
+        ssize_t read_size = recv(fd, destination, length, 0);
+
+        if(read_size < 0 && errno == EINTR)
+            continue;
+
+        if(read_size <= 0)
+            return false;
+
+        destination += read_size;
+        length -= static_cast<std::size_t>(read_size);
+    }
+
+    return true;
+}
+
+class Connection
+{
+public:
+    explicit Connection(int fd) : _fd(fd) {}
+
+    ~Connection() { close(_fd); }
+
+    Connection(const Connection &) = delete;
+    Connection &operator=(const Connection &) = delete;
+
+    int fd() const { return _fd; }
+
+    //Send a whole frame, frames of concurrent responses never interleave.
+    void send_frame(const std::string &frame)
+    {
+        std::lock_guard<std::mutex> lock(_write_mutex);
+
+        const char *data = frame.data();
+        std::size_t length = frame.size();
+
+        while(length > 0 && _broken == false)
+        {
+            ssize_t written = send(_fd, data, length, MSG_NOSIGNAL);
+
+            if(written < 0 && errno == EINTR)
+                continue;
+
+            if(written <= 0)
+            {
+                //The client is gone, the reader finds out on its next read.
+                _broken = true;
+
+                shutdown(_fd, SHUT_RDWR);
+
+                break;
+            }
+
+            data += written;
+            length -= static_cast<std::size_t>(written);
+        }
+    }
+
+    void begin_request()
+    {
+        std::unique_lock<std::mutex> lock(_requests_mutex);
+
+        _requests_done.wait(lock, [this] { return _requests_in_flight < max_requests_in_flight; });
+
+        ++_requests_in_flight;
+    }
+
+    void end_request()
+    {
+        {
+            std::lock_guard<std::mutex> lock(_requests_mutex);
+
+            --_requests_in_flight;
+        }
+
+        _requests_done.notify_one();
+    }
+
+private:
+    int _fd;
+
+    std::mutex _write_mutex;
+    bool _broken = false;
+
+    std::mutex _requests_mutex;
+    std::condition_variable _requests_done;
+    std::size_t _requests_in_flight = 0;
+};
+
+struct Request
+{
+    std::shared_ptr<Connection> _connection;
+    uint32_t _id = 0;
+    std::vector<std::string> _paths;
+
+    //The records of every batch, joined in order once the last batch is done.
+    std::vector<std::string> _records;
+    std::atomic<std::size_t> _batches_left{0};
+};
+
+static void append_record(std::string &out, const Image_Info *info)
+{
+    Ihr_Wire_Record record = {};
+
+    if(info != nullptr)
+    {
+        record._success = 1;
+        record._file_size = info->_file_size;
+
+        std::memcpy(record._format, info->_format, sizeof(record._format));
+
+        for(const Image_Info *page = info; page != nullptr; page = page->_next)
+            ++record._page_count;
+    }
+
+    out.append(reinterpret_cast<const char *>(&record), sizeof(Ihr_Wire_Record));
+
+    for(const Image_Info *page = info; page != nullptr; page = page->_next)
+    {
+        Ihr_Wire_Page wire_page = { page->_width, page->_height, page->_color_depth, page->_channels };
+
+        out.append(reinterpret_cast<const char *>(&wire_page), sizeof(Ihr_Wire_Page));
+    }
+}
+
+class Daemon
+{
+public:
+    Daemon(unsigned int thread_count, std::size_t cache_budget) : _cache(cache_budget), _pool(thread_count)
+    {
+        for(unsigned int i = 0; i < _pool.thread_count(); ++i)
+            _contexts.emplace_back(ihr_context_create(nullptr), ihr_context_destroy);
+    }
+
+    unsigned int thread_count() const { return _pool.thread_count(); }
+
+    //Read the requests of a connection until it is closed or breaks the protocol.
+    void serve(const std::shared_ptr<Connection> &connection)
+    {
+        std::vector<uint8_t> payload;
+
+        for(;;)
+        {
+            Ihr_Frame_Header header;
+
+            if(read_all(connection->fd(), &header, sizeof(Ihr_Frame_Header)) == false ||
+               header._magic != IHR_FRAME_REQUEST || header._count > IHR_MAX_BATCH ||
+               header._payload_length > IHR_MAX_PAYLOAD)
+                return;
+
+            payload.resize(header._payload_length);
+
+            if(read_all(connection->fd(), payload.data(), payload.size()) == false)
+                return;
+
+            auto request = std::make_shared<Request>();
+            request->_connection = connection;
+            request->_id = header._request_id;
+            request->_paths.reserve(header._count);
+
+            std::size_t position = 0;
+
+            for(uint32_t i = 0; i < header._count; ++i)
+            {
+                uint32_t length;
+
+                if(payload.size() - position < sizeof(uint32_t))
+                    return;
+
+                std::memcpy(&length, payload.data() + position, sizeof(uint32_t));
+                position += sizeof(uint32_t);
+
+                if(payload.size() - position < length)
+                    return;
+
+                request->_paths.emplace_back(reinterpret_cast<const char *>(payload.data() + position), length);
+                position += length;
+            }
+
+            connection->begin_request();
+
+            submit(request);
+        }
+    }
+
+    std::uint64_t requests() const { return _requests.load(); }
+
+    std::uint64_t files() const { return _files.load(); }
+
+    std::uint64_t oversized() const { return _oversized.load(); }
+
+    Header_Cache_Stats cache_stats() const { return _cache.stats(); }
+
+private:
+    void submit(const std::shared_ptr<Request> &request)
+    {
+        std::size_t batch_count = std::max<std::size_t>(1, (request->_paths.size() + batch_size - 1) / batch_size);
+
+        request->_records.resize(batch_count);
+        request->_batches_left = batch_count;
+
+        for(std::size_t batch = 0; batch < batch_count; ++batch)
+        {
+            _pool.submit([this, request, batch]
+            {
+                std::size_t begin = batch * batch_size;
+                std::size_t end = std::min(request->_paths.size(), begin + batch_size);
+
+                for(std::size_t i = begin; i < end; ++i)
+                    resolve(request->_paths[i], request->_records[batch]);
+
+                if(request->_batches_left.fetch_sub(1) == 1)
+                    respond(*request);
+            });
+        }
+    }
+
+    void resolve(const std::string &path, std::string &records)
+    {
+        ++_files;
+
+        Ihr_File_Key key;
+
+        bool cached = _cache.memory_budget() > 0 && ihr_file_key(path.c_str(), &key);
+
+        if(cached)
+        {
+            if(std::shared_ptr<const Image_Pages> pages = _cache.find(path, key))
+            {
+                append_record(records, &pages->first_page());
+
+                return;
+            }
+        }
+
+        Image_Info info;
+        std::memset(&info, 0, sizeof(Image_Info));
+
+        //Pages not kept by the cache are only needed until they are written, they are taken from the
+        //context of the worker, which is reset right after. A file failing is answered as such.
+        Ihr_Context *context = cached ? nullptr : _contexts[static_cast<std::size_t>(_pool.current_worker())].get();
+
+        bool success = false;
+
+        if(context != nullptr)
+            success = get_image_info_ctx(context, path.c_str(), &info);
+        else
+        {
+            Ihr_Source source;
+
+            if(ihr_source_open_file(&source, path.c_str(), false))
+            {
+                success = ihr_resolve_source(&source, &info);
+
+                ihr_source_close(&source);
+            }
+        }
+
+        append_record(records, success ? &info : nullptr);
+
+        if(context != nullptr)
+            ihr_context_reset(context);
+        else if(success)
+            _cache.insert(path, key, std::make_shared<const Image_Pages>(info));
+    }
+
+    void respond(Request &request)
+    {
+        ++_requests;
+
+        std::size_t records_length = 0;
+
+        for(const std::string &records : request._records)
+            records_length += records.size();
+
+        std::string frame(sizeof(Ihr_Frame_Header), '\0');
+        frame.reserve(sizeof(Ihr_Frame_Header) + std::min<std::size_t>(records_length, IHR_MAX_PAYLOAD));
+
+        //A record that would take the payload over the limit is answered as failed, the room of a
+        //failed record being kept for each one after it, so the response always fits in one frame.
+        std::size_t records_left = request._paths.size();
+
+        for(const std::string &records : request._records)
+        {
+            for(std::size_t position = 0; position < records.size(); --records_left)
+            {
+                Ihr_Wire_Record record;
+                std::memcpy(&record, records.data() + position, sizeof(Ihr_Wire_Record));
+
+                std::size_t record_size = sizeof(Ihr_Wire_Record) + record._page_count * sizeof(Ihr_Wire_Page);
+
+                if(frame.size() - sizeof(Ihr_Frame_Header) + record_size + (records_left - 1) * sizeof(Ihr_Wire_Record) <= IHR_MAX_PAYLOAD)
+                    frame.append(records, position, record_size);
+                else
+                {
+                    append_record(frame, nullptr);
+
+                    ++_oversized;
+                }
+
+                position += record_size;
+            }
+        }
+
+        Ihr_Frame_Header header = { IHR_FRAME_RESPONSE, request._id,
+            static_cast<uint32_t>(request._paths.size()), static_cast<uint32_t>(frame.size() - sizeof(Ihr_Frame_Header)) };
+
+        frame.replace(0, sizeof(Ihr_Frame_Header), reinterpret_cast<const char *>(&header), sizeof(Ihr_Frame_Header));
+
+        request._connection->send_frame(frame);
+        request._connection->end_request();
+    }
+
+private:
+    Header_Cache _cache;
+    std::atomic<std::uint64_t> _requests{0};
+    std::atomic<std::uint64_t> _files{0};
+    std::atomic<std::uint64_t> _oversized{0};               //files answered as failed for the frame limit
+
+    //A context per worker of the pool, destroyed once the pool is stopped.
+    std::vector<std::unique_ptr<Ihr_Context, void (*)(Ihr_Context *)>> _contexts;
+    Thread_Pool _pool;
+};
+
+//A connection and the thread reading it, joined once it is done.
+struct Session
+{
+    std::shared_ptr<Connection> _connection;
+    std::atomic<bool> _done{false};
+    std::thread _thread;
+};
+
+static void print_usage()
+{
+    std::cerr <<
+        "usage: ihr-daemon [-s socket] [-j threads] [-c cache]\n"
+        "  -s  socket to listen on, " IHR_DEFAULT_SOCKET " by default\n"
+        "  -j  number of worker threads, one per hardware thread by default\n"
+        "  -c  memory budget of the header cache in MB, 0(no cache) by default\n";
+}
+
+int main(int argc, char *argv[])
+{
+    const char *socket_path = IHR_DEFAULT_SOCKET;
+    unsigned int thread_count = 0;
+    std::size_t cache_budget = 0;
+
+    for(int i = 1; i < argc; ++i)
+    {
+        std::string argument = argv[i];
+
+        if(argument == "-s" && i + 1 < argc)
+            socket_path = argv[++i];
+        else if(argument == "-j" && i + 1 < argc)
+            thread_count = static_cast<unsigned int>(std::strtoul(argv[++i], nullptr, 10));
+        else if(argument == "-c" && i + 1 < argc)
+            cache_budget = static_cast<std::size_t>(std::strtoull(argv[++i], nullptr, 10)) << 20;
+        else
+        {
+            print_usage();
+
+            return 1;
+        }
+    }
+
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+
+    if(std::strlen(socket_path) >= sizeof(address.sun_path))
+    {
+        std::cerr << socket_path << ": path too long for a socket\n";
+
+        return 1;
+    }
+
+    std::strcpy(address.sun_path, socket_path);
+
+    //A socket left by a daemon gone is replaced, anything else is not touched.
+    struct stat socket_stat;
+
+    if(stat(socket_path, &socket_stat) == 0 && S_ISSOCK(socket_stat.st_mode))
+    {
+        if(Ihr_Client *client = ihr_client_connect(socket_path))
+        {
+            ihr_client_close(client);
+
+            std::cerr << socket_path << ": a daemon is already listening\n";
+
+            return 1;
+        }
+
+        unlink(socket_path);
+    }
+
+    int listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+
+    if(listen_fd < 0 || bind(listen_fd, reinterpret_cast<const sockaddr *>(&address), sizeof(address)) != 0 ||
+       listen(listen_fd, SOMAXCONN) != 0)
+    {
+        std::perror(socket_path);
+
+        return 1;
+    }
+
+    struct sigaction action = {};
+    action.sa_handler = request_stop;
+
+    //Without SA_RESTART, so the signal wakes the accepting thread up.
+    sigaction(SIGINT, &action, nullptr);
+    sigaction(SIGTERM, &action, nullptr);
+
+    std::signal(SIGPIPE, SIG_IGN);
+
+    std::list<std::unique_ptr<Session>> sessions;
+
+    {
+        Daemon daemon(thread_count, cache_budget);
+
+        std::cerr << "listening on " << socket_path << " with " << daemon.thread_count() << " threads\n";
+
+        pollfd poll_fd = { listen_fd, POLLIN, 0 };
+
+        while(stop_requested == 0)
+        {
+            if(poll(&poll_fd, 1, -1) <= 0)
+                continue;
+
+            int fd = accept(listen_fd, nullptr, nullptr);
+
+            if(fd < 0)
+                continue;
+
+            fcntl(fd, F_SETFD, FD_CLOEXEC);
+
+            //Sessions of closed connections are joined as new ones come.
+            sessions.remove_if([](const std::unique_ptr<Session> &session)
+            {
+                if(session->_done.load() == false)
+                    return false;
+
+                session->_thread.join();
+
+                return true;
+            });
+
+            std::unique_ptr<Session> session(new Session);
+            session->_connection = std::make_shared<Connection>(fd);
+
+            Session *raw_session = session.get();
+
+            session->_thread = std::thread([&daemon, raw_session]
+            {
+                daemon.serve(raw_session->_connection);
+
+                raw_session->_done = true;
+            });
+
+            sessions.push_back(std::move(session));
+        }
+
+        //Wake the readers up, the responses in flight are still sent before the pool stops.
+        for(const std::unique_ptr<Session> &session : sessions)
+        {
+            shutdown(session->_connection->fd(), SHUT_RD);
+
+            session->_thread.join();
+        }
+
+        Header_Cache_Stats cache_stats = daemon.cache_stats();
+
+        std::cerr << daemon.requests() << " requests, " << daemon.files() << " files(" << daemon.oversized() <<
+            " over the frame limit), cache " <<
+            cache_stats._hits << " hits, " << cache_stats._misses << " misses, " <<
+            cache_stats._evictions << " evictions\n";
+    }
+
+    close(listen_fd);
+
+    unlink(socket_path);
+
+    return 0;
+}
@@ -0,0 +1,226 @@
+#include "ImageClient.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+/**
+* ihr-load, load generator of ihr-daemon.
+* Every connection runs on its own thread and keeps depth requests of batch paths in flight, taken
+* from the paths given in turn, for the duration. The latency of a request is measured from its
+* send to its response, percentiles are taken over every request of every connection.
+*/
+
+using Clock = std::chrono::steady_clock;
+
+struct Load_Options
+{
+    const char *_socket_path = IHR_DEFAULT_SOCKET;
+    unsigned int _connections = 8;
+    unsigned int _depth = 4;
+    unsigned int _batch = 1;
+    double _seconds = 5;
+};
+
+struct Connection_Result
+{
+    bool _connected = false;
+    bool _failed = false;
+    std::uint64_t _files = 0;
+    std::uint64_t _resolved = 0;
+    std::vector<double> _latencies_us;
+};
+
+static void run_connection(const Load_Options &options, const std::vector<std::string> &paths, unsigned int index, Connection_Result &result)
+{
+    Ihr_Client *client = ihr_client_connect(options._socket_path);
+
+    if(client == nullptr)
+        return;
+
+    result._connected = true;
+
+    std::vector<const char *> batch(options._batch);
+    std::vector<Image_Info> infos(options._batch);
+    std::unique_ptr<bool[]> ok(new bool[options._batch]);
+
+    std::unordered_map<uint32_t, Clock::time_point> sent;
+
+    //Connections start at different paths so they do not all hit the same files at once.
+    std::size_t next_path = static_cast<std::size_t>(index) * 7919 % paths.size();
+
+    Clock::time_point end = Clock::now() + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(options._seconds));
+
+    for(;;)
+    {
+        while(sent.size() < options._depth && Clock::now() < end)
+        {
+            for(const char *&path : batch)
+            {
+                path = paths[next_path].c_str();
+
+                next_path = (next_path + 1) % paths.size();
+            }
+
+            uint32_t request_id;
+
+            if(ihr_client_send(client, batch.data(), batch.size(), &request_id) == false)
+            {
+                result._failed = true;
+
+                break;
+            }
+
+            sent[request_id] = Clock::now();
+        }
+
+        if(sent.empty() || result._failed)
+            break;
+
+        uint32_t request_id;
+        std::size_t n;
+
+        if(ihr_client_receive(client, &request_id, infos.data(), ok.get(), infos.size(), &n) == false)
+        {
+            result._failed = true;
+
+            break;
+        }
+
+        auto found = sent.find(request_id);
+
+        if(found != sent.end())
+        {
+            std::chrono::duration<double, std::micro> latency = Clock::now() - found->second;
+
+            result._latencies_us.push_back(latency.count());
+
+            sent.erase(found);
+        }
+
+        result._files += n;
+
+        for(std::size_t i = 0; i < std::min(n, infos.size()); ++i)
+        {
+            if(ok[i])
+            {
+                ++result._resolved;
+
+                release_image_info(&infos[i]);
+            }
+        }
+    }
+
+    ihr_client_close(client);
+}
+
+static double percentile(const std::vector<double> &sorted, double fraction)
+{
+    if(sorted.empty())
+        return 0;
+
+    std::size_t position = static_cast<std::size_t>(fraction * static_cast<double>(sorted.size() - 1) + 0.5);
+
+    return sorted[std::min(position, sorted.size() - 1)];
+}
+
+static void print_usage()
+{
+    std::cerr <<
+        "usage: ihr-load [-s socket] [-c connections] [-d depth] [-b batch] [-t seconds] file...\n"
+        "  -s  socket of the daemon, " IHR_DEFAULT_SOCKET " by default\n"
+        "  -c  number of connections, each on its own thread, 8 by default\n"
+        "  -d  requests in flight per connection, 4 by default\n"
+        "  -b  paths per request, 1 by default\n"
+        "  -t  duration in seconds, 5 by default\n";
+}
+
+int main(int argc, char *argv[])
+{
+    Load_Options options;
+    std::vector<std::string> paths;
+
+    for(int i = 1; i < argc; ++i)
+    {
+        std::string argument = argv[i];
+
+        if(argument == "-s" && i + 1 < argc)
+            options._socket_path = argv[++i];
+        else if(argument == "-c" && i + 1 < argc)
+            options._connections = std::max(1u, static_cast<unsigned int>(std::strtoul(argv[++i], nullptr, 10)));
+        else if(argument == "-d" && i + 1 < argc)
+            options._depth = std::max(1u, static_cast<unsigned int>(std::strtoul(argv[++i], nullptr, 10)));
+        else if(argument == "-b" && i + 1 < argc)
+            options._batch = std::max(1u, static_cast<unsigned int>(std::strtoul(argv[++i], nullptr, 10)));
+        else if(argument == "-t" && i + 1 < argc)
+            options._seconds = std::strtod(argv[++i], nullptr);
+        else if(argument.empty() == false && argument[0] == '-')
+        {
+            print_usage();
+
+            return 1;
+        }
+        else
+            paths.push_back(argument);
+    }
+
+    if(paths.empty())
+    {
+        print_usage();
+
+        return 1;
+    }
+
+    std::vector<Connection_Result> results(options._connections);
+    std::vector<std::thread> threads;
+
+    Clock::time_point start = Clock::now();
+
+    for(unsigned int i = 0; i < options._connections; ++i)
+        threads.emplace_back(run_connection, std::cref(options), std::cref(paths), i, std::ref(results[i]));
+
+    for(std::thread &thread : threads)
+        thread.join();
+
+    std::chrono::duration<double> span = Clock::now() - start;
+
+    std::vector<double> latencies;
+    std::uint64_t files = 0, resolved = 0;
+    unsigned int connected = 0, failed = 0;
+
+    for(const Connection_Result &result : results)
+    {
+        latencies.insert(latencies.end(), result._latencies_us.begin(), result._latencies_us.end());
+
+        files += result._files;
+        resolved += result._resolved;
+        connected += result._connected ? 1 : 0;
+        failed += result._failed ? 1 : 0;
+    }
+
+    if(connected == 0)
+    {
+        std::cerr << options._socket_path << ": can not connect to the daemon\n";
+
+        return 1;
+    }
+
+    std::sort(latencies.begin(), latencies.end());
+
+    std::printf("%u connections(%u failed), depth %u, batch %u: %zu requests, %llu files(%llu resolved) in %.2f s\n",
+        connected, failed, options._depth, options._batch, latencies.size(),
+        static_cast<unsigned long long>(files), static_cast<unsigned long long>(resolved), span.count());
+    std::printf("%.0f requests/s, %.0f files/s\n",
+        static_cast<double>(latencies.size()) / span.count(), static_cast<double>(files) / span.count());
+    std::printf("latency(us): p50 %.1f, p90 %.1f, p99 %.1f, max %.1f\n",
+        percentile(latencies, 0.5), percentile(latencies, 0.9), percentile(latencies, 0.99),
+        latencies.empty() ? 0.0 : latencies.back());
+
+    return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,210 @@
+#include "ImageHeaderResolver.h"
+#include "RecordFormat.hpp"
+#include "ThreadPool.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+/**
+* ihr-pack-scan, resolves the files of pack files(written by ihr-scan -P) from their snapshots
+* instead of the originals, and writes their records as ihr-scan does.
+* The files of a pack are cut into chunks of consecutive files resolved on the pool, so every
+* worker goes through the blocks of its chunk in order and the pack is read sequentially. Records
+* are written in the order of the packs.
+*/
+
+//Files per task, a few blocks worth of snapshots.
+static const std::size_t chunk_size = 4096;
+
+//Chunks resolved before their records are written, which bounds the records held.
+static const std::size_t chunks_per_round = 64;
+
+struct Pack_Scan_Options
+{
+    unsigned int _thread_count = 0;
+    Output_Format _format = Output_Format::jsonl;
+    bool _all_files = false;
+};
+
+struct Pack_Scan_Totals
+{
+    uint64_t _files = 0;
+    uint64_t _images = 0;
+};
+
+static void resolve_chunk(Ihr_Pack *pack, std::size_t begin, std::size_t end, const Pack_Scan_Options &options, std::string &records, uint64_t &images)
+{
+    for(std::size_t i = begin; i < end; ++i)
+    {
+        Image_Info info;
+
+        const char *path = ihr_pack_path(pack, i);
+
+        if(path == nullptr)
+            continue;
+
+        if(get_image_info_pack(pack, i, &info))
+        {
+            ++images;
+
+            append_record(records, path, &info, options._format);
+
+            release_image_info(&info);
+        }
+        else if(options._all_files)
+            append_record(records, path, nullptr, options._format);
+    }
+}
+
+static bool scan_pack(const char *pack_path, Thread_Pool &pool, const Pack_Scan_Options &options, std::FILE *output, Pack_Scan_Totals &totals)
+{
+    Ihr_Pack *pack = ihr_pack_open(pack_path);
+
+    if(pack == nullptr)
+    {
+        std::cerr << pack_path << ": not a pack file(or compressed, and built without zlib)\n";
+
+        return false;
+    }
+
+    std::size_t count = ihr_pack_count(pack);
+
+    std::vector<std::string> records(chunks_per_round);
+    std::vector<uint64_t> images(chunks_per_round);
+
+    for(std::size_t round = 0; round < count; round += chunk_size * chunks_per_round)
+    {
+        std::size_t chunks = std::min(chunks_per_round, (count - round + chunk_size - 1) / chunk_size);
+
+        for(std::size_t chunk = 0; chunk < chunks; ++chunk)
+        {
+            std::size_t begin = round + chunk * chunk_size;
+            std::size_t end = std::min(count, begin + chunk_size);
+
+            records[chunk].clear();
+            images[chunk] = 0;
+
+            pool.submit([pack, begin, end, &options, &records, &images, chunk]
+            {
+                resolve_chunk(pack, begin, end, options, records[chunk], images[chunk]);
+            });
+        }
+
+        pool.wait_idle();
+
+        for(std::size_t chunk = 0; chunk < chunks; ++chunk)
+        {
+            std::fwrite(records[chunk].data(), 1, records[chunk].size(), output);
+
+            totals._images += images[chunk];
+        }
+    }
+
+    totals._files += count;
+
+    ihr_pack_close(pack);
+
+    return true;
+}
+
+static void print_usage()
+{
+    std::cerr <<
+        "usage: ihr-pack-scan [-j threads] [-f jsonl|csv|tsv] [-o output] [-a] pack...\n"
+        "  -j  number of worker threads, one per hardware thread by default\n"
+        "  -f  output format, jsonl by default\n"
+        "  -o  output file, the standard output by default\n"
+        "  -a  list the files that are not images too\n";
+}
+
+int main(int argc, char *argv[])
+{
+    Pack_Scan_Options options;
+    const char *output_path = nullptr;
+    std::vector<std::string> packs;
+
+    for(int i = 1; i < argc; ++i)
+    {
+        std::string argument = argv[i];
+
+        if(argument == "-j" && i + 1 < argc)
+            options._thread_count = static_cast<unsigned int>(std::strtoul(argv[++i], nullptr, 10));
+        else if(argument == "-f" && i + 1 < argc)
+        {
+            std::string format = argv[++i];
+
+            if(format == "jsonl")
+                options._format = Output_Format::jsonl;
+            else if(format == "csv")
+                options._format = Output_Format::csv;
+            else if(format == "tsv")
+                options._format = Output_Format::tsv;
+            else
+            {
+                print_usage();
+
+                return 1;
+            }
+        }
+        else if(argument == "-o" && i + 1 < argc)
+            output_path = argv[++i];
+        else if(argument == "-a")
+            options._all_files = true;
+        else if(argument.empty() == false && argument[0] == '-')
+        {
+            print_usage();
+
+            return 1;
+        }
+        else
+            packs.push_back(argument);
+    }
+
+    if(packs.empty())
+    {
+        print_usage();
+
+        return 1;
+    }
+
+    std::FILE *output = output_path != nullptr ? std::fopen(output_path, "wb") : stdout;
+
+    if(output == nullptr)
+    {
+        std::perror(output_path);
+
+        return 1;
+    }
+
+    static char output_buffer[1 << 20];
+    std::setvbuf(output, output_buffer, _IOFBF, sizeof(output_buffer));
+
+    std::fputs(header_line(options._format), output);
+
+    auto start = std::chrono::steady_clock::now();
+
+    Pack_Scan_Totals totals;
+
+    bool success = true;
+
+    {
+        Thread_Pool pool(options._thread_count);
+
+        for(const std::string &pack : packs)
+            success = scan_pack(pack.c_str(), pool, options, output, totals) && success;
+    }
+
+    std::chrono::duration<double> span = std::chrono::steady_clock::now() - start;
+
+    if(output != stdout)
+        std::fclose(output);
+
+    std::cerr << packs.size() << " packs, " << totals._files << " files, " << totals._images << " images in " <<
+        span.count() << " s, " << static_cast<double>(totals._files) / span.count() << " files/s\n";
+
+    return success ? 0 : 1;
+}
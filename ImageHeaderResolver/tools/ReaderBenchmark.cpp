@@ -0,0 +1,196 @@
+#include "ImageHeaderResolver.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+/**
+* Benchmark of resolving through a high latency reader.
+* Every file is resolved twice: once cold through the latency reader, recording the read plan,
+* and once after prefetching the planned ranges(merged when they are close) with one request
+* each, which is what a caller in front of a range-GET store would do for a batch.
+*/
+
+//Ranges closer than this are fetched with a single request.
+static const uint64_t merge_gap = 4096;
+
+struct Prefetched_Range
+{
+	uint64_t _offset;
+	std::vector<uint8_t> _bytes;
+};
+
+struct Prefetched_Content
+{
+	uint64_t _size;
+	std::vector<Prefetched_Range> _ranges;
+};
+
+static bool prefetched_read_at(void *ctx, uint64_t offset, size_t length, void *buffer)
+{
+	const Prefetched_Content *content = static_cast<const Prefetched_Content *>(ctx);
+
+	for (const Prefetched_Range &range : content->_ranges)
+	{
+		if (offset >= range._offset && offset + length <= range._offset + range._bytes.size())
+		{
+			std::memcpy(buffer, range._bytes.data() + (offset - range._offset), length);
+
+			return true;
+		}
+	}
+
+	return false;
+}
+
+static uint64_t prefetched_size(void *ctx)
+{
+	return static_cast<const Prefetched_Content *>(ctx)->_size;
+}
+
+static std::vector<Ihr_Byte_Range> merge_ranges(std::vector<Ihr_Byte_Range> ranges)
+{
+	std::sort(ranges.begin(), ranges.end(), [](const Ihr_Byte_Range &a, const Ihr_Byte_Range &b) {
+		return a._offset < b._offset;
+	});
+
+	std::vector<Ihr_Byte_Range> merged;
+
+	for (const Ihr_Byte_Range &range : ranges)
+	{
+		if (merged.empty() == false && range._offset <= merged.back()._offset + merged.back()._length + merge_gap)
+			merged.back()._length = std::max(merged.back()._length, range._offset + range._length - merged.back()._offset);
+		else
+			merged.push_back(range);
+	}
+
+	return merged;
+}
+
+int main(int argc, char *argv[])
+{
+	uint32_t latency_us = 10000;
+
+	int first_file = 1;
+
+	if (argc > 2 && std::strcmp(argv[1], "-l") == 0)
+	{
+		latency_us = static_cast<uint32_t>(std::strtoul(argv[2], nullptr, 10));
+
+		first_file = 3;
+	}
+
+	if (first_file >= argc)
+	{
+		std::cout << "usage: ihr-reader-bench [-l latency_us] file...\n";
+
+		return 1;
+	}
+
+	long long cold_total = 0, prefetched_total = 0;
+	uint64_t cold_reads = 0, prefetched_reads = 0;
+
+	for (int i = first_file; i < argc; ++i)
+	{
+		Ihr_Latency_Reader reader;
+
+		if (ihr_latency_reader_open(&reader, argv[i], latency_us) == false)
+			continue;
+
+		std::vector<Ihr_Byte_Range> ranges(64);
+
+		Ihr_Read_Plan plan;
+		plan._ranges = ranges.data();
+		plan._capacity = ranges.size();
+		plan._count = 0;
+
+		Image_Info info;
+
+		auto start = std::chrono::high_resolution_clock::now();
+
+		bool success = get_image_info_plan(&reader._reader, &reader, &info, &plan);
+
+		auto end = std::chrono::high_resolution_clock::now();
+
+		if (success == false)
+		{
+			std::cout << argv[i] << " : failed to resolve.\n";
+
+			ihr_latency_reader_close(&reader);
+
+			continue;
+		}
+
+		release_image_info(&info);
+
+		long long cold_span = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+		uint32_t cold_calls = reader._read_calls;
+
+		//The plan may have been truncated, resolve again with room for all of it.
+		if (plan._count > plan._capacity)
+		{
+			ranges.resize(plan._count);
+			plan._ranges = ranges.data();
+			plan._capacity = ranges.size();
+
+			get_image_info_plan(&reader._reader, &reader, &info, &plan);
+			release_image_info(&info);
+		}
+
+		ranges.resize(plan._count);
+
+		//Prefetch the merged plan, one latency bound request per range.
+		start = std::chrono::high_resolution_clock::now();
+
+		uint32_t calls_before = reader._read_calls;
+
+		Prefetched_Content content;
+		content._size = reader._size;
+
+		for (const Ihr_Byte_Range &range : merge_ranges(ranges))
+		{
+			Prefetched_Range fetched;
+			fetched._offset = range._offset;
+			fetched._bytes.resize(static_cast<size_t>(std::min(range._length, reader._size - range._offset)));
+
+			reader._reader.read_at(&reader, fetched._offset, fetched._bytes.size(), fetched._bytes.data());
+
+			content._ranges.push_back(std::move(fetched));
+		}
+
+		uint32_t prefetch_calls = reader._read_calls - calls_before;
+
+		Ihr_Reader prefetched = { &prefetched_read_at, &prefetched_size };
+
+		success = get_image_info_reader(&prefetched, &content, &info);
+
+		end = std::chrono::high_resolution_clock::now();
+
+		long long prefetched_span = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+
+		if (success == true)
+			release_image_info(&info);
+
+		std::cout <<
+			argv[i] << " : " << info._format << ' ' << info._width << 'x' << info._height << '\n' <<
+			"    cold       : " << cold_calls << " reads, " << cold_span << "us\n" <<
+			"    prefetched : " << prefetch_calls << " reads, " << prefetched_span << "us, " <<
+			plan._count << " planned ranges\n";
+
+		cold_total += cold_span;
+		prefetched_total += prefetched_span;
+		cold_reads += cold_calls;
+		prefetched_reads += prefetch_calls;
+
+		ihr_latency_reader_close(&reader);
+	}
+
+	std::cout <<
+		"total cold       : " << cold_reads << " reads, " << cold_total << "us\n" <<
+		"total prefetched : " << prefetched_reads << " reads, " << prefetched_total << "us\n";
+
+	return 0;
+}
@@ -0,0 +1,118 @@
+#pragma once
+
+#include "ImageHeaderResolver.h"
+#include <cstdio>
+#include <string>
+
+//Records of resolved files as the tools write them out, a line per file.
+
+enum class Output_Format
+{
+	jsonl,
+	csv,
+	tsv
+};
+
+inline void append_escaped(std::string &out, const std::string &text, Output_Format format)
+{
+	if(format == Output_Format::jsonl)
+	{
+		out += '"';
+
+		for(char c : text)
+		{
+			unsigned char u = static_cast<unsigned char>(c);
+
+			if(c == '"' || c == '\\')
+			{
+				out += '\\';
+				out += c;
+			}
+			else if(u < 0x20)
+			{
+				char escaped[8];
+				std::snprintf(escaped, sizeof(escaped), "\\u%04x", u);
+
+				out += escaped;
+			}
+			else
+				out += c;
+		}
+
+		out += '"';
+	}
+	else if(format == Output_Format::csv)
+	{
+		out += '"';
+
+		for(char c : text)
+		{
+			if(c == '"')
+				out += '"';
+
+			out += c;
+		}
+
+		out += '"';
+	}
+	else
+	{
+		for(char c : text)
+		{
+			if(c == '\t')
+				out += "\\t";
+			else if(c == '\n')
+				out += "\\n";
+			else if(c == '\\')
+				out += "\\\\";
+			else
+				out += c;
+		}
+	}
+}
+
+inline void append_record(std::string &out, const std::string &path, const Image_Info *info, Output_Format format)
+{
+	char numbers[160];
+
+	if(format == Output_Format::jsonl)
+	{
+		out += "{\"path\":";
+		append_escaped(out, path, format);
+
+		if(info == nullptr)
+			std::snprintf(numbers, sizeof(numbers), ",\"ok\":false}\n");
+		else
+			std::snprintf(numbers, sizeof(numbers),
+				",\"ok\":true,\"format\":\"%s\",\"size\":%llu,\"width\":%u,\"height\":%u,\"depth\":%u,\"channels\":%u,\"pages\":%u}\n",
+				info->_format, static_cast<unsigned long long>(info->_file_size), info->_width, info->_height,
+				static_cast<unsigned int>(info->_color_depth), static_cast<unsigned int>(info->_channels), info->_page_number);
+	}
+	else
+	{
+		char separator = format == Output_Format::csv ? ',' : '\t';
+
+		append_escaped(out, path, format);
+
+		if(info == nullptr)
+			std::snprintf(numbers, sizeof(numbers), "%c0%c%c%c%c%c%c%c\n",
+				separator, separator, separator, separator, separator, separator, separator, separator);
+		else
+			std::snprintf(numbers, sizeof(numbers), "%c1%c%s%c%llu%c%u%c%u%c%u%c%u%c%u\n",
+				separator, separator, info->_format, separator, static_cast<unsigned long long>(info->_file_size),
+				separator, info->_width, separator, info->_height, separator, static_cast<unsigned int>(info->_color_depth),
+				separator, static_cast<unsigned int>(info->_channels), separator, info->_page_number);
+	}
+
+	out += numbers;
+}
+
+inline const char *header_line(Output_Format format)
+{
+	if(format == Output_Format::csv)
+		return "path,ok,format,size,width,height,depth,channels,pages\n";
+	else if(format == Output_Format::tsv)
+		return "path\tok\tformat\tsize\twidth\theight\tdepth\tchannels\tpages\n";
+
+	return "";
+}
@@ -0,0 +1,250 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <queue>
+#include <string>
+#include <sys/types.h>
+#include <unistd.h>
+#include <vector>
+
+/**
+* Bounded memory merge of record files whose lines are sorted(bytewise), as the tsv records of
+* ihr-shard-scan are: the escaped path comes first and a tab sorts before any character of it, so
+* the lines sort by path.
+* At most fan_in files are open at once, each read through a buffer of its own. With more inputs
+* than that, groups of them are merged into intermediate files first, which are merged in turn.
+*/
+
+//Buffer of every file read or written by a merge.
+static const std::size_t merge_buffer_size = 1 << 20;
+
+class Line_Reader
+{
+public:
+	explicit Line_Reader(const std::string &path) : _file(std::fopen(path.c_str(), "rb")), _buffer(merge_buffer_size)
+	{
+		if(_file != nullptr)
+			std::setvbuf(_file, _buffer.data(), _IOFBF, _buffer.size());
+	}
+
+	~Line_Reader()
+	{
+		std::free(_line);
+
+		if(_file != nullptr)
+			std::fclose(_file);
+	}
+
+	Line_Reader(const Line_Reader &) = delete;
+	Line_Reader &operator=(const Line_Reader &) = delete;
+
+	bool valid() const { return _file != nullptr; }
+
+	//Read the next line(its newline included), false at the end of the file.
+	bool next()
+	{
+		_length = getline(&_line, &_capacity, _file);
+
+		return _length > 0;
+	}
+
+	const char *line() const { return _line; }
+
+	std::size_t length() const { return static_cast<std::size_t>(_length); }
+
+	bool failed() const { return std::ferror(_file) != 0; }
+
+private:
+	std::FILE *_file;
+	std::vector<char> _buffer;
+	char *_line = nullptr;
+	std::size_t _capacity = 0;
+	ssize_t _length = 0;
+};
+
+//Write a file through a temporary renamed over it once it is on the disk.
+class Durable_Writer
+{
+public:
+	explicit Durable_Writer(const std::string &path) :
+		_path(path), _temporary_path(path + ".tmp"), _file(std::fopen(_temporary_path.c_str(), "wb")), _buffer(merge_buffer_size)
+	{
+		if(_file != nullptr)
+			std::setvbuf(_file, _buffer.data(), _IOFBF, _buffer.size());
+	}
+
+	~Durable_Writer()
+	{
+		if(_file != nullptr)
+		{
+			std::fclose(_file);
+
+			std::remove(_temporary_path.c_str());
+		}
+	}
+
+	Durable_Writer(const Durable_Writer &) = delete;
+	Durable_Writer &operator=(const Durable_Writer &) = delete;
+
+	bool valid() const { return _file != nullptr; }
+
+	void write(const char *data, std::size_t length) { std::fwrite(data, 1, length, _file); }
+
+	bool commit()
+	{
+		bool success = std::fflush(_file) == 0 && std::ferror(_file) == 0 && fsync(fileno(_file)) == 0;
+
+		success = std::fclose(_file) == 0 && success;
+
+		_file = nullptr;
+
+		if(success == false || std::rename(_temporary_path.c_str(), _path.c_str()) != 0)
+		{
+			std::remove(_temporary_path.c_str());
+
+			return false;
+		}
+
+		return true;
+	}
+
+private:
+	std::string _path;
+	std::string _temporary_path;
+	std::FILE *_file;
+	std::vector<char> _buffer;
+};
+
+//Merge sorted files into one, all of them open at once.
+inline bool merge_group(const std::vector<std::string> &inputs, const std::string &output)
+{
+	std::vector<std::unique_ptr<Line_Reader>> readers;
+
+	for(const std::string &input : inputs)
+	{
+		readers.emplace_back(new Line_Reader(input));
+
+		if(readers.back()->valid() == false)
+		{
+			std::perror(input.c_str());
+
+			return false;
+		}
+	}
+
+	Durable_Writer writer(output);
+
+	if(writer.valid() == false)
+	{
+		std::perror(output.c_str());
+
+		return false;
+	}
+
+	auto later = [&readers](std::size_t left, std::size_t right)
+	{
+		const Line_Reader &left_reader = *readers[left], &right_reader = *readers[right];
+
+		int order = std::memcmp(left_reader.line(), right_reader.line(), std::min(left_reader.length(), right_reader.length()));
+
+		//Ties go to the earlier input, so the merge is stable.
+		if(order == 0)
+			order = left_reader.length() != right_reader.length() ?
+				(left_reader.length() < right_reader.length() ? -1 : 1) : (left < right ? -1 : 1);
+
+		return order > 0;
+	};
+
+	std::priority_queue<std::size_t, std::vector<std::size_t>, decltype(later)> heads(later);
+
+	for(std::size_t i = 0; i < readers.size(); ++i)
+	{
+		if(readers[i]->next())
+			heads.push(i);
+	}
+
+	while(heads.empty() == false)
+	{
+		std::size_t i = heads.top();
+
+		heads.pop();
+
+		writer.write(readers[i]->line(), readers[i]->length());
+
+		if(readers[i]->next())
+			heads.push(i);
+	}
+
+	for(std::size_t i = 0; i < readers.size(); ++i)
+	{
+		if(readers[i]->failed())
+		{
+			std::perror(inputs[i].c_str());
+
+			return false;
+		}
+	}
+
+	return writer.commit();
+}
+
+/**
+* Merge sorted files into output with at most fan_in of them open at once, intermediate files are
+* named after temporary_prefix and removed once merged. Inputs are removed too if remove_inputs.
+*/
+inline bool merge_sorted_files(
+	const std::vector<std::string> &inputs,
+	const std::string &output,
+	std::size_t fan_in,
+	const std::string &temporary_prefix,
+	bool remove_inputs)
+{
+	fan_in = std::max<std::size_t>(fan_in, 2);
+
+	//Files left to merge, and whether each of them is to be removed once merged.
+	std::deque<std::pair<std::string, bool>> pending;
+
+	for(const std::string &input : inputs)
+		pending.emplace_back(input, remove_inputs);
+
+	std::size_t intermediate = 0;
+
+	for(;;)
+	{
+		std::size_t group_size = std::min(fan_in, pending.size());
+
+		bool last = group_size == pending.size();
+
+		std::vector<std::string> group;
+		std::vector<bool> removable;
+
+		for(std::size_t i = 0; i < group_size; ++i)
+		{
+			group.push_back(pending.front().first);
+			removable.push_back(pending.front().second);
+
+			pending.pop_front();
+		}
+
+		std::string group_output = last ? output : temporary_prefix + std::to_string(intermediate++);
+
+		if(merge_group(group, group_output) == false)
+			return false;
+
+		for(std::size_t i = 0; i < group.size(); ++i)
+		{
+			if(removable[i])
+				std::remove(group[i].c_str());
+		}
+
+		if(last)
+			return true;
+
+		pending.emplace_back(group_output, true);
+	}
+}
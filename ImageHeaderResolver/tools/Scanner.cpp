@@ -0,0 +1,1086 @@
+#include "ImageHeaderResolver.h"
+#include "FileLayout.hpp"
+#include "ImageIndex.hpp"
+#include "RecordFormat.hpp"
+#include "ThreadPool.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <numeric>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <sys/syscall.h>
+#endif
+
+/**
+* ihr-scan, inventory of the images under directory trees.
+* Every directory is a task of the work-stealing pool: a worker lists a directory, queues the
+* sub-directories on its own deque(idle workers steal them) and resolves the files right away.
+* Directories are listed with getdents64 and their entries opened relative to the directory
+* descriptor, entries of unknown type are told apart with statx on the same descriptor.
+* Records are formatted into a buffer per worker and handed over in large blocks to a writer
+* thread, the only one touching the output.
+* With an index, files whose key(device, inode, size and modification time) is unchanged are taken
+* from it instead of being opened, and the index is rewritten with the files found at the end, so
+* the files gone are dropped from it.
+* In watch mode(Linux only) the directories stay watched with inotify once they are scanned, files
+* closed after writing or moved in are resolved as they come and only the new or changed ones are
+* written out(and appended to the index).
+*/
+
+//Workers hand their records over once they have this many bytes.
+static const std::size_t record_block_size = 64 * 1024;
+
+class Record_Writer
+{
+public:
+    Record_Writer(std::FILE *output) : _output(output), _thread(&Record_Writer::run, this) {}
+
+    ~Record_Writer()
+    {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+
+            _stopping = true;
+        }
+
+        _ready.notify_one();
+
+        _thread.join();
+
+        std::fflush(_output);
+    }
+
+    void push(std::string &&block)
+    {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+
+            _blocks.push_back(std::move(block));
+        }
+
+        _ready.notify_one();
+    }
+
+private:
+    void run()
+    {
+        std::deque<std::string> blocks;
+
+        for(;;)
+        {
+            {
+                std::unique_lock<std::mutex> lock(_mutex);
+
+                _ready.wait(lock, [this] { return _blocks.empty() == false || _stopping; });
+
+                if(_blocks.empty() && _stopping)
+                    return;
+
+                blocks.swap(_blocks);
+            }
+
+            for(const std::string &block : blocks)
+                std::fwrite(block.data(), 1, block.size(), _output);
+
+            //Records are read as they come in watch mode.
+            std::fflush(_output);
+
+            blocks.clear();
+        }
+    }
+
+private:
+    std::FILE *_output;
+
+    std::mutex _mutex;
+    std::condition_variable _ready;
+    std::deque<std::string> _blocks;
+    bool _stopping = false;
+
+    std::thread _thread;
+};
+
+struct Scan_Options
+{
+    Output_Format _format = Output_Format::jsonl;
+    bool _all_files = false;
+    bool _physical_order = false;
+    const char *_index_path = nullptr;
+    const char *_columns_path = nullptr;
+    const char *_pack_path = nullptr;
+};
+
+struct Scan_Totals
+{
+    std::atomic<uint64_t> _directories{0};
+    std::atomic<uint64_t> _files{0};
+    std::atomic<uint64_t> _images{0};
+    std::atomic<uint64_t> _indexed{0};
+    std::atomic<uint64_t> _files_located{0};
+    std::atomic<uint64_t> _seek_bytes_listed{0};
+    std::atomic<uint64_t> _seek_bytes_ordered{0};
+};
+
+
+//A directory entry as listed.
+struct Directory_Entry
+{
+    std::string _name;
+    unsigned char _type;
+};
+
+//List a directory through its descriptor, with getdents64 on Linux and readdir elsewhere.
+static bool list_directory(int dir_fd, std::vector<Directory_Entry> &entries)
+{
+#ifdef __linux__
+    struct Linux_Dirent64
+    {
+        uint64_t d_ino;
+        int64_t d_off;
+        unsigned short d_reclen;
+        unsigned char d_type;
+        char d_name[1];
+    };
+
+    alignas(8) char buffer[32 * 1024];
+
+    for(;;)
+    {
+        long length = syscall(SYS_getdents64, dir_fd, buffer, sizeof(buffer));
+
+        if(length < 0)
+            return false;
+
+        if(length == 0)
+            return true;
+
+        for(long position = 0; position < length;)
+        {
+            const Linux_Dirent64 *entry = reinterpret_cast<const Linux_Dirent64 *>(buffer + position);
+
+            position += entry->d_reclen;
+
+            if(std::strcmp(entry->d_name, ".") == 0 || std::strcmp(entry->d_name, "..") == 0)
+                continue;
+
+            entries.push_back(Directory_Entry{ entry->d_name, entry->d_type });
+        }
+    }
+#else
+    int listed_fd = dup(dir_fd);
+
+    DIR *directory = listed_fd >= 0 ? fdopendir(listed_fd) : nullptr;
+
+    if(directory == nullptr)
+    {
+        if(listed_fd >= 0)
+            close(listed_fd);
+
+        return false;
+    }
+
+    while(const dirent *entry = readdir(directory))
+    {
+        if(std::strcmp(entry->d_name, ".") == 0 || std::strcmp(entry->d_name, "..") == 0)
+            continue;
+
+        entries.push_back(Directory_Entry{ entry->d_name, entry->d_type });
+    }
+
+    closedir(directory);
+
+    return true;
+#endif
+}
+
+//The type of an entry listed as DT_UNKNOWN(some file systems never fill it), symbolic links are not followed.
+static unsigned char entry_type(int dir_fd, const std::string &name)
+{
+#if defined __linux__ && defined STATX_TYPE
+    struct statx entry_stat;
+
+    if(statx(dir_fd, name.c_str(), AT_SYMLINK_NOFOLLOW, STATX_TYPE, &entry_stat) != 0)
+        return DT_UNKNOWN;
+
+    mode_t mode = entry_stat.stx_mode;
+#else
+    struct stat entry_stat;
+
+    if(fstatat(dir_fd, name.c_str(), &entry_stat, AT_SYMLINK_NOFOLLOW) != 0)
+        return DT_UNKNOWN;
+
+    mode_t mode = entry_stat.st_mode;
+#endif
+
+    if(S_ISDIR(mode))
+        return DT_DIR;
+    else if(S_ISREG(mode))
+        return DT_REG;
+
+    return DT_UNKNOWN;
+}
+
+//The key of a directory entry, as ihr_file_key gets it from the path.
+static bool file_key_at(int dir_fd, const std::string &name, Ihr_File_Key &key)
+{
+    struct stat file_stat;
+
+    if(fstatat(dir_fd, name.c_str(), &file_stat, 0) != 0)
+        return false;
+
+    key._device = static_cast<uint64_t>(file_stat.st_dev);
+    key._inode = static_cast<uint64_t>(file_stat.st_ino);
+    key._size = static_cast<uint64_t>(file_stat.st_size);
+#if defined __APPLE__
+    key._mtime_ns = static_cast<int64_t>(file_stat.st_mtimespec.tv_sec) * 1000000000LL + file_stat.st_mtimespec.tv_nsec;
+#else
+    key._mtime_ns = static_cast<int64_t>(file_stat.st_mtim.tv_sec) * 1000000000LL + file_stat.st_mtim.tv_nsec;
+#endif
+
+    return true;
+}
+
+class Scanner
+{
+public:
+    Scanner(unsigned int thread_count, const Scan_Options &options, Record_Writer &writer, Ihr_Index *index) :
+        _options(options), _writer(writer), _index(index), _pool(thread_count), _buffers(_pool.thread_count())
+    {}
+
+    //Files resolved are appended to the columnar file too, as their records are written.
+    void set_columns(Ihr_Columns_Writer *columns) { _columns = columns; }
+
+    //Files opened are resolved into the pack, along with their snapshot.
+    void set_pack(Ihr_Pack_Writer *pack) { _pack = pack; }
+
+    //Called with every directory opened, before it is listed.
+    void set_directory_hook(std::function<void(const std::string &)> hook) { _directory_hook = std::move(hook); }
+
+    void scan(const std::string &path)
+    {
+        ++_tasks;
+
+        _pool.submit([this, path] { scan_directory(path); });
+    }
+
+    /**
+    * Resolve files reported by the watcher, their records are handed to the writer at once. Files
+    * unchanged since they were indexed are skipped, the others are appended to the index.
+    * The index given replaces the one of the scan, call once the scan is finished.
+    */
+    void go_live(Ihr_Index *index)
+    {
+        _index = index;
+        _live = true;
+    }
+
+    void resolve_files(std::vector<std::string> paths)
+    {
+        ++_tasks;
+
+        _pool.submit([this, paths = std::move(paths)]
+        {
+            Padded_Buffer buffer;
+
+            for(const std::string &path : paths)
+                resolve_file(AT_FDCWD, path, path, -1, buffer);
+
+            if(buffer._records.empty() == false)
+                _writer.push(std::move(buffer._records));
+
+            --_tasks;
+        });
+    }
+
+    unsigned int thread_count() const { return _pool.thread_count(); }
+
+    //Number of directories and batches of files queued or running.
+    std::size_t tasks() const { return _tasks.load(); }
+
+    void finish()
+    {
+        _pool.wait_idle();
+
+        for(Padded_Buffer &buffer : _buffers)
+        {
+            if(buffer._records.empty() == false)
+                _writer.push(std::move(buffer._records));
+        }
+    }
+
+    //Rewrite the index with the files found.
+    bool write_index(const char *index_path)
+    {
+        std::vector<Index_Entry> entries;
+
+        for(Padded_Buffer &buffer : _buffers)
+        {
+            entries.insert(entries.end(), std::make_move_iterator(buffer._entries.begin()), std::make_move_iterator(buffer._entries.end()));
+
+            buffer._entries.clear();
+        }
+
+        return ::write_index(index_path, entries);
+    }
+
+    const Scan_Totals &totals() const { return _totals; }
+
+private:
+    //Records of a single worker, aligned so neighbours do not share a cache line.
+    struct alignas(64) Padded_Buffer
+    {
+        std::string _records;
+        std::vector<Index_Entry> _entries;
+    };
+
+    void scan_directory(const std::string &path)
+    {
+        int dir_fd = open(path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+
+        if(dir_fd < 0)
+        {
+            std::perror(path.c_str());
+
+            --_tasks;
+
+            return;
+        }
+
+        ++_totals._directories;
+
+        if(_directory_hook)
+            _directory_hook(path);
+
+        std::vector<Directory_Entry> entries;
+
+        if(list_directory(dir_fd, entries) == false)
+            std::perror(path.c_str());
+
+        Padded_Buffer &buffer = _buffers[static_cast<std::size_t>(_pool.current_worker())];
+
+        std::string &records = buffer._records;
+
+        std::vector<const Directory_Entry *> files;
+
+        for(Directory_Entry &entry : entries)
+        {
+            unsigned char type = entry._type == DT_UNKNOWN ? entry_type(dir_fd, entry._name) : entry._type;
+
+            //Sub-directories go to the deque of this worker, where idle workers steal them from.
+            if(type == DT_DIR)
+            {
+                std::string entry_path = path.back() == '/' ? path + entry._name : path + '/' + entry._name;
+
+                scan(entry_path);
+            }
+            else if(type == DT_REG)
+                files.push_back(&entry);
+        }
+
+        std::vector<std::size_t> order(files.size());
+
+        std::iota(order.begin(), order.end(), std::size_t(0));
+
+        //Where the files lie, with the descriptors they are read through, empty for the order listed.
+        std::vector<File_Location> locations;
+
+        if(_options._physical_order)
+            order = order_files(dir_fd, files, order, locations);
+
+        for(std::size_t index : order)
+        {
+            const std::string &name = files[index]->_name;
+
+            int fd = locations.empty() ? -1 : locations[index]._fd;
+
+            resolve_file(dir_fd, name, path.back() == '/' ? path + name : path + '/' + name, fd, buffer);
+
+            if(locations.empty() == false)
+                release_location(locations[index]);
+        }
+
+        close(dir_fd);
+
+        if(records.size() >= record_block_size || (_live && records.empty() == false))
+        {
+            _writer.push(std::move(records));
+
+            records = std::string();
+            records.reserve(record_block_size * 2);
+        }
+
+        --_tasks;
+    }
+
+    //The files of a directory in the order they lie on the device, the descriptors opened to locate them are kept.
+    std::vector<std::size_t> order_files(int dir_fd, const std::vector<const Directory_Entry *> &files, const std::vector<std::size_t> &listed,
+        std::vector<File_Location> &locations)
+    {
+        locations.resize(files.size());
+
+        for(std::size_t i = 0; i < files.size(); ++i)
+            locate_file(dir_fd, files[i]->_name.c_str(), locations[i], true);
+
+        std::vector<std::size_t> order = physical_order(locations);
+
+        _totals._files_located += static_cast<uint64_t>(std::count_if(locations.begin(), locations.end(),
+            [](const File_Location &location) { return location._has_extent; }));
+        _totals._seek_bytes_listed += seek_distance(locations, listed);
+        _totals._seek_bytes_ordered += seek_distance(locations, order);
+
+        return order;
+    }
+
+    //The file is read through located_fd if it is already open, the descriptor is left to the caller.
+    void resolve_file(int dir_fd, const std::string &name, const std::string &path, int located_fd, Padded_Buffer &buffer)
+    {
+        ++_totals._files;
+
+        Image_Info info;
+
+        Ihr_File_Key key;
+
+        bool keyed = _index != nullptr && file_key_at(dir_fd, name, key);
+
+        bool success = false;
+
+        //A pack holds every file scanned, those unchanged are read again for their snapshot.
+        if(keyed && _pack == nullptr && ihr_index_lookup(_index, path.c_str(), &key, &info, &success))
+        {
+            ++_totals._indexed;
+
+            //Already published, only the new and changed files are written out once live.
+            if(_live)
+            {
+                if(success)
+                    release_image_info(&info);
+
+                return;
+            }
+        }
+        else
+        {
+            int fd = located_fd >= 0 ? located_fd : openat(dir_fd, name.c_str(), O_RDONLY | O_CLOEXEC);
+
+            if(_pack != nullptr)
+                success = fd >= 0 && ihr_pack_add_fd(_pack, fd, path.c_str(), &info);
+            else
+                success = fd >= 0 && get_image_info_fd(fd, &info);
+
+            if(fd >= 0 && fd != located_fd)
+                close(fd);
+        }
+
+        if(keyed && _live)
+            ihr_index_append(_index, path.c_str(), &key, success ? &info : nullptr);
+        else if(keyed)
+            buffer._entries.push_back(make_index_entry(path.c_str(), key, success ? &info : nullptr));
+
+        if(success)
+        {
+            ++_totals._images;
+
+            append_record(buffer._records, path, &info, _options._format);
+
+            if(_columns != nullptr)
+                ihr_columns_append(_columns, path.c_str(), &info);
+
+            release_image_info(&info);
+        }
+        else if(_options._all_files)
+        {
+            append_record(buffer._records, path, nullptr, _options._format);
+
+            if(_columns != nullptr)
+                ihr_columns_append(_columns, path.c_str(), nullptr);
+        }
+    }
+
+private:
+    Scan_Options _options;
+    Record_Writer &_writer;
+    Ihr_Index *_index;
+    Ihr_Columns_Writer *_columns = nullptr;
+    Ihr_Pack_Writer *_pack = nullptr;
+    bool _live = false;
+    std::function<void(const std::string &)> _directory_hook;
+    std::atomic<std::size_t> _tasks{0};
+    Thread_Pool _pool;
+    std::vector<Padded_Buffer> _buffers;
+    Scan_Totals _totals;
+};
+
+//Set by SIGINT and SIGTERM, the watcher stops once it sees it.
+static volatile std::sig_atomic_t stop_requested = 0;
+
+static void request_stop(int)
+{
+    stop_requested = 1;
+}
+
+struct Watch_Options
+{
+    unsigned int _rate = 20000;                 //files resolved per second at most, 0 for no limit
+    std::size_t _max_pending = 100000;          //files waiting at most, the directories of the others are rescanned later
+    unsigned int _delay_ms = 10;                //events of a file within this delay make a single resolve
+};
+
+struct Watch_Totals
+{
+    uint64_t _events = 0;
+    uint64_t _coalesced = 0;
+    uint64_t _deferred = 0;
+    uint64_t _dispatched = 0;
+    uint64_t _rescans = 0;
+};
+
+#ifdef __linux__
+/**
+* Watches the scanned directories with inotify. Files closed after writing or moved in wait in a
+* queue for the coalescing delay, events of a file already waiting are merged into it. They are
+* handed over to the scanner in batches, no faster than the rate and with a bounded number of
+* batches in flight. Once the queue is full(a bulk copy, or the kernel queue overflowed) files are
+* no longer queued one by one, their directories are marked and rescanned when the queue is empty.
+*/
+class Watcher
+{
+public:
+    explicit Watcher(const Watch_Options &options) :
+        _options(options), _fd(inotify_init1(IN_NONBLOCK | IN_CLOEXEC))
+    {}
+
+    ~Watcher()
+    {
+        if(_fd >= 0)
+            close(_fd);
+    }
+
+    Watcher(const Watcher &) = delete;
+    Watcher &operator=(const Watcher &) = delete;
+
+    bool valid() const { return _fd >= 0; }
+
+    //Watch a directory, called by the workers of the scanner as they open directories.
+    void watch(const std::string &path)
+    {
+        int wd = inotify_add_watch(_fd, path.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE | IN_ONLYDIR);
+
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        if(wd < 0)
+        {
+            if(_watch_failed == false)
+                std::perror(path.c_str());
+
+            _watch_failed = true;
+
+            return;
+        }
+
+        _directories[wd] = path;
+    }
+
+    void run(Scanner &scanner, const std::vector<std::string> &roots)
+    {
+        pollfd poll_fd = { _fd, POLLIN, 0 };
+
+        _last_refill = std::chrono::steady_clock::now();
+
+        while(stop_requested == 0)
+        {
+            int ready = poll(&poll_fd, 1, next_timeout(scanner));
+
+            if(ready < 0 && errno != EINTR)
+            {
+                std::perror("poll");
+
+                break;
+            }
+
+            if(ready > 0)
+                read_events(scanner, roots);
+
+            dispatch(scanner);
+        }
+    }
+
+    const Watch_Totals &totals() const { return _totals; }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Pending_File
+    {
+        Clock::time_point _queued;
+        std::string _path;
+    };
+
+    //Batches handed over to the scanner at once, and files per batch.
+    static const std::size_t batches_per_thread = 4;
+    static const std::size_t batch_size = 64;
+
+    void read_events(Scanner &scanner, const std::vector<std::string> &roots)
+    {
+        alignas(inotify_event) char buffer[64 * 1024];
+
+        for(;;)
+        {
+            ssize_t length = read(_fd, buffer, sizeof(buffer));
+
+            if(length <= 0)
+                return;
+
+            for(ssize_t position = 0; position < length;)
+            {
+                const inotify_event *event = reinterpret_cast<const inotify_event *>(buffer + position);
+
+                position += static_cast<ssize_t>(sizeof(inotify_event) + event->len);
+
+                ++_totals._events;
+
+                //Events were lost, everything is rescanned(the index keeps it cheap).
+                if(event->mask & IN_Q_OVERFLOW)
+                {
+                    _dirty.insert(roots.begin(), roots.end());
+
+                    continue;
+                }
+
+                std::string directory;
+
+                {
+                    std::lock_guard<std::mutex> lock(_mutex);
+
+                    auto found = _directories.find(event->wd);
+
+                    if(found == _directories.end())
+                        continue;
+
+                    if(event->mask & IN_IGNORED)
+                    {
+                        _directories.erase(found);
+
+                        continue;
+                    }
+
+                    directory = found->second;
+                }
+
+                if(event->len == 0)
+                    continue;
+
+                std::string path = directory.back() == '/' ? directory + event->name : directory + '/' + event->name;
+
+                //A new directory is scanned, which watches it and picks up the files already in it.
+                if(event->mask & IN_ISDIR)
+                {
+                    if(event->mask & (IN_CREATE | IN_MOVED_TO))
+                        scanner.scan(path);
+
+                    continue;
+                }
+
+                if((event->mask & (IN_CLOSE_WRITE | IN_MOVED_TO)) == 0)
+                    continue;
+
+                if(_pending_paths.count(path) != 0)
+                    ++_totals._coalesced;
+                else if(_pending.size() >= _options._max_pending)
+                {
+                    ++_totals._deferred;
+
+                    _dirty.insert(directory);
+                }
+                else
+                {
+                    _pending_paths.insert(path);
+                    _pending.push_back(Pending_File{ Clock::now(), std::move(path) });
+                }
+            }
+        }
+    }
+
+    std::size_t max_tasks(const Scanner &scanner) const
+    {
+        return scanner.thread_count() * batches_per_thread;
+    }
+
+    void refill(Clock::time_point now)
+    {
+        std::chrono::duration<double> elapsed = now - _last_refill;
+
+        _last_refill = now;
+
+        //Bursts up to a tenth of a second worth of files.
+        _tokens = std::min(_tokens + elapsed.count() * _options._rate, std::max(1.0, _options._rate / 10.0));
+    }
+
+    void dispatch(Scanner &scanner)
+    {
+        Clock::time_point now = Clock::now();
+
+        refill(now);
+
+        std::chrono::milliseconds delay(_options._delay_ms);
+
+        std::vector<std::string> batch;
+
+        while(_pending.empty() == false && _pending.front()._queued + delay <= now &&
+              (_options._rate == 0 || _tokens >= 1.0) && scanner.tasks() < max_tasks(scanner))
+        {
+            _pending_paths.erase(_pending.front()._path);
+
+            batch.push_back(std::move(_pending.front()._path));
+
+            _pending.pop_front();
+
+            _tokens -= 1.0;
+
+            if(batch.size() == batch_size)
+            {
+                _totals._dispatched += batch.size();
+
+                scanner.resolve_files(std::move(batch));
+
+                batch.clear();
+            }
+        }
+
+        if(batch.empty() == false)
+        {
+            _totals._dispatched += batch.size();
+
+            scanner.resolve_files(std::move(batch));
+        }
+
+        //Marked directories are rescanned one at a time, once the files queued are done.
+        if(_pending.empty() && _dirty.empty() == false && scanner.tasks() == 0)
+        {
+            std::string directory = *_dirty.begin();
+
+            _dirty.erase(_dirty.begin());
+
+            ++_totals._rescans;
+
+            scanner.scan(directory);
+        }
+    }
+
+    //How long to wait for events before dispatching again.
+    int next_timeout(const Scanner &scanner) const
+    {
+        if(_pending.empty())
+            return _dirty.empty() ? -1 : (scanner.tasks() == 0 ? 0 : 1);
+
+        if(scanner.tasks() >= max_tasks(scanner) || (_options._rate != 0 && _tokens < 1.0))
+            return 1;
+
+        auto wait = std::chrono::duration_cast<std::chrono::milliseconds>(
+            _pending.front()._queued + std::chrono::milliseconds(_options._delay_ms) - Clock::now());
+
+        return static_cast<int>(std::clamp<long long>(wait.count(), 0, _options._delay_ms));
+    }
+
+private:
+    Watch_Options _options;
+    int _fd;
+
+    std::mutex _mutex;
+    std::unordered_map<int, std::string> _directories;
+    bool _watch_failed = false;
+
+    std::deque<Pending_File> _pending;
+    std::unordered_set<std::string> _pending_paths;
+    std::unordered_set<std::string> _dirty;
+
+    double _tokens = 0;
+    Clock::time_point _last_refill;
+
+    Watch_Totals _totals;
+};
+#endif
+
+static void print_usage()
+{
+    std::cerr <<
+        "usage: ihr-scan [-j threads] [-f jsonl|csv|tsv] [-o output] [-a] [-p] [-i index] [-C columns] [-P pack]\n"
+        "                [-w [-r rate] [-q pending] [-d delay]] directory...\n"
+        "  -j  number of worker threads, one per hardware thread by default\n"
+        "  -f  output format, jsonl by default\n"
+        "  -o  output file, the standard output by default\n"
+        "  -a  list the files that are not images too\n"
+        "  -p  read the files of a directory in the order they lie on the device\n"
+        "  -i  index file, unchanged files are taken from it and it is brought up to date\n"
+        "  -C  columnar file of the files scanned(those of the watch are not added to it)\n"
+        "  -P  pack file the snapshots of all the files scanned are written to, the index is then only brought up to date\n"
+        "  -w  keep watching the directories once scanned and resolve the files written or moved in(Linux)\n"
+        "  -r  files resolved per second at most in watch mode, 20000 by default, 0 for no limit\n"
+        "  -q  files waiting at most in watch mode, 100000 by default, directories of the others are rescanned\n"
+        "  -d  delay in milliseconds events of a file are merged within, 10 by default\n";
+}
+
+int main(int argc, char *argv[])
+{
+    unsigned int thread_count = 0;
+    Scan_Options options;
+    bool watch = false;
+    Watch_Options watch_options;
+    const char *output_path = nullptr;
+    std::vector<std::string> directories;
+
+    for(int i = 1; i < argc; ++i)
+    {
+        std::string argument = argv[i];
+
+        if(argument == "-j" && i + 1 < argc)
+            thread_count = static_cast<unsigned int>(std::strtoul(argv[++i], nullptr, 10));
+        else if(argument == "-f" && i + 1 < argc)
+        {
+            std::string format = argv[++i];
+
+            if(format == "jsonl")
+                options._format = Output_Format::jsonl;
+            else if(format == "csv")
+                options._format = Output_Format::csv;
+            else if(format == "tsv")
+                options._format = Output_Format::tsv;
+            else
+            {
+                print_usage();
+
+                return 1;
+            }
+        }
+        else if(argument == "-o" && i + 1 < argc)
+            output_path = argv[++i];
+        else if(argument == "-a")
+            options._all_files = true;
+        else if(argument == "-p")
+            options._physical_order = true;
+        else if(argument == "-i" && i + 1 < argc)
+            options._index_path = argv[++i];
+        else if(argument == "-C" && i + 1 < argc)
+            options._columns_path = argv[++i];
+        else if(argument == "-P" && i + 1 < argc)
+            options._pack_path = argv[++i];
+        else if(argument == "-w")
+            watch = true;
+        else if(argument == "-r" && i + 1 < argc)
+            watch_options._rate = static_cast<unsigned int>(std::strtoul(argv[++i], nullptr, 10));
+        else if(argument == "-q" && i + 1 < argc)
+            watch_options._max_pending = std::max<std::size_t>(1, std::strtoull(argv[++i], nullptr, 10));
+        else if(argument == "-d" && i + 1 < argc)
+            watch_options._delay_ms = static_cast<unsigned int>(std::strtoul(argv[++i], nullptr, 10));
+        else if(argument.empty() == false && argument[0] == '-')
+        {
+            print_usage();
+
+            return 1;
+        }
+        else
+            directories.push_back(argument);
+    }
+
+    if(directories.empty())
+    {
+        print_usage();
+
+        return 1;
+    }
+
+#ifndef __linux__
+    if(watch)
+    {
+        std::cerr << "watch mode needs inotify, it is only available on Linux\n";
+
+        return 1;
+    }
+#endif
+
+    Ihr_Index *index = nullptr;
+
+    if(options._index_path != nullptr)
+    {
+        index = ihr_index_open(options._index_path);
+
+        if(index == nullptr)
+        {
+            std::cerr << options._index_path << ": not an index file\n";
+
+            return 1;
+        }
+    }
+
+    std::FILE *output = output_path != nullptr ? std::fopen(output_path, "wb") : stdout;
+
+    if(output == nullptr)
+    {
+        std::perror(output_path);
+
+        return 1;
+    }
+
+    Ihr_Columns_Writer *columns = nullptr;
+
+    if(options._columns_path != nullptr)
+    {
+        columns = ihr_columns_create(options._columns_path);
+
+        if(columns == nullptr)
+        {
+            std::perror(options._columns_path);
+
+            return 1;
+        }
+    }
+
+    Ihr_Pack_Writer *pack = nullptr;
+
+    if(options._pack_path != nullptr)
+    {
+        pack = ihr_pack_create(options._pack_path, true);
+
+        if(pack == nullptr)
+        {
+            std::perror(options._pack_path);
+
+            return 1;
+        }
+    }
+
+    static char output_buffer[1 << 20];
+    std::setvbuf(output, output_buffer, _IOFBF, sizeof(output_buffer));
+
+    std::fputs(header_line(options._format), output);
+
+    auto start = std::chrono::steady_clock::now();
+
+    Scan_Totals totals_copy;
+    Watch_Totals watch_totals;
+
+    {
+        Record_Writer writer(output);
+
+        Scanner scanner(thread_count, options, writer, index);
+
+        scanner.set_columns(columns);
+        scanner.set_pack(pack);
+
+#ifdef __linux__
+        std::unique_ptr<Watcher> watcher;
+
+        if(watch)
+        {
+            watcher.reset(new Watcher(watch_options));
+
+            if(watcher->valid() == false)
+            {
+                std::perror("inotify");
+
+                return 1;
+            }
+
+            //Directories are watched before they are listed, no file written in between is missed.
+            scanner.set_directory_hook([&watcher](const std::string &path) { watcher->watch(path); });
+        }
+#endif
+
+        for(const std::string &directory : directories)
+            scanner.scan(directory);
+
+        scanner.finish();
+
+        ihr_index_close(index);
+
+        if(options._index_path != nullptr && scanner.write_index(options._index_path) == false)
+            std::perror(options._index_path);
+
+        scanner.set_columns(nullptr);
+        scanner.set_pack(nullptr);
+
+        if(columns != nullptr && ihr_columns_finish(columns) == false)
+            std::perror(options._columns_path);
+
+        if(pack != nullptr && ihr_pack_finish(pack) == false)
+            std::perror(options._pack_path);
+
+#ifdef __linux__
+        if(watcher != nullptr)
+        {
+            Ihr_Index *live_index = options._index_path != nullptr ? ihr_index_open(options._index_path) : nullptr;
+
+            scanner.go_live(live_index);
+
+            struct sigaction action = {};
+            action.sa_handler = request_stop;
+
+            //Without SA_RESTART, so the signal wakes the watcher up.
+            sigaction(SIGINT, &action, nullptr);
+            sigaction(SIGTERM, &action, nullptr);
+
+            std::cerr << "watching, stop with SIGINT or SIGTERM\n";
+
+            watcher->run(scanner, directories);
+
+            scanner.finish();
+
+            ihr_index_close(live_index);
+
+            watch_totals = watcher->totals();
+        }
+#endif
+
+        totals_copy._directories = scanner.totals()._directories.load();
+        totals_copy._files = scanner.totals()._files.load();
+        totals_copy._images = scanner.totals()._images.load();
+        totals_copy._indexed = scanner.totals()._indexed.load();
+        totals_copy._files_located = scanner.totals()._files_located.load();
+        totals_copy._seek_bytes_listed = scanner.totals()._seek_bytes_listed.load();
+        totals_copy._seek_bytes_ordered = scanner.totals()._seek_bytes_ordered.load();
+    }
+
+    std::chrono::duration<double> span = std::chrono::steady_clock::now() - start;
+
+    if(output != stdout)
+        std::fclose(output);
+
+    std::cerr << totals_copy._directories << " directories, " << totals_copy._files << " files, " <<
+        totals_copy._images << " images in " << span.count() << " s, " <<
+        static_cast<double>(totals_copy._files) / span.count() << " files/s\n";
+
+    if(options._index_path != nullptr)
+        std::cerr << totals_copy._indexed << " files taken from the index\n";
+
+    if(watch)
+        std::cerr << watch_totals._events << " events, " << watch_totals._coalesced << " coalesced, " <<
+            watch_totals._dispatched << " files resolved, " << watch_totals._deferred << " deferred to " <<
+            watch_totals._rescans << " directory rescans\n";
+
+    if(options._physical_order)
+        std::cerr << totals_copy._files_located << " files located, seek distance " <<
+            totals_copy._seek_bytes_listed << " bytes in listing order, " <<
+            totals_copy._seek_bytes_ordered << " bytes in physical order\n";
+
+    return 0;
+}
@@ -0,0 +1,63 @@
+#include "RecordMerge.hpp"
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+/**
+* ihr-shard-merge, combines the outputs of ihr-shard-scan(or any files of sorted records) into a
+* single file sorted by path. Memory stays bounded however many and large the inputs are: at most
+* fan-in files are open at once, each with a fixed buffer, more inputs are merged in several passes.
+*/
+
+static void print_usage()
+{
+    std::cerr <<
+        "usage: ihr-shard-merge -o output [-k fan-in] input...\n"
+        "  -o  merged output, written through a temporary renamed over it once complete\n"
+        "  -k  files merged at once, 64 by default\n";
+}
+
+int main(int argc, char *argv[])
+{
+    std::string output_path;
+    std::size_t fan_in = 64;
+    std::vector<std::string> inputs;
+
+    for(int i = 1; i < argc; ++i)
+    {
+        std::string argument = argv[i];
+
+        if(argument == "-o" && i + 1 < argc)
+            output_path = argv[++i];
+        else if(argument == "-k" && i + 1 < argc)
+            fan_in = std::strtoull(argv[++i], nullptr, 10);
+        else if(argument.empty() == false && argument[0] == '-')
+        {
+            print_usage();
+
+            return 1;
+        }
+        else
+            inputs.push_back(argument);
+    }
+
+    if(output_path.empty() || inputs.empty())
+    {
+        print_usage();
+
+        return 1;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+
+    if(merge_sorted_files(inputs, output_path, fan_in, output_path + ".merge", false) == false)
+        return 1;
+
+    std::chrono::duration<double> span = std::chrono::steady_clock::now() - start;
+
+    std::cerr << inputs.size() << " files merged in " << span.count() << " s\n";
+
+    return 0;
+}
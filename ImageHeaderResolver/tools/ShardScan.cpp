@@ -0,0 +1,428 @@
+#include "ImageHeaderResolver.h"
+#include "RecordFormat.hpp"
+#include "RecordMerge.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+#include <sys/stat.h>
+
+/**
+* ihr-shard-scan, the scan of one shard of a manifest(a file listing a path per line), for corpora
+* scanned by many machines at once.
+* A path belongs to shard i of N either by the hash of the path(FNV-1a, the same on every machine)
+* or by the range of the manifest its line starts in(bytes [i * size / N, (i + 1) * size / N)),
+* in which case a machine only reads its own part of the manifest.
+* The paths of the shard are resolved a chunk at a time, every chunk is written sorted as a run
+* file, then a checkpoint records where the manifest is done up to. A scan started again resumes
+* from its checkpoint. Once the manifest is done, the runs are merged into the output, sorted by
+* path, ready for ihr-shard-merge. Records are tsv, as ihr-scan writes them, without the header.
+*/
+
+enum class Shard_Split
+{
+    hash,
+    range
+};
+
+struct Shard_Options
+{
+    const char *_manifest_path = nullptr;
+    std::string _output_path;
+    unsigned int _shard = 0;
+    unsigned int _shard_count = 1;
+    Shard_Split _split = Shard_Split::hash;
+    unsigned int _thread_count = 0;
+    std::size_t _chunk_size = 256 * 1024;
+    std::size_t _fan_in = 64;
+};
+
+//What the scan of a shard has done so far.
+struct Checkpoint
+{
+    uint64_t _manifest_offset = 0;              //the manifest is done up to here
+    uint64_t _runs = 0;                         //number of run files written
+    uint64_t _files = 0;
+    bool _done = false;                         //the runs are merged into the output
+};
+
+static uint64_t hash_path(const char *path, std::size_t length)
+{
+    uint64_t hash = 0xcbf29ce484222325ULL;
+
+    for(std::size_t i = 0; i < length; ++i)
+    {
+        hash ^= static_cast<unsigned char>(path[i]);
+        hash *= 0x100000001b3ULL;
+    }
+
+    return hash;
+}
+
+static std::string run_path(const Shard_Options &options, uint64_t run)
+{
+    return options._output_path + ".run" + std::to_string(run);
+}
+
+static std::string checkpoint_path(const Shard_Options &options)
+{
+    return options._output_path + ".checkpoint";
+}
+
+static const char *split_name(Shard_Split split)
+{
+    return split == Shard_Split::hash ? "hash" : "range";
+}
+
+//Read the checkpoint, false if there is one but it belongs to another shard or is damaged.
+static bool load_checkpoint(const Shard_Options &options, Checkpoint &checkpoint)
+{
+    std::FILE *file = std::fopen(checkpoint_path(options).c_str(), "rb");
+
+    if(file == nullptr)
+        return true;
+
+    unsigned int shard, shard_count, done;
+    char split[16];
+    unsigned long long offset, runs, files;
+
+    bool valid = std::fscanf(file, "ihr-shard-scan 1 %u/%u %15s %llu %llu %llu %u",
+        &shard, &shard_count, split, &offset, &runs, &files, &done) == 7 &&
+        shard == options._shard && shard_count == options._shard_count &&
+        std::strcmp(split, split_name(options._split)) == 0;
+
+    std::fclose(file);
+
+    if(valid)
+    {
+        checkpoint._manifest_offset = offset;
+        checkpoint._runs = runs;
+        checkpoint._files = files;
+        checkpoint._done = done != 0;
+    }
+
+    return valid;
+}
+
+static bool save_checkpoint(const Shard_Options &options, const Checkpoint &checkpoint)
+{
+    char line[192];
+
+    int length = std::snprintf(line, sizeof(line), "ihr-shard-scan 1 %u/%u %s %llu %llu %llu %u\n",
+        options._shard, options._shard_count, split_name(options._split),
+        static_cast<unsigned long long>(checkpoint._manifest_offset), static_cast<unsigned long long>(checkpoint._runs),
+        static_cast<unsigned long long>(checkpoint._files), checkpoint._done ? 1u : 0u);
+
+    Durable_Writer writer(checkpoint_path(options));
+
+    if(writer.valid() == false)
+        return false;
+
+    writer.write(line, static_cast<std::size_t>(length));
+
+    return writer.commit();
+}
+
+//Resolve a chunk of paths and write their records sorted as a run file.
+static bool write_run(const Shard_Options &options, const std::vector<std::string> &paths, const std::string &path)
+{
+    std::vector<const char *> path_pointers;
+    path_pointers.reserve(paths.size());
+
+    for(const std::string &file_path : paths)
+        path_pointers.push_back(file_path.c_str());
+
+    std::vector<Image_Info> infos(paths.size());
+    std::unique_ptr<bool[]> ok(new bool[paths.size()]);
+
+    Ihr_Batch_Options batch_options = {};
+    batch_options._thread_count = options._thread_count;
+
+    get_image_info_batch(path_pointers.data(), paths.size(), infos.data(), ok.get(), &batch_options);
+
+    std::vector<std::string> records(paths.size());
+
+    for(std::size_t i = 0; i < paths.size(); ++i)
+    {
+        append_record(records[i], paths[i], ok[i] ? &infos[i] : nullptr, Output_Format::tsv);
+
+        if(ok[i])
+            release_image_info(&infos[i]);
+    }
+
+    std::sort(records.begin(), records.end());
+
+    Durable_Writer writer(path);
+
+    if(writer.valid() == false)
+        return false;
+
+    for(const std::string &record : records)
+        writer.write(record.data(), record.size());
+
+    return writer.commit();
+}
+
+static bool scan_shard(const Shard_Options &options)
+{
+    Checkpoint checkpoint;
+
+    if(load_checkpoint(options, checkpoint) == false)
+    {
+        std::cerr << checkpoint_path(options) << ": checkpoint of another shard, or damaged\n";
+
+        return false;
+    }
+
+    if(checkpoint._done)
+    {
+        std::cerr << "shard " << options._shard << "/" << options._shard_count << " already done, " <<
+            checkpoint._files << " files\n";
+
+        return true;
+    }
+
+    //Runs written after the last checkpoint were not recorded, they are written again.
+    for(uint64_t run = checkpoint._runs; std::remove(run_path(options, run).c_str()) == 0; ++run)
+        ;
+
+    std::FILE *manifest = std::fopen(options._manifest_path, "rb");
+
+    if(manifest == nullptr)
+    {
+        std::perror(options._manifest_path);
+
+        return false;
+    }
+
+    static char manifest_buffer[1 << 20];
+    std::setvbuf(manifest, manifest_buffer, _IOFBF, sizeof(manifest_buffer));
+
+    struct stat manifest_stat;
+    fstat(fileno(manifest), &manifest_stat);
+
+    uint64_t manifest_size = static_cast<uint64_t>(manifest_stat.st_size);
+
+    //Lines starting before range_end belong to the shard.
+    uint64_t range_end = manifest_size;
+
+    uint64_t offset = checkpoint._manifest_offset;
+
+    if(options._split == Shard_Split::range)
+    {
+        uint64_t range_begin = manifest_size * options._shard / options._shard_count;
+
+        range_end = manifest_size * (options._shard + 1) / options._shard_count;
+
+        //The line going over the beginning of the range belongs to the shard before.
+        if(checkpoint._runs == 0 && checkpoint._manifest_offset == 0 && range_begin > 0)
+        {
+            fseeko(manifest, static_cast<off_t>(range_begin - 1), SEEK_SET);
+
+            int c;
+
+            offset = range_begin - 1;
+
+            do
+            {
+                c = std::fgetc(manifest);
+
+                ++offset;
+            } while(c != '\n' && c != EOF);
+        }
+    }
+
+    if(fseeko(manifest, static_cast<off_t>(offset), SEEK_SET) != 0)
+    {
+        std::perror(options._manifest_path);
+
+        std::fclose(manifest);
+
+        return false;
+    }
+
+    char *line = nullptr;
+    std::size_t capacity = 0;
+
+    std::vector<std::string> paths;
+
+    bool success = true, end_of_manifest = false;
+
+    auto start = std::chrono::steady_clock::now();
+
+    while(end_of_manifest == false)
+    {
+        paths.clear();
+
+        while(paths.size() < options._chunk_size)
+        {
+            if(offset >= range_end)
+            {
+                end_of_manifest = true;
+
+                break;
+            }
+
+            ssize_t length = getline(&line, &capacity, manifest);
+
+            if(length <= 0)
+            {
+                end_of_manifest = true;
+
+                break;
+            }
+
+            offset += static_cast<uint64_t>(length);
+
+            std::size_t path_length = static_cast<std::size_t>(length);
+
+            while(path_length > 0 && (line[path_length - 1] == '\n' || line[path_length - 1] == '\r'))
+                --path_length;
+
+            if(path_length == 0)
+                continue;
+
+            if(options._split == Shard_Split::hash && hash_path(line, path_length) % options._shard_count != options._shard)
+                continue;
+
+            paths.emplace_back(line, path_length);
+        }
+
+        if(paths.empty() == false)
+        {
+            if(write_run(options, paths, run_path(options, checkpoint._runs)) == false)
+            {
+                std::perror(run_path(options, checkpoint._runs).c_str());
+
+                success = false;
+
+                break;
+            }
+
+            ++checkpoint._runs;
+
+            checkpoint._files += paths.size();
+        }
+
+        checkpoint._manifest_offset = offset;
+
+        if(save_checkpoint(options, checkpoint) == false)
+        {
+            std::perror(checkpoint_path(options).c_str());
+
+            success = false;
+
+            break;
+        }
+    }
+
+    std::free(line);
+
+    std::fclose(manifest);
+
+    if(success == false)
+        return false;
+
+    std::vector<std::string> runs;
+
+    for(uint64_t run = 0; run < checkpoint._runs; ++run)
+        runs.push_back(run_path(options, run));
+
+    if(merge_sorted_files(runs, options._output_path, options._fan_in, options._output_path + ".merge", false) == false)
+        return false;
+
+    checkpoint._done = true;
+
+    if(save_checkpoint(options, checkpoint) == false)
+    {
+        std::perror(checkpoint_path(options).c_str());
+
+        return false;
+    }
+
+    for(const std::string &run : runs)
+        std::remove(run.c_str());
+
+    std::chrono::duration<double> span = std::chrono::steady_clock::now() - start;
+
+    std::cerr << "shard " << options._shard << "/" << options._shard_count << ": " << checkpoint._files <<
+        " files in " << span.count() << " s(this run)\n";
+
+    return true;
+}
+
+static void print_usage()
+{
+    std::cerr <<
+        "usage: ihr-shard-scan -m manifest -o output -s i/N [-b hash|range] [-j threads] [-c chunk] [-k fan-in]\n"
+        "  -m  file listing the paths to scan, one per line\n"
+        "  -o  output of the shard, sorted tsv records; output.checkpoint and output.run* are kept next to it\n"
+        "  -s  shard i of N, from 0\n"
+        "  -b  split by path hash(the default) or by manifest range\n"
+        "  -j  number of worker threads, one per hardware thread by default\n"
+        "  -c  paths per run(and per checkpoint), 262144 by default\n"
+        "  -k  files merged at once, 64 by default\n";
+}
+
+int main(int argc, char *argv[])
+{
+    Shard_Options options;
+
+    bool has_shard = false;
+
+    for(int i = 1; i < argc; ++i)
+    {
+        std::string argument = argv[i];
+
+        if(argument == "-m" && i + 1 < argc)
+            options._manifest_path = argv[++i];
+        else if(argument == "-o" && i + 1 < argc)
+            options._output_path = argv[++i];
+        else if((argument == "-s" || argument == "--shard") && i + 1 < argc)
+        {
+            has_shard = std::sscanf(argv[++i], "%u/%u", &options._shard, &options._shard_count) == 2 &&
+                options._shard_count > 0 && options._shard < options._shard_count;
+        }
+        else if(argument == "-b" && i + 1 < argc)
+        {
+            std::string split = argv[++i];
+
+            if(split == "hash")
+                options._split = Shard_Split::hash;
+            else if(split == "range")
+                options._split = Shard_Split::range;
+            else
+            {
+                print_usage();
+
+                return 1;
+            }
+        }
+        else if(argument == "-j" && i + 1 < argc)
+            options._thread_count = static_cast<unsigned int>(std::strtoul(argv[++i], nullptr, 10));
+        else if(argument == "-c" && i + 1 < argc)
+            options._chunk_size = std::max<std::size_t>(1, std::strtoull(argv[++i], nullptr, 10));
+        else if(argument == "-k" && i + 1 < argc)
+            options._fan_in = std::strtoull(argv[++i], nullptr, 10);
+        else
+        {
+            print_usage();
+
+            return 1;
+        }
+    }
+
+    if(options._manifest_path == nullptr || options._output_path.empty() || has_shard == false)
+    {
+        print_usage();
+
+        return 1;
+    }
+
+    return scan_shard(options) ? 0 : 1;
+}
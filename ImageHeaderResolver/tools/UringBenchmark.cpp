@@ -0,0 +1,185 @@
+#include "ImageHeaderResolver.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+
+/**
+* Benchmark of the io_uring engine against the get_image_info loop.
+* The files are resolved with the loop, then with the engine at queue depths 1, 32 and 256 (or the
+* ones given), and every result is checked against the loop. The pages of the files are dropped from
+* the cache before each pass, so that no pass gets the ones an earlier pass read, and the passes run
+* again in reverse order every other round(-r rounds, 2 by default).
+*/
+
+//A pass over the files, with the get_image_info loop if depth is 0, else with the engine.
+struct Pass
+{
+    uint32_t _depth;
+};
+
+/**
+* Drop the cached pages of the files, as posix_fadvise(POSIX_FADV_DONTNEED) does for pages that are
+* not dirty.
+* @return the number of files dropped
+*/
+static std::size_t drop_cached_pages(const std::vector<const char *> &paths)
+{
+    std::size_t dropped = 0;
+
+    for(const char *path : paths)
+    {
+        int fd = open(path, O_RDONLY | O_CLOEXEC);
+
+        if(fd < 0)
+            continue;
+
+        if(posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED) == 0)
+            ++dropped;
+
+        close(fd);
+    }
+
+    return dropped;
+}
+
+static void release_all(std::vector<Image_Info> &infos, const bool *ok)
+{
+    for(std::size_t i = 0; i < infos.size(); ++i)
+    {
+        if(ok[i])
+            release_image_info(&infos[i]);
+    }
+}
+
+static void print_result(const std::string &name, std::size_t files, std::size_t succeeded, double seconds)
+{
+    std::cout << name << " : " << succeeded << '/' << files << " resolved, " <<
+        seconds * 1000.0 << " ms, " << static_cast<double>(files) / seconds << " files/s\n";
+}
+
+int main(int argc, char *argv[])
+{
+    std::vector<uint32_t> depths;
+    std::vector<const char *> paths;
+    unsigned long rounds = 2;
+
+    for(int i = 1; i < argc; ++i)
+    {
+        if(std::strcmp(argv[i], "-d") == 0 && i + 1 < argc)
+            depths.push_back(static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10)));
+        else if(std::strcmp(argv[i], "-r") == 0 && i + 1 < argc)
+            rounds = std::max(1ul, std::strtoul(argv[++i], nullptr, 10));
+        else
+            paths.push_back(argv[i]);
+    }
+
+    if(paths.empty())
+    {
+        std::cout << "usage: ihr-uring-bench [-d queue_depth]... [-r rounds] file...\n";
+
+        return 1;
+    }
+
+    if(depths.empty())
+        depths = { 1, 32, 256 };
+
+    std::size_t n = paths.size();
+
+    //The loop goes first in the first round, its results are the ones expected of the engine.
+    std::vector<Pass> passes = { Pass{0} };
+
+    for(uint32_t depth : depths)
+        passes.push_back(Pass{std::max(depth, 1u)});
+
+    std::vector<Image_Info> expected(n);
+    std::unique_ptr<bool[]> expected_ok(new bool[n]);
+    bool expected_set = false;
+
+    for(unsigned long round = 0; round < rounds; ++round)
+    {
+        std::cout << "round " << round + 1 << '\n';
+
+        for(std::size_t p = 0; p < passes.size(); ++p)
+        {
+            const Pass &pass = passes[round % 2 == 0 ? p : passes.size() - 1 - p];
+
+            std::size_t dropped = drop_cached_pages(paths);
+
+            std::vector<Image_Info> infos(n);
+            std::unique_ptr<bool[]> ok(new bool[n]);
+
+            std::string name = "get_image_info loop";
+            std::size_t succeeded = 0;
+
+            auto start = std::chrono::steady_clock::now();
+
+            if(pass._depth == 0)
+            {
+                for(std::size_t i = 0; i < n; ++i)
+                {
+                    ok[i] = get_image_info(paths[i], &infos[i]);
+
+                    if(ok[i])
+                        ++succeeded;
+                }
+            }
+            else
+            {
+                Ihr_Engine_Options options = {};
+                options._queue_depth = pass._depth;
+
+                Ihr_Engine *engine = ihr_engine_create(&options);
+
+                if(engine == nullptr)
+                    return 1;
+
+                succeeded = ihr_engine_resolve(engine, paths.data(), n, infos.data(), ok.get());
+
+                name = std::string(ihr_engine_is_async(engine) ? "io_uring" : "synchronous") + " depth " + std::to_string(pass._depth);
+
+                ihr_engine_destroy(engine);
+            }
+
+            std::chrono::duration<double> span = std::chrono::steady_clock::now() - start;
+
+            print_result(name, n, succeeded, span.count());
+
+            std::cout << "  page cache dropped for " << dropped << '/' << n << " files before the pass\n";
+
+            if(expected_set == false)
+            {
+                expected.swap(infos);
+                expected_ok.swap(ok);
+                expected_set = true;
+
+                continue;
+            }
+
+            std::size_t mismatches = 0;
+
+            for(std::size_t i = 0; i < n; ++i)
+            {
+                if(ok[i] != expected_ok[i] || (ok[i] &&
+                   (infos[i]._width != expected[i]._width || infos[i]._height != expected[i]._height ||
+                    infos[i]._page_number != expected[i]._page_number || infos[i]._file_size != expected[i]._file_size)))
+                    ++mismatches;
+            }
+
+            if(mismatches != 0)
+                std::cout << "  " << mismatches << " results differ from get_image_info\n";
+
+            release_all(infos, ok.get());
+        }
+    }
+
+    release_all(expected, expected_ok.get());
+
+    return 0;
+}